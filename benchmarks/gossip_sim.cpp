@@ -0,0 +1,291 @@
+// Failure detection and network load of SWIM gossip as the group grows.
+// For each group size, forks worker processes that host the members on
+// localhost UDP ports. This process hosts an observer member, playing the
+// control plane's part, which every member joins through. Once every member
+// sees the whole group and the join news has died down, load is measured:
+// messages and bytes each member sends per second, and how many times the
+// observer came to suspect a member that was up. Then one member, alone in its own
+// process, is killed with SIGKILL, and the harness times how long the
+// observer takes to suspect it and to declare it dead, and how long until
+// every member has dropped it.
+//
+// Usage: gossip-sim [sizes] [processes] [period ms] [base port]
+// sizes is a comma-separated list of group sizes (default 32,128,512).
+#include "gossip_member.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::sig_atomic_t reportRequested = 0;
+
+void onReport(int) {
+    reportRequested = 1;
+}
+
+struct Settings {
+    std::chrono::milliseconds period{200};
+    int basePort = 21000;
+};
+
+dcp::GossipMember::Options memberOptions(const std::string& id, int port, const Settings& settings) {
+    dcp::GossipMember::Options options;
+    options.id = id;
+    options.bindAddress = "127.0.0.1:" + std::to_string(port);
+    options.seeds = {"127.0.0.1:" + std::to_string(settings.basePort)};
+    options.protocolPeriod = settings.period;
+    options.pingTimeout = settings.period * 2 / 5;
+    return options;
+}
+
+// Hosts members [first, last) and answers each SIGUSR1 with one line on
+// `out`: messages sent, bytes sent, and the smallest and largest group size
+// any of its members sees
+[[noreturn]] void runWorker(int first, int last, const Settings& settings, int out, bool victim) {
+    std::signal(SIGUSR1, onReport);
+    std::vector<std::unique_ptr<dcp::GossipMember>> members;
+    for (int i = first; i < last; ++i) {
+        std::string id = victim ? "victim" : "m" + std::to_string(i);
+        members.push_back(std::make_unique<dcp::GossipMember>(memberOptions(id, settings.basePort + i, settings)));
+        if (!members.back()->start()) {
+            _exit(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2)); // spread the joins
+    }
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!reportRequested) {
+            continue;
+        }
+        reportRequested = 0;
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        size_t smallest = SIZE_MAX;
+        size_t largest = 0;
+        for (const auto& member : members) {
+            auto stats = member->stats();
+            messages += stats.messagesSent;
+            bytes += stats.bytesSent;
+            smallest = std::min(smallest, member->aliveCount());
+            largest = std::max(largest, member->aliveCount());
+        }
+        std::string line = std::to_string(messages) + " " + std::to_string(bytes) + " " + std::to_string(smallest) +
+                           " " + std::to_string(largest) + "\n";
+        if (write(out, line.data(), line.size()) < 0) {
+            _exit(1);
+        }
+    }
+}
+
+struct Worker {
+    pid_t pid;
+    FILE* reports;
+    bool victim;
+};
+
+struct Report {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    size_t smallest = SIZE_MAX; // group size seen, over the members still running
+    size_t largest = 0;
+};
+
+Report collect(std::vector<Worker>& workers) {
+    Report total;
+    for (auto& worker : workers) {
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGUSR1);
+        }
+    }
+    for (auto& worker : workers) {
+        if (worker.pid <= 0) {
+            continue;
+        }
+        unsigned long long messages = 0;
+        unsigned long long bytes = 0;
+        size_t smallest = 0;
+        size_t largest = 0;
+        if (std::fscanf(worker.reports, "%llu %llu %zu %zu", &messages, &bytes, &smallest, &largest) != 4) {
+            continue;
+        }
+        total.messages += messages;
+        total.bytes += bytes;
+        total.smallest = std::min(total.smallest, smallest);
+        total.largest = std::max(total.largest, largest);
+    }
+    return total;
+}
+
+void stopWorkers(std::vector<Worker>& workers) {
+    for (auto& worker : workers) {
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGKILL);
+            waitpid(worker.pid, nullptr, 0);
+        }
+        std::fclose(worker.reports);
+    }
+    workers.clear();
+}
+
+double millisSince(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool runSize(int size, int processes, const Settings& settings) {
+    // Members 1..size-2 in the workers, size-1 alone as the victim, 0 here
+    std::vector<Worker> workers;
+    int hosted = size - 2;
+    for (int p = 0; p <= processes; ++p) {
+        bool victim = p == processes;
+        int first = victim ? size - 1 : 1 + hosted * p / processes;
+        int last = victim ? size : 1 + hosted * (p + 1) / processes;
+        int fds[2];
+        if (pipe(fds) != 0) {
+            return false;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            runWorker(first, last, settings, fds[1], victim);
+        }
+        close(fds[1]);
+        workers.push_back(Worker{pid, fdopen(fds[0], "r"), victim});
+    }
+
+    // Forked first, so no worker inherits a half-held lock from our threads
+    std::atomic<int64_t> suspectedAt{-1};
+    std::atomic<int64_t> deadAt{-1};
+    std::atomic<size_t> falseSuspicions{0};
+    auto start = Clock::now();
+    dcp::GossipMember observer(memberOptions("observer", settings.basePort, settings),
+                               [&](const dcp::GossipMember::Member& member) {
+        if (member.id != "victim") {
+            falseSuspicions += member.state == dcp::GossipMember::State::SUSPECT;
+            return;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        if (member.state == dcp::GossipMember::State::SUSPECT && suspectedAt < 0) {
+            suspectedAt = now;
+        } else if (member.state == dcp::GossipMember::State::DEAD && deadAt < 0) {
+            deadAt = now;
+        }
+    });
+    if (!observer.start()) {
+        stopWorkers(workers);
+        return false;
+    }
+
+    // Converged: every member, the observer included, sees the whole group
+    auto deadline = Clock::now() + std::chrono::seconds(120);
+    Report report;
+    while (Clock::now() < deadline) {
+        std::this_thread::sleep_for(settings.period);
+        report = collect(workers);
+        if (observer.aliveCount() == static_cast<size_t>(size) && report.smallest == static_cast<size_t>(size)) {
+            break;
+        }
+    }
+    if (report.smallest != static_cast<size_t>(size)) {
+        std::cerr << "Group of " << size << " did not converge (smallest view " << report.smallest << ")" << std::endl;
+        stopWorkers(workers);
+        return false;
+    }
+    double joinSeconds = millisSince(start, Clock::now()) / 1000;
+
+    // Steady-state load: every member knowing everyone is not enough, as
+    // each still owes its share of retransmissions of the join news. Measure
+    // windows until the bytes sent stop falling.
+    double messages = 0;
+    double bytes = 0;
+    double window = 0;
+    size_t suspicions = 0;
+    for (int windows = 0; windows < 40; ++windows) {
+        Report before = collect(workers);
+        auto observerBefore = observer.stats();
+        size_t suspicionsBefore = falseSuspicions;
+        auto windowStart = Clock::now();
+        std::this_thread::sleep_for(settings.period * 25);
+        Report after = collect(workers);
+        auto observerAfter = observer.stats();
+        double previousBytes = window > 0 ? bytes / window : 0;
+        suspicions = falseSuspicions - suspicionsBefore;
+        window = millisSince(windowStart, Clock::now()) / 1000;
+        messages = static_cast<double>(after.messages - before.messages + observerAfter.messagesSent -
+                                       observerBefore.messagesSent);
+        bytes = static_cast<double>(after.bytes - before.bytes + observerAfter.bytesSent - observerBefore.bytesSent);
+        if (previousBytes > 0 && bytes / window > previousBytes * 0.9) {
+            break;
+        }
+    }
+
+    // Fail the victim
+    Worker& victim = workers.back();
+    kill(victim.pid, SIGKILL);
+    waitpid(victim.pid, nullptr, 0);
+    victim.pid = -1;
+    auto killedAt = Clock::now();
+    int64_t killed = std::chrono::duration_cast<std::chrono::microseconds>(killedAt - start).count();
+    double everyone = -1;
+    deadline = killedAt + std::chrono::seconds(60);
+    while (Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (everyone < 0 && collect(workers).largest == static_cast<size_t>(size - 1)) {
+            everyone = millisSince(killedAt, Clock::now());
+        }
+        if (everyone >= 0 && deadAt >= 0) {
+            break;
+        }
+    }
+
+    auto sinceKill = [killed](int64_t at) { return at < 0 ? -1.0 : static_cast<double>(at - killed) / 1000; };
+    std::cout << std::setw(8) << size << std::setw(8) << processes << std::setw(9) << joinSeconds << std::setw(12)
+              << messages / window / size << std::setw(12) << bytes / window / size << std::setw(14)
+              << suspicions << std::setw(13)
+              << sinceKill(suspectedAt) << std::setw(11) << sinceKill(deadAt) << std::setw(14) << everyone
+              << std::endl;
+
+    observer.stop();
+    stopWorkers(workers);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes;
+    std::stringstream list(argc > 1 ? argv[1] : "32,128,512");
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::max(3, std::stoi(item)));
+    }
+    int processes = argc > 2 ? std::stoi(argv[2]) : 8;
+    Settings settings;
+    settings.period = std::chrono::milliseconds(argc > 3 ? std::stoi(argv[3]) : 200);
+    settings.basePort = argc > 4 ? std::stoi(argv[4]) : 21000;
+
+    std::cout << "SWIM over localhost UDP, " << settings.period.count() << " ms protocol period" << std::endl;
+    std::cout << std::setw(8) << "members" << std::setw(8) << "procs" << std::setw(9) << "join s" << std::setw(12)
+              << "msgs/s/mbr" << std::setw(12) << "B/s/mbr" << std::setw(14) << "false suspect"
+              << std::setw(13) << "suspect ms" << std::setw(11)
+              << "dead ms" << std::setw(14) << "all know ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (int size : sizes) {
+        if (!runSize(size, std::min(processes, std::max(1, size - 2)), settings)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+// Time to sweep many endpoints with TCP connect probes. Opens local
+// endpoints of three kinds: listening ports, closed ports (refused at once)
+// and stalled listeners, whose full accept queue makes the kernel drop SYNs
+// so their probes can only time out. Sweeps them one blocking connect at a
+// time, as the health checker used to, then with HealthProber at several
+// concurrency caps, on epoll and on io_uring. Finally compares HTTP probes of a local HttpServer on
+// fresh connections with probes over pooled keep-alive connections.
+//
+// Usage: health-probe-bench [endpoints] [stalled per mille] [timeout ms] [http probes]
+#include "health_prober.h"
+#include "http_server.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Kind { LISTENING, CLOSED, STALLED };
+
+struct Endpoint {
+    Kind kind;
+    uint16_t port;
+};
+
+// Binds a loopback socket to a free port and returns it, -1 on failure
+int bindLoopback(uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+bool connectLoopback(int fd, uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+}
+
+struct Sweep {
+    double seconds = 0;
+    size_t healthy = 0;
+    size_t failed = 0;
+    size_t timedOut = 0;
+};
+
+// The health checker's old fallback: one blocking connect after another
+Sweep sweepBlocking(const std::vector<Endpoint>& endpoints, std::chrono::milliseconds timeout) {
+    Sweep sweep;
+    auto start = Clock::now();
+    timeval tv{};
+    tv.tv_sec = timeout.count() / 1000;
+    tv.tv_usec = (timeout.count() % 1000) * 1000;
+    for (const auto& endpoint : endpoints) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        if (connectLoopback(fd, endpoint.port)) {
+            ++sweep.healthy;
+        } else if (errno == EINPROGRESS || errno == EAGAIN) {
+            ++sweep.timedOut;
+        } else {
+            ++sweep.failed;
+        }
+        close(fd);
+    }
+    sweep.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return sweep;
+}
+
+Sweep sweepConcurrent(const std::vector<Endpoint>& endpoints, size_t maxInFlight, std::chrono::milliseconds timeout,
+                      bool ioUring, std::string& backend) {
+    Sweep sweep;
+    dcp::HealthProber prober(maxInFlight);
+    if (!prober.init(ioUring)) {
+        return sweep;
+    }
+    backend = prober.backend();
+    dcp::NetAddress loopback = dcp::NetAddress::parse("127.0.0.1");
+    auto record = [&sweep](const dcp::ProbeResult& result) {
+        if (result.healthy) {
+            ++sweep.healthy;
+        } else if (result.timedOut) {
+            ++sweep.timedOut;
+        } else {
+            ++sweep.failed;
+        }
+    };
+    auto start = Clock::now();
+    size_t next = 0;
+    while (next < endpoints.size() || prober.pending() > 0) {
+        while (next < endpoints.size() && prober.start(loopback, endpoints[next].port, timeout, record)) {
+            ++next;
+        }
+        prober.poll(std::chrono::milliseconds(100));
+    }
+    sweep.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return sweep;
+}
+
+double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct HttpSweep {
+    double probesPerSec = 0;
+    double cpuMicrosPerProbe = 0; // prober and server together
+    uint64_t connections = 0;
+    size_t healthy = 0;
+};
+
+// Probes one endpoint `probes` times per round, `inFlight` at once; rounds
+// after the first show the steady state, with the pool already filled
+HttpSweep sweepHttp(uint16_t port, size_t probes, size_t inFlight, size_t maxIdle, int rounds) {
+    HttpSweep sweep;
+    dcp::HealthProber prober(inFlight, maxIdle);
+    if (!prober.init()) {
+        return sweep;
+    }
+    dcp::NetAddress loopback = dcp::NetAddress::parse("127.0.0.1");
+    auto check = std::make_shared<dcp::HttpCheck>();
+    check->expectBody = "healthy";
+    auto record = [&sweep](const dcp::ProbeResult& result) { sweep.healthy += result.healthy; };
+    double seconds = 0;
+    double cpu = 0;
+    uint64_t opened = 0;
+    for (int round = 0; round < rounds; ++round) {
+        sweep.healthy = 0;
+        uint64_t openedBefore = prober.connectionsOpened();
+        double cpuStart = cpuSeconds();
+        auto start = Clock::now();
+        size_t next = 0;
+        while (next < probes || prober.pending() > 0) {
+            while (next < probes && prober.startHttp(loopback, port, check, std::chrono::milliseconds(2000), record)) {
+                ++next;
+            }
+            prober.poll(std::chrono::milliseconds(100));
+        }
+        if (round > 0) {
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+            cpu += cpuSeconds() - cpuStart;
+            opened += prober.connectionsOpened() - openedBefore;
+        }
+    }
+    size_t measured = probes * (rounds - 1);
+    sweep.probesPerSec = measured / seconds;
+    sweep.cpuMicrosPerProbe = cpu * 1e6 / measured;
+    sweep.connections = opened / (rounds - 1);
+    return sweep;
+}
+
+void print(const std::string& mode, size_t inFlight, const Sweep& sweep, size_t endpoints) {
+    std::cout << std::setw(10) << mode << std::setw(11) << inFlight << std::setw(11) << sweep.seconds * 1000
+              << std::setw(12) << static_cast<uint64_t>(endpoints / sweep.seconds) << std::setw(9) << sweep.healthy
+              << std::setw(9) << sweep.failed << std::setw(11) << sweep.timedOut << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+    size_t stalledPerMille = argc > 2 ? std::stoul(argv[2]) : 5;
+    std::chrono::milliseconds timeout(argc > 3 ? std::stoi(argv[3]) : 500);
+
+    // One descriptor per listener, two per stalled endpoint, plus the probes
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    std::vector<Endpoint> endpoints;
+    std::vector<int> held;
+    std::vector<int> released;
+    size_t stalled = count * stalledPerMille / 1000;
+    for (size_t i = 0; i < count; ++i) {
+        Kind kind = i < stalled ? Kind::STALLED : (i % 2 ? Kind::LISTENING : Kind::CLOSED);
+        uint16_t port = 0;
+        int fd = bindLoopback(port);
+        if (fd < 0) {
+            std::cerr << "Out of ports or descriptors after " << i << " endpoints" << std::endl;
+            return 1;
+        }
+        if (kind == Kind::CLOSED) {
+            released.push_back(fd); // bound until every port is taken, so none is handed out again
+        } else {
+            // Backlog 0 admits one queued connection; fill it so later SYNs are dropped
+            listen(fd, kind == Kind::STALLED ? 0 : 128);
+            held.push_back(fd);
+            if (kind == Kind::STALLED) {
+                int filler = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                connectLoopback(filler, port);
+                held.push_back(filler);
+            }
+        }
+        endpoints.push_back(Endpoint{kind, port});
+    }
+    for (int fd : released) {
+        close(fd); // nothing listens there now
+    }
+    std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint& a, const Endpoint& b) { return a.port < b.port; });
+    size_t listening = std::count_if(endpoints.begin(), endpoints.end(),
+                                     [](const Endpoint& e) { return e.kind == Kind::LISTENING; });
+
+    std::cout << endpoints.size() << " endpoints: " << listening << " listening, "
+              << endpoints.size() - listening - stalled << " closed, " << stalled << " stalled; " << timeout.count()
+              << " ms probe timeout" << std::endl;
+    std::cout << std::setw(10) << "mode" << std::setw(11) << "in flight" << std::setw(11) << "sweep ms"
+              << std::setw(12) << "probes/s" << std::setw(9) << "healthy" << std::setw(9) << "failed"
+              << std::setw(11) << "timed out" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    print("blocking", 1, sweepBlocking(endpoints, timeout), endpoints.size());
+    for (bool ioUring : {false, true}) {
+        for (size_t inFlight : {64, 256, 1024, 4096}) {
+            std::string backend;
+            Sweep sweep = sweepConcurrent(endpoints, inFlight, timeout, ioUring, backend);
+            if (ioUring && backend != "io_uring") {
+                break; // not built in or not supported: the epoll rows already cover it
+            }
+            print(backend, inFlight, sweep, endpoints.size());
+        }
+    }
+
+    for (int fd : held) {
+        close(fd);
+    }
+
+    // A service like example-service, answering GET /health with JSON
+    size_t httpProbes = argc > 4 ? std::stoul(argv[4]) : 2000;
+    uint16_t httpPort = 0;
+    int probe = bindLoopback(httpPort);
+    close(probe);
+    dcp::HttpServer server(httpPort);
+    dcp::HttpServerConfig config;
+    config.maxRequestsPerConnection = 1 << 30;
+    server.setConfig(config);
+    server.get("/health", [](const dcp::HttpRequest&) {
+        dcp::HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
+        response.body = "{\"id\": \"svc001\", \"service\": \"UserService\", \"status\": \"healthy\"}";
+        return response;
+    });
+    std::streambuf* out = std::cout.rdbuf(nullptr); // keep the server's log lines out of the table
+    bool started = server.start();
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    if (!started) {
+        std::cerr << "Failed to start the HTTP server" << std::endl;
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::cout << std::endl << "HTTP GET /health, " << httpProbes << " probes per round of one local HttpServer"
+              << std::endl;
+    std::cout << std::setw(12) << "connections" << std::setw(11) << "in flight" << std::setw(12) << "probes/s"
+              << std::setw(14) << "cpu us/probe" << std::setw(14) << "new per round" << std::setw(9) << "healthy"
+              << std::endl;
+    for (size_t inFlight : {1, 64}) {
+        for (size_t maxIdle : {size_t(0), size_t(1024)}) {
+            HttpSweep sweep = sweepHttp(httpPort, httpProbes, inFlight, maxIdle, 4);
+            std::cout << std::setw(12) << (maxIdle ? "pooled" : "fresh") << std::setw(11) << inFlight
+                      << std::setw(12) << static_cast<uint64_t>(sweep.probesPerSec) << std::setw(14)
+                      << sweep.cpuMicrosPerProbe << std::setw(14) << sweep.connections << std::setw(9)
+                      << sweep.healthy << std::endl;
+        }
+    }
+
+    out = std::cout.rdbuf(nullptr);
+    server.stop();
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    return 0;
+}
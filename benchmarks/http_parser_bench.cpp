@@ -0,0 +1,175 @@
+// Compares the original istringstream-based request parsing with the
+// incremental string_view parser used by HttpServer.
+#include "http_parser.h"
+#include "http_server.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The request type and parser HttpServer used before the incremental parser, kept verbatim for comparison
+struct LegacyRequest {
+    std::string method;
+    std::string path;
+    std::string version;
+    std::unordered_map<std::string, std::string> headers;
+    std::string body;
+    std::unordered_map<std::string, std::string> params;
+};
+
+LegacyRequest legacyParseRequest(const std::string& requestStr) {
+    LegacyRequest request;
+
+    std::istringstream stream(requestStr);
+    std::string line;
+
+    if (std::getline(stream, line)) {
+        std::istringstream lineStream(line);
+        lineStream >> request.method >> request.path;
+
+        size_t queryPos = request.path.find('?');
+        if (queryPos != std::string::npos) {
+            std::string query = request.path.substr(queryPos + 1);
+            request.path = request.path.substr(0, queryPos);
+
+            std::istringstream queryStream(query);
+            std::string param;
+            while (std::getline(queryStream, param, '&')) {
+                size_t eqPos = param.find('=');
+                if (eqPos != std::string::npos) {
+                    std::string key = param.substr(0, eqPos);
+                    std::string value = param.substr(eqPos + 1);
+                    request.params[key] = value;
+                }
+            }
+        }
+    }
+
+    while (std::getline(stream, line) && line != "\r" && !line.empty()) {
+        size_t colonPos = line.find(':');
+        if (colonPos != std::string::npos) {
+            std::string key = line.substr(0, colonPos);
+            std::string value = line.substr(colonPos + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t\r\n") + 1);
+            request.headers[key] = value;
+        }
+    }
+
+    std::string body;
+    std::string bodyLine;
+    while (std::getline(stream, bodyLine)) {
+        body += bodyLine + "\n";
+    }
+    if (!body.empty()) {
+        body.pop_back();
+    }
+    request.body = body;
+
+    return request;
+}
+
+struct Workload {
+    std::string name;
+    std::string request;
+};
+
+std::vector<Workload> makeWorkloads() {
+    std::vector<Workload> workloads;
+
+    workloads.push_back({"GET /api/metrics",
+        "GET /api/metrics?format=json HTTP/1.1\r\n"
+        "Host: control-plane:8080\r\n"
+        "User-Agent: node-agent/2.3\r\n"
+        "Accept: application/json\r\n"
+        "Connection: keep-alive\r\n\r\n"});
+
+    std::string body = R"({"id":"user-service-01","name":"UserService","host":"10.0.0.12",)"
+                       R"("port":9001,"metadata":{"version":"1.0.0","environment":"production"}})";
+    workloads.push_back({"POST register",
+        "POST /api/services/register HTTP/1.1\r\n"
+        "Host: control-plane:8080\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body});
+
+    std::string large(64 * 1024, 'x');
+    for (size_t i = 80; i < large.size(); i += 81) {
+        large[i] = '\n';
+    }
+    workloads.push_back({"POST 64KB body",
+        "POST /api/config HTTP/1.1\r\n"
+        "Host: control-plane:8080\r\n"
+        "Content-Length: " + std::to_string(large.size()) + "\r\n\r\n" + large});
+
+    return workloads;
+}
+
+template<typename Fn>
+double nanosPerOp(size_t iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+    size_t sink = 0;
+
+    std::cout << std::left << std::setw(18) << "workload"
+              << std::right << std::setw(14) << "legacy ns/op"
+              << std::setw(14) << "views ns/op"
+              << std::setw(16) << "request ns/op" << std::endl;
+
+    for (auto& workload : makeWorkloads()) {
+        size_t n = workload.request.size() > 4096 ? iterations / 20 : iterations;
+        std::string buffer = workload.request;
+
+        double legacy = nanosPerOp(n, [&]() {
+            LegacyRequest request = legacyParseRequest(workload.request);
+            sink += request.body.size();
+        });
+
+        // Parser only: framing plus string_view slices, no copies
+        dcp::HttpRequestParser parser;
+        double views = nanosPerOp(n, [&]() {
+            parser.reset();
+            if (parser.parse(buffer.data(), buffer.size()) == dcp::ParseResult::Complete) {
+                sink += parser.body().size() + parser.headerCount();
+            }
+        });
+
+        // Parser plus building the HttpRequest handed to route handlers
+        dcp::RequestArena arena;
+        double full = nanosPerOp(n, [&]() {
+            arena.reset();
+            dcp::RequestArena::Scope scope(arena);
+            parser.reset();
+            parser.parse(buffer.data(), buffer.size());
+            dcp::HttpRequest request;
+            request.method = parser.method();
+            request.path = parser.path();
+            for (size_t i = 0; i < parser.headerCount(); ++i) {
+                auto header = parser.header(i);
+                request.headers.append(header.name, header.value);
+            }
+            request.body = parser.body();
+            sink += request.body.size();
+        });
+
+        std::cout << std::left << std::setw(18) << workload.name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(14) << legacy << std::setw(14) << views
+                  << std::setw(16) << full << std::endl;
+    }
+
+    return sink == 0 ? 1 : 0;
+}
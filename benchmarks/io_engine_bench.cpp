@@ -0,0 +1,197 @@
+// Compares the epoll and io_uring HttpServer engines on the same workload:
+// keep-alive connections driven by one epoll client thread, each keeping a
+// fixed number of pipelined GET requests in flight.
+#include "http_server.h"
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::string kRequest = "GET /ping HTTP/1.1\r\nHost: bench\r\n\r\n";
+
+struct Result {
+    double requestsPerSec = 0;
+    double cpuMicrosPerRequest = 0;
+};
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Every response to /ping is identical, so completed responses are counted by size
+size_t responseSize(int port) {
+    int fd = connectTo(port);
+    send(fd, kRequest.data(), kRequest.size(), 0);
+    char buffer[1024];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    close(fd);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+Result runClient(int port, int connections, int depth, double seconds) {
+    size_t respSize = responseSize(port);
+    if (respSize == 0) {
+        return {};
+    }
+
+    struct ClientConn {
+        int fd;
+        size_t received = 0;
+        uint64_t completed = 0;
+    };
+    std::vector<ClientConn> conns;
+    int epollFd = epoll_create1(0);
+    std::string batch;
+    for (int i = 0; i < depth; ++i) {
+        batch += kRequest;
+    }
+    for (int i = 0; i < connections; ++i) {
+        ClientConn conn{connectTo(port)};
+        if (conn.fd < 0) {
+            continue;
+        }
+        conns.push_back(conn);
+    }
+    for (size_t i = 0; i < conns.size(); ++i) {
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+        send(conns[i].fd, batch.data(), batch.size(), 0);
+    }
+
+    std::vector<char> buffer(1 << 16);
+    std::vector<struct epoll_event> events(conns.size());
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    uint64_t total = 0;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < n; ++i) {
+            ClientConn& conn = conns[events[i].data.u64];
+            ssize_t bytes = recv(conn.fd, buffer.data(), buffer.size(), 0);
+            if (bytes <= 0) {
+                continue;
+            }
+            conn.received += static_cast<size_t>(bytes);
+            uint64_t done = conn.received / respSize;
+            uint64_t fresh = done - conn.completed;
+            conn.completed = done;
+            total += fresh;
+
+            // Top the pipeline back up to `depth` outstanding requests
+            std::string more;
+            for (uint64_t k = 0; k < fresh; ++k) {
+                more += kRequest;
+            }
+            if (!more.empty()) {
+                send(conn.fd, more.data(), more.size(), 0);
+            }
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuStart;
+    for (auto& conn : conns) {
+        close(conn.fd);
+    }
+    close(epollFd);
+
+    Result result;
+    result.requestsPerSec = total / elapsed;
+    result.cpuMicrosPerRequest = total > 0 ? cpu * 1e6 / total : 0;
+    return result;
+}
+
+Result runEngine(bool ioUring, int port, int connections, int depth, double seconds, std::string& engine) {
+    dcp::HttpServer server(port);
+    dcp::HttpServerConfig config;
+    config.ioUring = ioUring;
+    config.maxQueuedRequests = 0;
+    config.maxRequestsPerConnection = 1 << 30;
+    server.setConfig(config);
+    server.get("/ping", [](const dcp::HttpRequest&) {
+        dcp::HttpResponse response;
+        response.headers["Content-Type"] = "text/plain";
+        response.body = "pong";
+        return response;
+    });
+    
+    // Keep the server's start/stop log lines out of the results table
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    bool started = server.start();
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    if (!started) {
+        return {};
+    }
+    engine = server.ioEngine();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Result result = runClient(port, connections, depth, seconds);
+    
+    out = std::cout.rdbuf(nullptr);
+    server.stop();
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? std::stod(argv[1]) : 3.0;
+    int port = argc > 2 ? std::stoi(argv[2]) : 18480;
+
+    struct Workload {
+        int connections;
+        int depth;
+    };
+    const Workload workloads[] = {{1, 1}, {64, 1}, {64, 16}};
+
+    std::cout << std::left << std::setw(22) << "workload" << std::setw(10) << "engine"
+              << std::right << std::setw(14) << "req/s" << std::setw(16) << "cpu us/req" << std::endl;
+
+    for (const auto& workload : workloads) {
+        std::string label = std::to_string(workload.connections) + " conns x " +
+                            std::to_string(workload.depth) + " deep";
+        for (bool ioUring : {false, true}) {
+            std::string engine;
+            Result result = runEngine(ioUring, port++, workload.connections, workload.depth, seconds, engine);
+            std::cout << std::left << std::setw(22) << label << std::setw(10) << engine
+                      << std::right << std::fixed << std::setprecision(0) << std::setw(14) << result.requestsPerSec
+                      << std::setprecision(2) << std::setw(16) << result.cpuMicrosPerRequest << std::endl;
+        }
+    }
+    return 0;
+}
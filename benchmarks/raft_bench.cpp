@@ -0,0 +1,215 @@
+// Throughput and latency of committed registrations in cluster mode.
+// Starts a group of control-plane processes on localhost ports, waits for a
+// leader, then has client threads register instances on the leader for a
+// fixed time, each waiting for its write to commit before sending the next.
+// Runs single registrations and 50-instance batches, on a lone member and on
+// a 3-member group; a registration counts once its 200 arrives, i.e. once a
+// majority has it on disk and the leader has applied it.
+//
+// Usage: raft-bench [control-plane binary] [directory] [clients] [seconds] [base port]
+// The binary defaults to ./bin/control-plane (run from the build directory);
+// the directory (default ./raft-bench.data) is removed afterwards.
+#include "http_client.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kBatchSize = 50;
+
+struct Cluster {
+    std::vector<pid_t> pids;
+    std::vector<int> ports;
+
+    ~Cluster() {
+        for (pid_t pid : pids) {
+            kill(pid, SIGKILL); // only the timing matters; skip the clean shutdown
+            waitpid(pid, nullptr, 0);
+        }
+    }
+};
+
+bool startCluster(const std::string& binary, const std::string& directory, int members, int basePort,
+                  Cluster& cluster) {
+    nlohmann::json memberMap = nlohmann::json::object();
+    for (int i = 0; i < members; ++i) {
+        memberMap["n" + std::to_string(i)] = "127.0.0.1:" + std::to_string(basePort + i);
+    }
+    for (int i = 0; i < members; ++i) {
+        std::string nodeDirectory = directory + "/n" + std::to_string(i);
+        std::filesystem::create_directories(nodeDirectory);
+        nlohmann::json config;
+        config["server"]["worker_threads"] = 2;
+        config["health_check"]["interval_ms"] = 3600000;
+        config["persistence"]["directory"] = "data";
+        config["persistence"]["fsync"] = "always";
+        config["cluster"]["enabled"] = true;
+        config["cluster"]["node_id"] = "n" + std::to_string(i);
+        config["cluster"]["members"] = memberMap;
+        std::ofstream(nodeDirectory + "/config.json") << config.dump(4);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            return false;
+        }
+        if (pid == 0) {
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+            if (chdir(nodeDirectory.c_str()) == 0) {
+                std::string port = std::to_string(basePort + i);
+                execl(binary.c_str(), binary.c_str(), port.c_str(), static_cast<char*>(nullptr));
+            }
+            _exit(127);
+        }
+        cluster.pids.push_back(pid);
+        cluster.ports.push_back(basePort + i);
+    }
+    return true;
+}
+
+// Port of the member that leads, 0 if none does within the timeout
+int waitForLeader(const Cluster& cluster, std::chrono::seconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (Clock::now() < deadline) {
+        for (int port : cluster.ports) {
+            dcp::HttpClient client("127.0.0.1", static_cast<uint16_t>(port), 500);
+            dcp::HttpClient::Response response;
+            if (!client.request("GET", "/api/cluster", "", response) || response.status != 200) {
+                continue;
+            }
+            nlohmann::json status = nlohmann::json::parse(response.body, nullptr, false);
+            if (status.is_object() && status.value("role", "") == "leader" && status.value("readable", false)) {
+                return port;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return 0;
+}
+
+nlohmann::json serviceJson(size_t i) {
+    nlohmann::json service;
+    service["id"] = "instance-" + std::to_string(i);
+    service["name"] = "service-" + std::to_string(i % 1000);
+    service["host"] = "10.0." + std::to_string((i >> 8) & 255) + "." + std::to_string(i & 255);
+    service["port"] = 8000 + static_cast<int>(i % 1000);
+    service["metadata"] = {{"version", "v1." + std::to_string(i % 7)}, {"zone", "zone-" + std::to_string(i % 3)}};
+    return service;
+}
+
+std::string registration(size_t i) {
+    return serviceJson(i).dump();
+}
+
+std::string batch(size_t first) {
+    nlohmann::json operations = nlohmann::json::array();
+    for (size_t i = first; i < first + kBatchSize; ++i) {
+        nlohmann::json operation = serviceJson(i);
+        operation["op"] = "register";
+        operations.push_back(std::move(operation));
+    }
+    return nlohmann::json{{"operations", operations}}.dump();
+}
+
+void measure(int port, int members, bool batched, int clients, double seconds) {
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> failures{0};
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            dcp::HttpClient client("127.0.0.1", static_cast<uint16_t>(port));
+            dcp::HttpClient::Response response;
+            size_t step = batched ? kBatchSize : 1;
+            for (size_t i = static_cast<size_t>(c) * 10000000; !stop.load(std::memory_order_relaxed); i += step) {
+                std::string body = batched ? batch(i) : registration(i);
+                auto sent = Clock::now();
+                bool ok = client.request("POST", batched ? "/api/services/batch" : "/api/services/register", body,
+                                         response);
+                if (!ok || response.status != 200) {
+                    ++failures;
+                    continue;
+                }
+                latencies[c].push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& local : latencies) {
+        all.insert(all.end(), local.begin(), local.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all.empty() ? 0.0 : all[static_cast<size_t>(p * (all.size() - 1))]; };
+    size_t registrations = all.size() * (batched ? kBatchSize : 1);
+
+    std::cout << std::setw(8) << members << std::setw(8) << (batched ? kBatchSize : 1) << std::setw(9) << clients
+              << std::setw(17) << static_cast<uint64_t>(registrations / elapsed) << std::setw(10) << percentile(0.5)
+              << std::setw(10) << percentile(0.99) << std::setw(10) << failures.load() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string binary = std::filesystem::absolute(argc > 1 ? argv[1] : "bin/control-plane");
+    std::string directory = std::filesystem::absolute(argc > 2 ? argv[2] : "raft-bench.data");
+    int clients = argc > 3 ? std::stoi(argv[3]) : 16;
+    double seconds = argc > 4 ? std::stod(argv[4]) : 3.0;
+    int basePort = argc > 5 ? std::stoi(argv[5]) : 19400;
+
+    if (!std::filesystem::exists(binary)) {
+        std::cerr << "control-plane binary not found at " << binary << std::endl;
+        return 1;
+    }
+
+    std::cout << "committed registrations (" << seconds << " s per row, fsync always)" << std::endl;
+    std::cout << std::setw(8) << "members" << std::setw(8) << "batch" << std::setw(9) << "clients" << std::setw(17)
+              << "registrations/s" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10)
+              << "failed" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int members : {1, 3}) {
+        std::filesystem::remove_all(directory);
+        Cluster cluster;
+        if (!startCluster(binary, directory, members, basePort, cluster)) {
+            std::cerr << "Failed to start the cluster" << std::endl;
+            return 1;
+        }
+        int leader = waitForLeader(cluster, std::chrono::seconds(10));
+        if (!leader) {
+            std::cerr << "No leader elected among " << members << " members" << std::endl;
+            return 1;
+        }
+        for (bool batched : {false, true}) {
+            for (int count : {1, clients}) {
+                measure(leader, members, batched, count, seconds);
+            }
+        }
+        basePort += members; // the previous group's ports may still be in TIME_WAIT
+    }
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
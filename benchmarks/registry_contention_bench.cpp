@@ -0,0 +1,206 @@
+// Read throughput of the service registry under a steady write load.
+// Reader threads resolve random service names to a healthy instance, as the
+// load balancer does, while one writer flips instance health at a fixed
+// rate, grouping the writes that come due together. The snapshot registry
+// is compared with a mutex-guarded registry that keeps the same name index
+// but copies the instance list under the lock (the registry's previous
+// design).
+#include "service_registry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using ServiceList = std::vector<std::shared_ptr<dcp::Service>>;
+
+class LockedRegistry {
+private:
+    struct NameIndex {
+        ServiceList all;
+        ServiceList healthy;
+    };
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<dcp::Service>> services_;
+    std::unordered_map<std::string, NameIndex> names_;
+
+public:
+    void registerService(const std::shared_ptr<dcp::Service>& service) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        services_[service->id] = service;
+        NameIndex& index = names_[service->name];
+        index.all.push_back(service);
+        if (service->status == dcp::ServiceStatus::HEALTHY) {
+            index.healthy.push_back(service);
+        }
+    }
+
+    void updateServiceStatus(const std::string& serviceId, dcp::ServiceStatus status) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = services_.find(serviceId);
+        if (it == services_.end() || it->second->status == status) {
+            return;
+        }
+        auto service = it->second;
+        service->status = status;
+        ServiceList& healthy = names_[service->name].healthy;
+        if (status == dcp::ServiceStatus::HEALTHY) {
+            healthy.push_back(service);
+        } else {
+            healthy.erase(std::remove(healthy.begin(), healthy.end(), service), healthy.end());
+        }
+    }
+
+    ServiceList getHealthyServices(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = names_.find(name);
+        return it != names_.end() ? it->second.healthy : ServiceList();
+    }
+};
+
+struct Result {
+    double readsPerSecond = 0;
+    double writesPerSecond = 0;
+};
+
+// Reader side of each registry: returns a picked instance so the work is not optimized away
+struct SnapshotReader {
+    const dcp::ServiceRegistry& registry;
+    const dcp::Service* pick(const std::string& name, size_t n) const {
+        auto snapshot = registry.snapshot();
+        const auto& services = snapshot->healthyServices(name);
+        return services.empty() ? nullptr : services[n % services.size()].get();
+    }
+};
+
+struct LockedReader {
+    const LockedRegistry& registry;
+    const dcp::Service* pick(const std::string& name, size_t n) const {
+        auto services = registry.getHealthyServices(name);
+        return services.empty() ? nullptr : services[n % services.size()].get();
+    }
+};
+
+template <typename Reader, typename Write>
+Result run(const Reader& reader, Write&& write, const std::vector<std::string>& names,
+           const std::vector<std::string>& ids, int readers, int writesPerSecond,
+           std::chrono::milliseconds duration) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> hits{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t + 1);
+            uint64_t count = 0;
+            uint64_t found = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 64; ++i) {
+                    found += reader.pick(names[rng() % names.size()], count++) != nullptr;
+                }
+            }
+            reads.fetch_add(count);
+            hits.fetch_add(found);
+        });
+    }
+
+    // Paced writer: each wake-up applies every write that has come due as one batch
+    uint64_t writes = 0;
+    std::mt19937 rng(99);
+    auto start = Clock::now();
+    auto end = start + duration;
+    auto interval = std::chrono::nanoseconds(1000000000LL / std::max(writesPerSecond, 1));
+    auto next = start;
+    while (Clock::now() < end) {
+        auto now = Clock::now();
+        size_t due = 0;
+        for (; writesPerSecond > 0 && next <= now; next += interval) {
+            ++due;
+        }
+        if (due > 0) {
+            write(ids, rng, due);
+            writes += due;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (hits.load() == 0) {
+        std::cerr << "no healthy instances found" << std::endl;
+    }
+    return {reads.load() / seconds, writes / seconds};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int serviceNames = argc > 1 ? std::stoi(argv[1]) : 2000;
+    int instancesPerName = argc > 2 ? std::stoi(argv[2]) : 25;
+    int writesPerSecond = argc > 3 ? std::stoi(argv[3]) : 10000;
+    auto duration = std::chrono::milliseconds(argc > 4 ? std::stoi(argv[4]) : 1000);
+
+    std::vector<std::string> names;
+    std::vector<std::string> ids;
+    dcp::ServiceRegistry snapshotRegistry;
+    LockedRegistry lockedRegistry;
+    {
+        dcp::ServiceRegistry::Batch batch(snapshotRegistry);
+        for (int n = 0; n < serviceNames; ++n) {
+            names.push_back("service-" + std::to_string(n));
+            for (int i = 0; i < instancesPerName; ++i) {
+                ids.push_back(names.back() + "-" + std::to_string(i));
+                for (int copy = 0; copy < 2; ++copy) {
+                    auto service = std::make_shared<dcp::Service>(ids.back(), names.back(), "10.0.0.1", 8000 + i);
+                    service->status = dcp::ServiceStatus::HEALTHY;
+                    if (copy == 0) {
+                        snapshotRegistry.registerService(service);
+                    } else {
+                        lockedRegistry.registerService(service);
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << ids.size() << " instances across " << names.size() << " names, "
+              << writesPerSecond << " status writes/s target" << std::endl;
+    std::cout << std::left << std::setw(10) << "readers" << std::setw(12) << "registry"
+              << std::right << std::setw(16) << "reads/s" << std::setw(14) << "writes/s" << std::endl;
+
+    SnapshotReader snapshotReader{snapshotRegistry};
+    LockedReader lockedReader{lockedRegistry};
+    auto lockedWrite = [&](const std::vector<std::string>& ids, std::mt19937& rng, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            lockedRegistry.updateServiceStatus(ids[rng() % ids.size()], (rng() % 4) ? dcp::ServiceStatus::HEALTHY : dcp::ServiceStatus::UNHEALTHY);
+        }
+    };
+    auto snapshotWrite = [&](const std::vector<std::string>& ids, std::mt19937& rng, size_t count) {
+        dcp::ServiceRegistry::Batch batch(snapshotRegistry);
+        for (size_t i = 0; i < count; ++i) {
+            snapshotRegistry.updateServiceStatus(ids[rng() % ids.size()], (rng() % 4) ? dcp::ServiceStatus::HEALTHY : dcp::ServiceStatus::UNHEALTHY);
+        }
+    };
+    for (int readers : {1, 4, 16}) {
+        Result locked = run(lockedReader, lockedWrite, names, ids, readers, writesPerSecond, duration);
+        Result snapshot = run(snapshotReader, snapshotWrite, names, ids, readers, writesPerSecond, duration);
+
+        for (const auto& [label, result] : {std::make_pair("mutex", locked), std::make_pair("snapshot", snapshot)}) {
+            std::cout << std::left << std::setw(10) << readers << std::setw(12) << label
+                      << std::right << std::fixed << std::setprecision(0) << std::setw(16)
+                      << result.readsPerSecond << std::setw(14) << result.writesPerSecond << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Counts global heap allocations on HttpServer's steady-state request path.
+// A keep-alive client sends identical requests back to back; after a warm-up
+// the process-wide operator new count is sampled around a measured run, so
+// the result covers the event loop, the worker and the client together
+// (the client itself does not allocate while measuring).
+#include "http_server.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocationBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Workload {
+    const char* name;
+    std::string request;
+};
+
+struct Result {
+    double allocationsPerRequest = 0;
+    double bytesPerRequest = 0;
+};
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Sends one request and reads exactly `expected` bytes back, or learns the size if 0
+size_t roundTrip(int fd, const std::string& request, size_t expected) {
+    char buffer[4096];
+    if (send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) {
+        return 0;
+    }
+    size_t received = 0;
+    do {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return 0;
+        }
+        received += static_cast<size_t>(n);
+    } while (received < expected);
+    return received;
+}
+
+Result measure(int port, const std::string& request, size_t requests) {
+    int fd = connectTo(port);
+    if (fd < 0) {
+        return {};
+    }
+    size_t responseSize = roundTrip(fd, request, 0);
+    for (size_t i = 0; i < 1000 && responseSize > 0; ++i) {
+        roundTrip(fd, request, responseSize);
+    }
+
+    uint64_t count = allocationCount.load();
+    uint64_t bytes = allocationBytes.load();
+    for (size_t i = 0; i < requests; ++i) {
+        if (roundTrip(fd, request, responseSize) == 0) {
+            close(fd);
+            return {};
+        }
+    }
+    Result result;
+    result.allocationsPerRequest = static_cast<double>(allocationCount.load() - count) / requests;
+    result.bytesPerRequest = static_cast<double>(allocationBytes.load() - bytes) / requests;
+    close(fd);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? std::stoul(argv[1]) : 20000;
+    int port = argc > 2 ? std::stoi(argv[2]) : 18490;
+
+    const Workload workloads[] = {
+        {"GET /ping",
+         "GET /ping HTTP/1.1\r\nHost: bench\r\n\r\n"},
+        {"GET /api/items/:id",
+         "GET /api/items/42?fields=name&verbose=1 HTTP/1.1\r\n"
+         "Host: control-plane:8080\r\n"
+         "User-Agent: node-agent/2.3\r\n"
+         "Accept: application/json\r\n"
+         "Accept-Encoding: gzip, deflate\r\n"
+         "X-Request-Id: 6f1c2a9e-5b7d-4e1a-9c3f-2d8b7a6e5f40\r\n"
+         "Connection: keep-alive\r\n\r\n"},
+    };
+
+    std::cout << std::left << std::setw(22) << "workload" << std::setw(10) << "engine"
+              << std::right << std::setw(14) << "allocs/req" << std::setw(14) << "bytes/req" << std::endl;
+
+    for (bool ioUring : {false, true}) {
+        dcp::HttpServer server(port);
+        dcp::HttpServerConfig config;
+        config.ioUring = ioUring;
+        config.workerThreads = 1;
+        config.maxRequestsPerConnection = 1 << 30;
+        server.setConfig(config);
+        server.get("/ping", [](const dcp::HttpRequest&) {
+            dcp::HttpResponse response;
+            response.headers["Content-Type"] = "text/plain";
+            response.body = "pong";
+            return response;
+        });
+        server.get("/api/items/:id", [](const dcp::HttpRequest& request) {
+            dcp::HttpResponse response;
+            response.headers["Content-Type"] = "application/json";
+            response.headers["Cache-Control"] = "no-store";
+            response.headers["X-Request-Id"] = request.headers.get("x-request-id");
+            response.body = "{\"id\":";
+            response.body.append(request.params.at("id"));
+            response.body.append("}");
+            return response;
+        });
+
+        std::streambuf* out = std::cout.rdbuf(nullptr);
+        bool started = server.start();
+        std::cout.rdbuf(out);
+        std::cout.clear();
+        if (!started) {
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        for (const auto& workload : workloads) {
+            Result result = measure(port, workload.request, requests);
+            std::cout << std::left << std::setw(22) << workload.name << std::setw(10) << server.ioEngine()
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(14)
+                      << result.allocationsPerRequest << std::setprecision(0) << std::setw(14)
+                      << result.bytesPerRequest << std::endl;
+        }
+
+        out = std::cout.rdbuf(nullptr);
+        server.stop();
+        std::cout.rdbuf(out);
+        std::cout.clear();
+        ++port;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Memory footprint and scan speed of service records at scale.
+// Builds 100k instances (1k service names, a shared pool of hosts, a few
+// metadata keys per instance) twice: with the previous record layout
+// (std::string fields, text status, per-instance unordered_map metadata)
+// and with the compact Service record in a ServiceRegistry. Live heap bytes
+// are tracked through operator new/delete; the scan visits every instance
+// of every name, checks its status and reads its address, as a prober or
+// balancer pass would.
+#include "service_registry.h"
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::atomic<int64_t> liveBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (void* p = std::malloc(size ? size : 1)) {
+        liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (p) {
+        liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Record layout before interning
+struct LegacyService {
+    std::string id;
+    std::string name;
+    std::string host;
+    int port;
+    std::string status;
+    std::unordered_map<std::string, std::string> metadata;
+    std::chrono::system_clock::time_point lastHeartbeat;
+
+    LegacyService(const std::string& id, const std::string& name, const std::string& host, int port)
+        : id(id), name(name), host(host), port(port), status("unknown"),
+          lastHeartbeat(std::chrono::system_clock::now()) {}
+};
+
+struct Instance {
+    std::string id;
+    std::string name;
+    std::string host;
+    int port;
+    bool healthy;
+    std::vector<std::pair<std::string, std::string>> metadata;
+};
+
+std::vector<Instance> makeInstances(int names, int perName, int hosts) {
+    const char* zones[] = {"us-east-1a", "us-east-1b", "us-east-1c"};
+    std::vector<Instance> instances;
+    instances.reserve(static_cast<size_t>(names) * perName);
+    for (int n = 0; n < names; ++n) {
+        std::string name = "checkout-service-" + std::to_string(n);
+        for (int i = 0; i < perName; ++i) {
+            size_t k = instances.size();
+            int h = static_cast<int>(k % hosts);
+            Instance instance;
+            instance.id = name + "-instance-" + std::to_string(i);
+            instance.name = name;
+            instance.host = "10." + std::to_string(h >> 16) + "." + std::to_string((h >> 8) & 255) + "." +
+                            std::to_string(h & 255);
+            instance.port = 8000 + static_cast<int>(k % 1000);
+            instance.healthy = k % 10 != 0;
+            instance.metadata = {{"version", "v1." + std::to_string(n % 7) + ".0"},
+                                 {"zone", zones[k % 3]},
+                                 {"team", "team-" + std::to_string(n % 40)}};
+            instances.push_back(std::move(instance));
+        }
+    }
+    return instances;
+}
+
+template <typename Fn>
+double perSecond(size_t itemsPerPass, int passes, Fn&& pass) {
+    auto start = Clock::now();
+    for (int i = 0; i < passes; ++i) {
+        pass();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return itemsPerPass * passes / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int names = argc > 1 ? std::stoi(argv[1]) : 1000;
+    int perName = argc > 2 ? std::stoi(argv[2]) : 100;
+    int hosts = argc > 3 ? std::stoi(argv[3]) : 20000;
+    int passes = argc > 4 ? std::stoi(argv[4]) : 50;
+
+    std::vector<Instance> instances = makeInstances(names, perName, hosts);
+    std::vector<std::string> serviceNames;
+    for (int n = 0; n < names; ++n) {
+        serviceNames.push_back(instances[static_cast<size_t>(n) * perName].name);
+    }
+    size_t count = instances.size();
+
+    // Previous layout: records indexed by id and by name
+    int64_t before = liveBytes.load();
+    auto legacyById = std::make_unique<std::unordered_map<std::string, std::shared_ptr<LegacyService>>>();
+    auto legacyByName = std::make_unique<std::unordered_map<std::string, std::vector<std::shared_ptr<LegacyService>>>>();
+    for (const auto& instance : instances) {
+        auto service = std::make_shared<LegacyService>(instance.id, instance.name, instance.host, instance.port);
+        service->status = instance.healthy ? "healthy" : "unhealthy";
+        for (const auto& [key, value] : instance.metadata) {
+            service->metadata[key] = value;
+        }
+        (*legacyById)[instance.id] = service;
+        (*legacyByName)[instance.name].push_back(service);
+    }
+    int64_t legacyBytes = liveBytes.load() - before;
+
+    // Compact records, indexed by the registry (id shards, name lists, endpoints)
+    before = liveBytes.load();
+    dcp::ServiceRegistry registry;
+    {
+        dcp::ServiceRegistry::Batch batch(registry);
+        for (const auto& instance : instances) {
+            auto service = std::make_shared<dcp::Service>(instance.id, instance.name, instance.host, instance.port);
+            service->status = instance.healthy ? dcp::ServiceStatus::HEALTHY : dcp::ServiceStatus::UNHEALTHY;
+            service->metadata = dcp::ServiceMetadata::make(instance.metadata);
+            registry.registerService(service);
+        }
+    }
+    int64_t compactBytes = liveBytes.load() - before;
+
+    auto snapshot = registry.snapshot();
+    uint64_t sink = 0;
+    double legacyScan = perSecond(count, passes, [&]() {
+        for (const auto& name : serviceNames) {
+            for (const auto& service : legacyByName->at(name)) {
+                if (service->status == "healthy") {
+                    sink += service->host.size() + service->port;
+                }
+            }
+        }
+    });
+    double recordScan = perSecond(count, passes, [&]() {
+        for (const auto& name : serviceNames) {
+            for (const auto& service : snapshot->servicesByName(name)) {
+                if (service->status == dcp::ServiceStatus::HEALTHY) {
+                    sink += service->address.family() + service->port;
+                }
+            }
+        }
+    });
+    double endpointScan = perSecond(count, passes, [&]() {
+        for (const auto& name : serviceNames) {
+            for (const auto& endpoint : snapshot->endpoints(name)) {
+                if (endpoint.status == dcp::ServiceStatus::HEALTHY) {
+                    sink += endpoint.address.family() + endpoint.port;
+                }
+            }
+        }
+    });
+
+    std::cout << count << " instances, " << names << " names, " << hosts << " hosts; "
+              << "sizeof(Service) " << sizeof(dcp::Service) << " (was " << sizeof(LegacyService) << "), "
+              << dcp::InternedString::poolSize() << " interned strings" << std::endl;
+    std::cout << std::left << std::setw(34) << "layout" << std::right << std::setw(16) << "bytes/instance"
+              << std::setw(20) << "scan instances/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << std::left << std::setw(34) << "strings + map (before)" << std::right << std::setw(16)
+              << static_cast<double>(legacyBytes) / count << std::setw(20) << legacyScan << std::endl;
+    std::cout << std::left << std::setw(34) << "compact registry, record scan" << std::right << std::setw(16)
+              << static_cast<double>(compactBytes) / count << std::setw(20) << recordScan << std::endl;
+    std::cout << std::left << std::setw(34) << "compact registry, endpoint scan" << std::right << std::setw(16)
+              << "" << std::setw(20) << endpointScan << std::endl;
+    return sink == 42 ? 1 : 0;
+}
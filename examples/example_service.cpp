@@ -1,4 +1,5 @@
 #include "http_server.h"
+#include "gossip_member.h"
 #include <nlohmann/json.hpp>
 #include <iostream>
 #include <memory>
@@ -6,10 +7,12 @@
 #include <random>
 #include <thread>
 #include <chrono>
+#include <sstream>
 
 class ExampleService {
 private:
     std::unique_ptr<dcp::HttpServer> server_;
+    std::unique_ptr<dcp::GossipMember> gossip_; // set when the instance joins the gossip group
     std::string serviceId_;
     std::string serviceName_;
     int port_;
@@ -74,8 +77,21 @@ public:
         });
     }
     
+    // Joins the control plane's gossip group under the service id; call before start()
+    void enableGossip(int gossipPort, const std::vector<std::string>& seeds) {
+        dcp::GossipMember::Options options;
+        options.id = serviceId_;
+        options.bindAddress = "0.0.0.0:" + std::to_string(gossipPort);
+        options.seeds = seeds;
+        gossip_ = std::make_unique<dcp::GossipMember>(options);
+    }
+    
     bool start() {
         if (server_->start()) {
+            if (gossip_ && !gossip_->start()) {
+                server_->stop();
+                return false;
+            }
             running_ = true;
             std::cout << serviceName_ << " (" << serviceId_ << ") started on port " << port_ << std::endl;
             return true;
@@ -85,6 +101,9 @@ public:
     
     void stop() {
         if (running_) {
+            if (gossip_) {
+                gossip_->stop(); // tells the group it left, rather than letting it time out
+            }
             server_->stop();
             running_ = false;
             std::cout << serviceName_ << " stopped" << std::endl;
@@ -102,7 +121,13 @@ public:
         std::cout << "    \"id\": \"" << serviceId_ << "\"," << std::endl;
         std::cout << "    \"name\": \"" << serviceName_ << "\"," << std::endl;
         std::cout << "    \"host\": \"localhost\"," << std::endl;
-        std::cout << "    \"port\": " << port_ << std::endl;
+        std::cout << "    \"port\": " << port_ << "," << std::endl;
+        if (gossip_) {
+            std::cout << "    \"metadata\": {\"probe\": \"gossip\"}" << std::endl;
+        } else {
+            std::cout << "    \"metadata\": {\"probe\": \"http\", \"probe_path\": \"/health\", "
+                      << "\"probe_body\": \"healthy\"}" << std::endl;
+        }
         std::cout << "  }'" << std::endl;
         std::cout << std::endl;
     }
@@ -123,8 +148,11 @@ int main(int argc, char* argv[]) {
     
     // Parse command line arguments
     if (argc < 4) {
-        std::cout << "Usage: " << argv[0] << " <service-id> <service-name> <port> [control-plane-url]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <service-id> <service-name> <port> [control-plane-url]"
+                  << " [gossip-port] [gossip-seeds]" << std::endl;
         std::cout << "Example: " << argv[0] << " svc001 UserService 9001 http://localhost:8080" << std::endl;
+        std::cout << "With gossip: " << argv[0] << " svc001 UserService 9001 http://localhost:8080 7947 127.0.0.1:7946"
+                  << std::endl;
         return 1;
     }
     
@@ -132,6 +160,12 @@ int main(int argc, char* argv[]) {
     std::string serviceName = argv[2];
     int port = std::stoi(argv[3]);
     std::string controlPlaneUrl = argc > 4 ? argv[4] : "http://localhost:8080";
+    int gossipPort = argc > 5 ? std::stoi(argv[5]) : 0;
+    std::vector<std::string> gossipSeeds; // comma-separated host:port list
+    std::stringstream seedList(argc > 6 ? argv[6] : "127.0.0.1:7946");
+    for (std::string seed; std::getline(seedList, seed, ',');) {
+        gossipSeeds.push_back(seed);
+    }
     
     std::cout << "=== Example Service ===" << std::endl;
     std::cout << "Service ID: " << serviceId << std::endl;
@@ -141,6 +175,9 @@ int main(int argc, char* argv[]) {
     
     try {
         service = std::make_unique<ExampleService>(serviceId, serviceName, port);
+        if (gossipPort > 0) {
+            service->enableGossip(gossipPort, gossipSeeds);
+        }
         
         if (!service->start()) {
             std::cerr << "Failed to start service" << std::endl;
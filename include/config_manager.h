@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <functional>
 #include <mutex>
 #include <fstream>
 #include <nlohmann/json.hpp>
@@ -12,12 +13,15 @@ private:
     std::unordered_map<std::string, nlohmann::json> config_;
     std::string configFile_;
     mutable std::mutex mutex_;
+    // Called with the lock held after a section is set (null when removed)
+    std::function<void(const std::string&, const nlohmann::json&)> changeListener_;
     
 public:
+    // The file is only read. Sections set at runtime are made durable by the
+    // registry's write-ahead log (CONFIG records), which replays them over it.
     ConfigManager(const std::string& configFile = "config.json");
     
     bool loadConfig();
-    bool saveConfig();
     
     template<typename T>
     T get(const std::string& key, const T& defaultValue = T{}) const;
@@ -31,7 +35,10 @@ public:
     nlohmann::json getSection(const std::string& section) const;
     void setSection(const std::string& section, const nlohmann::json& value);
     
+    nlohmann::json toJson() const;
     std::string toString() const;
+    
+    void setChangeListener(std::function<void(const std::string& section, const nlohmann::json& value)> listener);
 };
 
 // Template implementations
@@ -53,6 +60,9 @@ template<typename T>
 void ConfigManager::set(const std::string& key, const T& value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_[key] = value;
+    if (changeListener_) {
+        changeListener_(key, config_[key]);
+    }
 }
 
 } // namespace dcp
\ No newline at end of file
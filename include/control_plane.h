@@ -1,11 +1,18 @@
 #pragma once
+#include <functional>
 #include <memory>
+#include <vector>
 #include "service_registry.h"
 #include "health_checker.h"
 #include "load_balancer.h"
 #include "config_manager.h"
 #include "monitoring.h"
 #include "http_server.h"
+#include "registry_watch.h"
+#include "lease_reaper.h"
+#include "registry_store.h"
+#include "replicated_registry.h"
+#include "gossip_member.h"
 
 namespace dcp {
 
@@ -17,18 +24,48 @@ private:
     std::shared_ptr<ConfigManager> configManager_;
     std::shared_ptr<Monitoring> monitoring_;
     std::shared_ptr<HttpServer> httpServer_;
+    std::shared_ptr<RegistryWatch> registryWatch_;
+    std::shared_ptr<LeaseReaper> leaseReaper_;
+    std::shared_ptr<RegistryStore> registryStore_; // null when persistence is disabled or clustered
+    std::shared_ptr<ReplicatedRegistry> replicatedRegistry_; // null unless clustered
+    std::shared_ptr<GossipMember> gossip_; // null unless gossip is enabled
     
     bool running_;
     
     void setupRoutes();
+    void recordServerMetrics();
+    bool persistChanges();
+    HttpResponse buildWatchReply(uint64_t revision, bool full);
+    
+    // Registry and config writes: applied here, or through the cluster log
+    // when clustered. `done` gets 200, 500 (not persisted) or 503 (lost to
+    // a change of leader), and for registry writes one result per operation.
+    void applyOperations(const std::vector<RegistryOperation>& operations,
+                         std::function<void(int status, const std::vector<bool>& applied)> done);
+    void applyConfig(const nlohmann::json& sections, std::function<void(int status)> done);
+    // Clustered only: answers writes sent to a follower, and reads from a
+    // member too far behind, with a redirect to the leader
+    bool redirectWrite(const HttpRequest& request, HttpResponse& response);
+    bool redirectStaleRead(const HttpRequest& request, HttpResponse& response);
+    bool redirectToLeader(const HttpRequest& request, HttpResponse& response);
+    // Probe and gossip verdicts: proposed to the cluster log when clustered
+    bool writeServiceStatus(const std::string& serviceId, ServiceStatus status);
+    void handleGossipChange(const GossipMember::Member& member);
     
     // API Handlers
     HttpResponse handleGetServices(const HttpRequest& request);
-    HttpResponse handleRegisterService(const HttpRequest& request);
-    HttpResponse handleUnregisterService(const HttpRequest& request);
+    HttpResponse handleGetService(const HttpRequest& request);
+    void handleWatchServices(const HttpRequest& request, HttpResponder responder);
+    void handleRegisterService(const HttpRequest& request, HttpResponder responder);
+    void handleUnregisterService(const HttpRequest& request, HttpResponder responder);
+    void handleHeartbeat(const HttpRequest& request, HttpResponder responder);
+    void handleBatch(const HttpRequest& request, HttpResponder responder);
     HttpResponse handleGetMetrics(const HttpRequest& request);
     HttpResponse handleGetConfig(const HttpRequest& request);
-    HttpResponse handleUpdateConfig(const HttpRequest& request);
+    void handleUpdateConfig(const HttpRequest& request, HttpResponder responder);
+    HttpResponse handleGetCluster(const HttpRequest& request);
+    HttpResponse handleGetGossip(const HttpRequest& request);
+    HttpResponse handleGetHealth(const HttpRequest& request);
     HttpResponse handleProxyRequest(const HttpRequest& request);
     HttpResponse handleDashboard(const HttpRequest& request);
     
@@ -47,6 +84,8 @@ public:
     std::shared_ptr<ConfigManager> getConfigManager() const { return configManager_; }
     std::shared_ptr<Monitoring> getMonitoring() const { return monitoring_; }
     std::shared_ptr<HttpServer> getHttpServer() const { return httpServer_; }
+    std::shared_ptr<ReplicatedRegistry> getReplicatedRegistry() const { return replicatedRegistry_; }
+    std::shared_ptr<GossipMember> getGossip() const { return gossip_; }
     
     void waitForShutdown();
 };
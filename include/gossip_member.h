@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+
+namespace dcp {
+
+// One member of a SWIM failure-detection group, over UDP.
+//
+// Every protocol period a member pings one other member, taken round-robin
+// from a shuffled list. Without an ack within pingTimeout it asks
+// indirectProbes other members to ping the target for it; without any ack by
+// the end of the period the target becomes suspect. A suspect that does not
+// refute the suspicion, by raising its incarnation number, before the
+// suspicion timeout is declared dead. Membership changes are not sent on
+// their own: they ride on pings and acks, each one on a few times log(n)
+// messages. Each member therefore sends a constant number of messages per
+// period whatever the group size, and a change reaches everyone within
+// O(log n) periods.
+//
+// A joining member pulls the member list from its seeds, and every
+// syncInterval pulls it again from a random member to repair lost updates.
+class GossipMember {
+public:
+    enum class State : uint8_t { ALIVE = 1, SUSPECT = 2, DEAD = 3, LEFT = 4 };
+
+    struct Options {
+        std::string id;
+        std::string bindAddress = "0.0.0.0:7946";
+        // host:port other members send to; the bind address when empty. A
+        // wildcard host is replaced by the source address of our packets.
+        std::string advertiseAddress;
+        std::vector<std::string> seeds; // host:port of members to join through
+        std::chrono::milliseconds protocolPeriod{1000};
+        std::chrono::milliseconds pingTimeout{300};
+        size_t indirectProbes = 3;
+        int suspicionMultiplier = 4;  // suspicion timeout: m * max(1, log10 n) periods
+        int retransmitMultiplier = 4; // a change rides on m * ceil(log10(n + 1)) messages
+        std::chrono::milliseconds syncInterval{30000};   // 0 = only when joining
+        std::chrono::milliseconds deadRetention{300000}; // dead and left members are forgotten after this
+    };
+
+    struct Member {
+        std::string id;
+        std::string address;
+        State state = State::ALIVE;
+        uint64_t incarnation = 0;
+    };
+
+    struct Stats {
+        uint64_t messagesSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t messagesReceived = 0;
+        uint64_t bytesReceived = 0;
+    };
+
+    // Runs on the gossip thread after a member joins or changes state
+    using EventHandler = std::function<void(const Member& member)>;
+
+    GossipMember(const Options& options, EventHandler onChange = nullptr);
+    ~GossipMember();
+    GossipMember(const GossipMember&) = delete;
+    GossipMember& operator=(const GossipMember&) = delete;
+
+    // Binds the socket, contacts the seeds and starts the gossip thread
+    bool start();
+    // Tells a few members this one is leaving, then stops
+    void stop();
+
+    // Every member known, this one first; dead ones until they are forgotten
+    std::vector<Member> members() const;
+    bool find(const std::string& id, Member& member) const;
+    size_t aliveCount() const; // alive or suspect, this member included
+    Stats stats() const;
+    const std::string& id() const { return options_.id; }
+
+    static const char* toString(State state);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Peer {
+        Member member;
+        sockaddr_storage addr;
+        socklen_t addrLen = 0;
+        Clock::time_point changedAt;
+    };
+
+    // Queued news, fewest transmissions first and, among equals, newest first
+    struct Broadcast {
+        int transmits;
+        uint64_t order;
+        Member update;
+        bool operator<(const Broadcast& other) const {
+            return transmits != other.transmits ? transmits < other.transmits : order > other.order;
+        }
+    };
+
+    // A ping sent on behalf of another member's PING_REQ
+    struct Relay {
+        sockaddr_storage requester;
+        socklen_t requesterLen;
+        uint32_t seq; // the requester's
+        Clock::time_point expires;
+    };
+
+    struct Suspicion {
+        Clock::time_point deadline;
+        std::string id;
+        uint64_t incarnation;
+        bool operator>(const Suspicion& other) const { return deadline > other.deadline; }
+    };
+
+    Options options_;
+    EventHandler onChange_;
+    int fd_;
+    int wakeFd_;
+    int family_;
+
+    mutable std::mutex mutex_;
+    std::string address_;
+    uint64_t incarnation_;
+    std::unordered_map<std::string, Peer> peers_;
+    size_t livePeers_; // alive or suspect
+    std::vector<std::string> probeOrder_;
+    size_t probeNext_;
+    std::set<Broadcast> broadcasts_;
+    std::unordered_map<std::string, std::set<Broadcast>::iterator> queued_; // by member id
+    uint64_t broadcastOrder_;
+    std::unordered_map<uint32_t, Relay> relays_;
+    std::priority_queue<Suspicion, std::vector<Suspicion>, std::greater<Suspicion>> suspicions_;
+    std::vector<Member> changes_; // for onChange_, delivered once the lock is released
+    uint32_t nextSeq_;
+    std::mt19937 random_;
+
+    // The probe of the current protocol period
+    std::string probeTarget_;
+    uint32_t probeSeq_;
+    bool probeAcked_;
+    bool indirectSent_;
+    Clock::time_point probeStart_;
+    Clock::time_point periodEnd_;
+    Clock::time_point nextSync_;
+
+    std::atomic<uint64_t> messagesSent_;
+    std::atomic<uint64_t> bytesSent_;
+    std::atomic<uint64_t> messagesReceived_;
+    std::atomic<uint64_t> bytesReceived_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    Member self() const;
+    size_t liveCount() const { return livePeers_; }
+    std::chrono::milliseconds suspicionTimeout() const;
+    bool resolve(const std::string& address, sockaddr_storage& out, socklen_t& length) const;
+
+    void run();
+    void receive();
+    void handlePacket(const char* data, size_t size, const sockaddr_storage& from, socklen_t fromLen);
+    void applyUpdate(Member update, const std::string& sender, const sockaddr_storage& from);
+    void queueBroadcast(const Member& update);
+    void runTimers(Clock::time_point now);
+    void startProbe(Clock::time_point now);
+    void suspect(const Peer& peer);
+    void dispatchChanges(std::unique_lock<std::mutex>& lock);
+
+    std::string header(uint8_t type, uint32_t seq) const;
+    // Appends the update count and as many pending updates as fit, `first` ahead of them
+    void appendBroadcasts(std::string& packet, const Member* first = nullptr);
+    void send(const std::string& packet, const sockaddr_storage& to, socklen_t length);
+    void sendSync(const sockaddr_storage& to, socklen_t length);
+    void requestSync(const sockaddr_storage& to, socklen_t length);
+    std::vector<Peer*> randomPeers(size_t count, const std::string& exclude);
+};
+
+} // namespace dcp
@@ -4,19 +4,106 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <vector>
+#include <mutex>
+#include <random>
+#include <unordered_map>
 #include "service_registry.h"
+#include "health_prober.h"
+#include "timer_wheel.h"
 
 namespace dcp {
 
+// Each instance is checked on its own schedule. A known status flips only
+// after `rise` passes or `fall` failures in a row; while a flip is pending,
+// or once an instance is down, it is re-checked every recheckIntervalMs,
+// backing off towards intervalMs. Instances that keep passing move to
+// stableIntervalMs. Every delay is spread by +/- `jitter` of itself.
+struct HealthCheckConfig {
+    int intervalMs = 30000;
+    int timeoutMs = 5000;
+    int recheckIntervalMs = 2000;
+    int stableIntervalMs = 60000;
+    double jitter = 0.1;
+    uint32_t rise = 2;
+    uint32_t fall = 3;
+    size_t maxConcurrentProbes = 1024; // connects in flight at once
+    size_t maxIdleConnections = 1024;  // kept open for the next HTTP probe
+    bool ioUring = true;               // connect through io_uring when built in and supported, else epoll
+};
+
+// The latest check of one instance
+struct ProbeStats {
+    std::string serviceId;
+    const char* probe;                 // "tcp", "http" or "gossip"
+    ServiceStatus status;
+    uint32_t successes;                // in a row
+    uint32_t failures;
+    std::chrono::microseconds rtt;     // 0 for gossip
+    int httpStatus;                    // 0 when no HTTP response came
+    bool reused;                       // over a pooled connection
+    std::chrono::system_clock::time_point checkedAt;
+};
+
+struct ProbeTotals {
+    uint64_t connectionsOpened = 0;
+    uint64_t connectionsReused = 0;
+    size_t idleConnections = 0;
+};
+
 class HealthChecker {
 private:
     std::shared_ptr<ServiceRegistry> registry_;
     std::atomic<bool> running_;
     std::thread checkerThread_;
-    int checkIntervalMs_;
+    HealthCheckConfig config_;
+    std::function<bool(const std::string&, ServiceStatus)> statusWriter_;
+    std::function<bool(const std::string&, bool&)> externalStatus_;
+    
+    // One per probed or gossip-watched instance
+    struct Instance : std::enable_shared_from_this<Instance> {
+        std::shared_ptr<Service> service; // latest record
+        ServiceStatus status;             // as last seen in the registry or written
+        bool external = false;            // gossip member: read, not probed
+        bool removed = false;             // unregistered while a check was out
+        uint32_t successes = 0;           // in a row
+        uint32_t failures = 0;
+        std::shared_ptr<const HttpCheck> http; // null for connect probes
+        ProbeResult last;
+        std::chrono::system_clock::time_point checkedAt;
+        TimerWheel::Timer nextCheck;
+    };
+    
+    struct Verdict {
+        std::shared_ptr<Instance> instance;
+        bool healthy;
+        ServiceStatus newStatus; // UNKNOWN when the status stays
+    };
+    
+    // Owned by the checker thread
+    std::unique_ptr<HealthProber> prober_;
+    std::unordered_map<std::string, std::shared_ptr<Instance>> instances_;
+    TimerWheel schedule_;
+    std::vector<std::shared_ptr<Instance>> due_; // waiting for a probe slot
+    std::vector<Verdict> verdicts_;              // not yet published
+    size_t pendingChanges_;
+    bool synced_;
+    uint64_t revision_; // registry revision the instances reflect
+    std::mt19937 rng_;
+    
+    // Published for readers on other threads
+    mutable std::mutex statsMutex_;
+    std::unordered_map<std::string, ProbeStats> stats_;
+    ProbeTotals totals_;
     
     void checkServicesHealth();
-    bool performHealthCheck(const std::shared_ptr<Service>& service);
+    void syncInstances();
+    void track(const std::shared_ptr<Service>& service, std::chrono::milliseconds spread);
+    void untrack(const std::string& serviceId);
+    void startChecks();
+    void record(const std::shared_ptr<Instance>& instance, bool healthy, bool confirmed);
+    void publishVerdicts();
+    std::chrono::milliseconds jittered(std::chrono::milliseconds delay);
     
 public:
     HealthChecker(std::shared_ptr<ServiceRegistry> registry, 
@@ -26,6 +113,27 @@ public:
     void start();
     void stop();
     bool isRunning() const { return running_; }
+    
+    // Set before start()
+    void setConfig(const HealthCheckConfig& config) { config_ = config; }
+    const HealthCheckConfig& getConfig() const { return config_; }
+    
+    std::vector<ProbeStats> getProbeStats() const;
+    ProbeTotals getProbeTotals() const;
+    
+    // Status changes go to `writer` instead of the registry (replicated
+    // registries propose them); it returns whether the change was taken.
+    // Set before start().
+    void setStatusWriter(std::function<bool(const std::string& serviceId, ServiceStatus status)> writer) {
+        statusWriter_ = std::move(writer);
+    }
+    
+    // Instances registered with metadata probe=gossip are not probed: their
+    // health is read from `source`, which returns false while it has no
+    // verdict for the instance. Set before start().
+    void setExternalStatus(std::function<bool(const std::string& serviceId, bool& alive)> source) {
+        externalStatus_ = std::move(source);
+    }
 };
 
 } // namespace dcp
\ No newline at end of file
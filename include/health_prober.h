@@ -0,0 +1,151 @@
+#pragma once
+#include "net_address.h"
+#include "timer_wheel.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+
+namespace dcp {
+
+struct ProbeResult {
+    bool healthy = false;
+    bool timedOut = false;
+    int status = 0;      // HTTP status; 0 for connect probes or when no response came
+    bool reused = false; // sent over a pooled keep-alive connection
+    std::chrono::microseconds rtt{0}; // until the verdict
+};
+
+// What an HTTP probe requests and accepts
+struct HttpCheck {
+    std::string path = "/health";
+    std::string host;        // Host header; the address when empty
+    int expectStatus = 0;    // any 2xx when 0
+    std::string expectBody;  // the body must contain it, unless empty
+};
+
+// Event-driven health probes. Keeps up to maxInFlight non-blocking probes
+// outstanding on one epoll set, each with its own deadline in a timer wheel,
+// so a sweep costs about as long as its slowest probes rather than the sum
+// of them, and an unresponsive endpoint holds only its own slot.
+//
+// With io_uring, connects are instead queued on a ring as IORING_OP_CONNECT
+// linked to a timeout for the rest of the probe's deadline. Every connect
+// started between two polls reaches the kernel in one syscall, and the
+// kernel cancels the ones that time out. HTTP exchanges stay on epoll.
+//
+// A connect probe passes once the connection is established. An HTTP probe
+// then sends a GET and checks the response. Its connection is kept open for
+// the next probe of the same endpoint when the response allows it, up to
+// maxIdle idle connections in all. A pooled connection that the endpoint
+// closed while it idled is noticed before reuse; one that fails before any
+// response byte arrives is retried once on a fresh connection.
+//
+// Not thread-safe: one thread starts probes and polls.
+class HealthProber {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(const ProbeResult& result)>;
+
+    explicit HealthProber(size_t maxInFlight = 1024, size_t maxIdle = 1024);
+    ~HealthProber();
+    HealthProber(const HealthProber&) = delete;
+    HealthProber& operator=(const HealthProber&) = delete;
+
+    // Falls back to epoll when `ioUring` is set but the ring cannot be set up
+    bool init(bool ioUring = false);
+
+    // Connects to address:port, failing the probe unless it connects within
+    // `timeout`. `done` runs from a later poll(). Returns false, starting
+    // nothing, when maxInFlight probes are out or no socket can be opened.
+    bool start(const NetAddress& address, uint16_t port, std::chrono::milliseconds timeout, Callback done);
+    // As start(), but the probe passes only on a matching HTTP response
+    bool startHttp(const NetAddress& address, uint16_t port, std::shared_ptr<const HttpCheck> check,
+                   std::chrono::milliseconds timeout, Callback done);
+    // Waits up to `wait` for probes to finish or expire, then runs their callbacks
+    void poll(std::chrono::milliseconds wait);
+    // Fails every unfinished probe, running its callback now
+    void cancelAll();
+
+    size_t inFlight() const { return inFlight_; }
+    size_t pending() const { return inFlight_ + finished_.size(); } // callbacks still to run
+    size_t capacity() const { return probes_.size(); }
+    const char* backend() const { return ring_ ? "io_uring" : "epoll"; }
+    size_t idleConnections() const { return idleCount_; }
+    uint64_t connectionsOpened() const { return opened_; }
+    uint64_t connectionsReused() const { return reused_; }
+
+private:
+    enum class Stage {
+        CONNECTING,
+        SENDING,
+        RECEIVING
+    };
+
+    struct Probe {
+        int fd = -1;
+        bool watched = false; // in the epoll set
+        Stage stage = Stage::CONNECTING;
+        uint32_t generation = 0; // tells ring completions of earlier probes in this slot apart
+        Clock::time_point started;
+        Clock::time_point deadline;
+        TimerWheel::Timer timer;
+        Callback done;
+        sockaddr_storage addr;
+        socklen_t addrLen = 0;
+        // HTTP probes only
+        std::shared_ptr<const HttpCheck> http;
+        std::string key; // endpoint, for the connection pool
+        std::string request;
+        size_t sent = 0;
+        std::string response;
+        bool reused = false;
+    };
+
+    struct IdleConnection {
+        int fd;
+        std::string key;
+        TimerWheel::Timer expiry;
+    };
+
+    struct Ring; // io_uring state, when in use
+
+    int epollFd_;
+    std::unique_ptr<Ring> ring_;
+    std::vector<Probe> probes_; // one slot per probe in flight
+    std::vector<uint32_t> freeSlots_;
+    size_t inFlight_;
+    TimerWheel deadlines_;
+    std::vector<std::pair<Callback, ProbeResult>> finished_; // callbacks for the next poll()
+    std::unordered_map<std::string, std::vector<std::unique_ptr<IdleConnection>>> idle_;
+    TimerWheel idleExpiry_;
+    size_t maxIdle_;
+    size_t idleCount_;
+    uint64_t opened_;
+    uint64_t reused_;
+
+    bool begin(const NetAddress& address, uint16_t port, std::shared_ptr<const HttpCheck> check,
+               std::chrono::milliseconds timeout, Callback done);
+    bool connectProbe(uint32_t slot);
+    bool submitConnect(uint32_t slot);
+    void connected(uint32_t slot, int result);
+    bool watch(uint32_t slot, uint32_t events);
+    void pollEvents(int timeoutMs);
+    void pollRing(int timeoutMs);
+    void handleEvent(uint32_t slot);
+    void sendRequest(uint32_t slot);
+    void receiveResponse(uint32_t slot);
+    void broken(uint32_t slot);
+    void finish(uint32_t slot, bool healthy, bool timedOut, int status = 0, bool keepAlive = false);
+    void runCallbacks();
+    int takeIdle(const std::string& key);
+    void keepIdle(int fd, const std::string& key);
+    void dropIdle(IdleConnection& connection);
+};
+
+} // namespace dcp
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dcp {
+
+// Blocking HTTP/1.1 client for one upstream over a persistent connection.
+//
+// send() and receive() are separate so a caller can pipeline: write several
+// requests, then read their responses in order. request() does both, and
+// retries once on a fresh connection when a reused one turns out to have
+// been closed by the peer. Every socket operation is bounded by the
+// timeout; after any failure the connection is closed and the next call
+// reconnects. Not thread-safe: use one client per thread.
+class HttpClient {
+public:
+    struct Response {
+        int status = 0;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string body;
+
+        std::string_view header(std::string_view name) const; // case-insensitive, empty if absent
+    };
+
+    static constexpr size_t kMaxResponseSize = 64 << 20;
+
+    HttpClient(const std::string& host, uint16_t port, int timeoutMs = 5000);
+    ~HttpClient();
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // Splits "host:port"; false when the port is missing or invalid
+    static bool parseAddress(const std::string& address, std::string& host, uint16_t& port);
+
+    bool connect();
+    void close();
+    bool connected() const { return fd_ >= 0; }
+
+    bool send(std::string_view method, std::string_view target, std::string_view body = std::string_view(),
+              std::string_view contentType = "application/json");
+    bool receive(Response& response);
+    bool request(std::string_view method, std::string_view target, std::string_view body, Response& response,
+                 std::string_view contentType = "application/json");
+
+    const std::string& host() const { return host_; }
+    uint16_t port() const { return port_; }
+    int timeoutMs() const { return timeoutMs_; }
+
+private:
+    std::string host_;
+    uint16_t port_;
+    int timeoutMs_;
+    int fd_;
+    std::string hostHeader_;
+    std::string buffer_;   // received bytes not yet consumed
+    size_t requests_;      // sent on the current connection
+    size_t responses_;     // received on the current connection
+
+    bool fill();           // reads more into buffer_
+    bool readChunked(std::string& body);
+};
+
+} // namespace dcp
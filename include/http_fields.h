@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include "request_arena.h"
+
+namespace dcp {
+
+struct HttpField {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Small flat name/value table used for HTTP headers and request parameters.
+// Entries are string_views kept in insertion order in an inline array that
+// overflows into the request arena; lookups scan linearly, which beats
+// hashing for the dozen or so fields a request carries.
+//
+// Storage comes from the RequestArena current when the table is
+// constructed. A table built outside a request falls back to a small arena
+// of its own, shared with its copies.
+class HttpFields {
+public:
+    static constexpr size_t kInlineFields = 12;
+
+    // Proxy returned by operator[] so `fields["Name"] = value` copies like a map
+    class Ref {
+    private:
+        HttpFields& fields_;
+        std::string_view name_;
+
+    public:
+        Ref(HttpFields& fields, std::string_view name) : fields_(fields), name_(name) {}
+        Ref& operator=(std::string_view value) {
+            fields_.set(name_, value);
+            return *this;
+        }
+        operator std::string_view() const { return fields_.get(name_); }
+    };
+
+    explicit HttpFields(bool ignoreCase = false);
+    HttpFields(const HttpFields& other);
+    HttpFields& operator=(const HttpFields& other);
+
+    // Copies name and value into the table's arena, replacing an existing field
+    void set(std::string_view name, std::string_view value);
+    // Stores the views as given; the caller keeps the bytes alive. A later
+    // field with the same name shadows an earlier one.
+    void append(std::string_view name, std::string_view value);
+    bool erase(std::string_view name);
+    void clear() { size_ = 0; }
+
+    Ref operator[](std::string_view name) { return Ref(*this, name); }
+    const HttpField* find(std::string_view name) const;
+    std::string_view get(std::string_view name, std::string_view fallback = {}) const;
+    std::string_view at(std::string_view name) const; // throws std::out_of_range if absent
+    bool contains(std::string_view name) const { return find(name) != nullptr; }
+    size_t count(std::string_view name) const { return contains(name) ? 1 : 0; }
+
+    const HttpField* begin() const { return fields_; }
+    const HttpField* end() const { return fields_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    HttpField inline_[kInlineFields];
+    HttpField* fields_;
+    size_t size_;
+    size_t capacity_;
+    bool ignoreCase_;
+    RequestArena* arena_;
+    std::shared_ptr<RequestArena> ownArena_;
+
+    bool matches(std::string_view a, std::string_view b) const;
+    RequestArena& storage();
+    void push(std::string_view name, std::string_view value);
+};
+
+} // namespace dcp
@@ -0,0 +1,100 @@
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace dcp {
+
+struct HttpHeaderView {
+    std::string_view name;
+    std::string_view value;
+};
+
+enum class ParseResult {
+    Complete,   // A full request is available
+    NeedMore,   // The buffer ends before the request does
+    Error       // Malformed or oversized request; see errorStatus()
+};
+
+// Incremental HTTP/1.x request parser working directly on a connection's
+// receive buffer. The parser never allocates: it records offsets while
+// scanning and exposes string_view slices of the buffer once a request is
+// complete. Call parse() again with the same (possibly grown) buffer after
+// NeedMore; scanning resumes where it stopped.
+//
+// Chunked bodies are decoded in place, so the buffer must be writable and
+// must not be modified by the caller between parse() calls for the same
+// request. Views are valid until the buffer is modified or reallocated.
+class HttpRequestParser {
+public:
+    static constexpr size_t kMaxHeaders = 64;
+
+    explicit HttpRequestParser(size_t maxRequestSize = 1 << 20);
+
+    ParseResult parse(char* data, size_t length);
+    void reset();
+
+    std::string_view method() const { return slice(method_); }
+    std::string_view target() const { return slice(target_); }
+    std::string_view path() const { return slice(path_); }
+    std::string_view query() const { return slice(query_); }
+    std::string_view version() const { return slice(version_); }
+    std::string_view body() const { return slice(body_); }
+
+    size_t headerCount() const { return headerCount_; }
+    HttpHeaderView header(size_t index) const;
+    std::string_view header(std::string_view name) const; // case-insensitive, empty if absent
+
+    bool keepAlive() const;
+    bool headersComplete() const { return state_ != State::Headers && state_ != State::Failed; }
+    size_t consumed() const { return consumed_; } // wire bytes used by the request
+    int errorStatus() const { return errorStatus_; }
+
+private:
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    enum class State {
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailer,
+        Done,
+        Failed
+    };
+
+    const char* base_;
+    size_t maxRequestSize_;
+    State state_;
+    size_t scanOffset_;
+    size_t bodyStart_;
+    size_t contentLength_;
+    size_t readPos_;      // chunked: next wire byte to decode
+    size_t writePos_;     // chunked: end of decoded body
+    size_t chunkRemaining_;
+    size_t consumed_;
+    int errorStatus_;
+
+    Span method_;
+    Span target_;
+    Span path_;
+    Span query_;
+    Span version_;
+    Span body_;
+    Span headerNames_[kMaxHeaders];
+    Span headerValues_[kMaxHeaders];
+    size_t headerCount_;
+
+    std::string_view slice(const Span& span) const {
+        return std::string_view(base_ + span.offset, span.length);
+    }
+    ParseResult fail(int status);
+    ParseResult parseHead(const char* data, size_t headerEnd);
+    ParseResult parseChunked(char* data, size_t length);
+};
+
+} // namespace dcp
@@ -1,71 +1,199 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <functional>
 #include <unordered_map>
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <chrono>
+#include <sys/types.h>
+#include "thread_pool.h"
+#include "static_file_cache.h"
+#include "router.h"
+#include "http_fields.h"
+#include "request_arena.h"
+#include "timer_wheel.h"
 
 namespace dcp {
 
+// Views into the connection's receive buffer, valid until the handler returns
 struct HttpRequest {
-    std::string method;
-    std::string path;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
-    std::unordered_map<std::string, std::string> params;
+    std::string_view method;
+    std::string_view path;
+    std::string_view query; // as sent, without the '?'
+    std::string_view version;
+    HttpFields headers{true};
+    std::string_view body;
+    // Query parameters plus path parameters captured by the route (`:id`, `*`)
+    HttpFields params;
+};
+
+// File region sent with sendfile(2) instead of an in-memory body
+struct FileBody {
+    int fd = -1;
+    off_t offset = 0;
+    size_t length = 0;
+    
+    FileBody(int fd, off_t offset, size_t length) : fd(fd), offset(offset), length(length) {}
+    ~FileBody();
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
 };
 
 struct HttpResponse {
     int status = 200;
-    std::unordered_map<std::string, std::string> headers;
+    HttpFields headers{true}; // Content-Type defaults to text/html
     std::string body;
     
-    HttpResponse() {
-        headers["Content-Type"] = "text/html";
+    // Alternative body sources, used instead of `body` when set
+    std::shared_ptr<const std::string> sharedBody;  // e.g. cached static assets
+    std::shared_ptr<FileBody> fileBody;
+    // Body produced piece by piece as the socket drains, sent chunked. Each
+    // call appends the next piece to `out` and returns false once nothing
+    // follows. It runs on the connection's event loop thread, so pieces
+    // should be small (tens of KB); it must not throw.
+    std::function<bool(std::string& out)> streamBody;
+    
+    size_t bodySize() const {
+        if (fileBody) return fileBody->length;
+        if (sharedBody) return sharedBody->size();
+        return body.size();
     }
 };
 
-using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+// Completes a request whose route was added with a deferred handler. It may
+// be kept past the handler's return and used from any thread; only the
+// first send() counts, and a responder dropped without sending answers 500.
+// Outstanding responders must be completed or dropped before the server
+// is destroyed.
+class HttpResponder {
+public:
+    HttpResponder() = default;
+    
+    void send(HttpResponse response);
+    explicit operator bool() const { return state_ != nullptr; }
+    
+private:
+    friend class HttpServer;
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+struct HttpServerConfig {
+    int workerThreads = 0;          // 0 = one per hardware thread
+    int listeners = 1;              // SO_REUSEPORT listeners, each with its own event loop thread
+    bool pinListenerThreads = false; // pin listener N's event loop to CPU N
+    int backlog = 0;                // listen(2) backlog, 0 = SOMAXCONN
+    int maxEvents = 256;            // epoll_wait batch size
+    size_t maxRequestSize = 1 << 20; // headers + body
+    int keepAliveTimeoutMs = 5000;  // idle time before a persistent connection is closed
+    int headerTimeoutMs = 10000;    // from a request's first byte until its headers are in
+    int bodyTimeoutMs = 30000;      // from the end of the headers until the body is in
+    int writeTimeoutMs = 30000;     // without the client accepting any response bytes
+    int maxRequestsPerConnection = 1000;
+    size_t maxQueuedRequests = 1024; // admitted but unstarted requests, 0 = unbounded
+    int retryAfterSeconds = 1;      // Retry-After sent with 503 when shedding load
+    bool ioUring = true;            // use io_uring when built in and supported by the kernel, else epoll
+};
+
+// Connection deadlines, tracked per event loop in a timer wheel (0 ms disables one)
+enum class ConnectionTimeout { HEADER = 0, BODY = 1, IDLE = 2, WRITE = 3 };
+constexpr size_t kConnectionTimeoutKinds = 4;
+
+// Admission control and timeout counters, sampled by getStats()
+struct HttpServerStats {
+    size_t queueDepth[ThreadPool::kPriorityLevels] = {}; // per RoutePriority
+    uint64_t shedQueueFull = 0;   // rejected because the priority's queue share was full
+    uint64_t shedRouteLimit = 0;  // rejected by a route's maxConcurrency
+    uint64_t timeouts[kConnectionTimeoutKinds] = {}; // connections closed, per ConnectionTimeout
+};
 
 class HttpServer {
 private:
+    struct Connection;
+    struct EventLoop;
+    struct Completion;
+    
     int port_;
     std::atomic<bool> running_;
-    std::thread serverThread_;
-    std::unordered_map<std::string, HttpHandler> routes_;
+    HttpServerConfig config_;
+    std::vector<std::shared_ptr<EventLoop>> loops_; // shared with outstanding responders
+    std::unique_ptr<ThreadPool> workers_;
+    Router router_;
     std::string staticDir_;
+    std::unique_ptr<StaticFileCache> staticCache_;
+    std::atomic<uint64_t> shedQueueFull_;
+    std::atomic<uint64_t> shedRouteLimit_;
+    std::atomic<uint64_t> timeouts_[kConnectionTimeoutKinds] = {};
+    bool ioUring_;
     
-    void serverLoop();
-    void handleConnection(int clientSocket);
-    HttpRequest parseRequest(const std::string& requestStr);
-    std::string buildResponse(const HttpResponse& response);
-    HttpResponse handleStaticFile(const std::string& path);
+    int openListener(bool reusePort);
+    void serverLoop(EventLoop& loop);
+    void serverLoopUring(EventLoop& loop);
+    void handleUringCompletion(EventLoop& loop, uint64_t userData, int result, uint32_t flags);
+    void armRecv(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    void watchConnection(EventLoop& loop, const std::shared_ptr<Connection>& conn, uint32_t events);
+    void acceptConnections(EventLoop& loop);
+    void handleReadable(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    void processInput(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    void handleWritable(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    static void nextChunk(Connection& conn);
+    void drainCompletions(EventLoop& loop);
+    void closeConnection(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    void armTimeout(EventLoop& loop, Connection& conn, ConnectionTimeout kind);
+    void expireTimers(EventLoop& loop);
+    void handleTimeout(EventLoop& loop, const std::shared_ptr<Connection>& conn);
+    void dispatchRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn,
+                         HttpRequest request, bool keepAlive);
+    void rejectRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, int status);
+    void shedRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, bool keepAlive);
+    HttpResponse executeRequest(const Route* route, const HttpRequest& request);
+    void completeRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, Route* route,
+                         bool keepAlive, HttpResponse response);
+    void sendResponse(EventLoop& loop, const std::shared_ptr<Connection>& conn,
+                      std::string_view head, HttpResponse response, bool keepAlive);
+    std::string_view buildResponseHead(const HttpResponse& response, RequestArena& arena);
+    HttpResponse handleStaticFile(const HttpRequest& request);
     
 public:
     HttpServer(int port = 8080);
     ~HttpServer();
     
-    void addRoute(const std::string& method, const std::string& path, HttpHandler handler);
-    void setStaticDirectory(const std::string& dir) { staticDir_ = dir; }
+    void addRoute(const std::string& method, const std::string& path, HttpHandler handler,
+                  RoutePolicy policy = RoutePolicy());
+    void addDeferredRoute(const std::string& method, const std::string& path, HttpDeferredHandler handler,
+                          RoutePolicy policy = RoutePolicy());
+    void setStaticDirectory(const std::string& dir);
+    void setConfig(const HttpServerConfig& config) { config_ = config; }
+    const HttpServerConfig& getConfig() const { return config_; }
     
     bool start();
     void stop();
     bool isRunning() const { return running_; }
     int getPort() const { return port_; }
+    HttpServerStats getStats() const;
+    const char* ioEngine() const { return ioUring_ ? "io_uring" : "epoll"; }
     
     // Convenience methods for common HTTP methods
-    void get(const std::string& path, HttpHandler handler) { 
-        addRoute("GET", path, handler); 
+    void get(const std::string& path, HttpHandler handler, RoutePolicy policy = RoutePolicy()) { 
+        addRoute("GET", path, handler, policy); 
+    }
+    void post(const std::string& path, HttpHandler handler, RoutePolicy policy = RoutePolicy()) { 
+        addRoute("POST", path, handler, policy); 
+    }
+    void put(const std::string& path, HttpHandler handler, RoutePolicy policy = RoutePolicy()) { 
+        addRoute("PUT", path, handler, policy); 
     }
-    void post(const std::string& path, HttpHandler handler) { 
-        addRoute("POST", path, handler); 
+    void del(const std::string& path, HttpHandler handler, RoutePolicy policy = RoutePolicy()) { 
+        addRoute("DELETE", path, handler, policy); 
     }
-    void put(const std::string& path, HttpHandler handler) { 
-        addRoute("PUT", path, handler); 
+    void getDeferred(const std::string& path, HttpDeferredHandler handler, RoutePolicy policy = RoutePolicy()) {
+        addDeferredRoute("GET", path, handler, policy);
     }
-    void del(const std::string& path, HttpHandler handler) { 
-        addRoute("DELETE", path, handler); 
+    void postDeferred(const std::string& path, HttpDeferredHandler handler, RoutePolicy policy = RoutePolicy()) {
+        addDeferredRoute("POST", path, handler, policy);
     }
 };
 
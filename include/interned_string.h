@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+namespace dcp {
+
+// Handle to a canonical, process-wide copy of a string. Equal texts share
+// one copy, so a handle is a single pointer and compares in O(1).
+//
+// Interned texts are never freed: use this only for values drawn from a
+// bounded set, such as service names, hosts and metadata keys.
+class InternedString {
+private:
+    const std::string* value_;
+
+public:
+    InternedString();
+    InternedString(const std::string& text);
+    InternedString(const char* text);
+
+    const std::string& str() const { return *value_; }
+    operator const std::string&() const { return *value_; }
+    const char* c_str() const { return value_->c_str(); }
+    size_t size() const { return value_->size(); }
+    bool empty() const { return value_->empty(); }
+
+    bool operator==(const InternedString& other) const { return value_ == other.value_; }
+    bool operator!=(const InternedString& other) const { return value_ != other.value_; }
+
+    // Number of distinct texts interned so far
+    static size_t poolSize();
+
+    friend struct std::hash<InternedString>;
+};
+
+inline bool operator==(const InternedString& a, const std::string& b) { return a.str() == b; }
+inline bool operator==(const std::string& a, const InternedString& b) { return a == b.str(); }
+inline bool operator!=(const InternedString& a, const std::string& b) { return a.str() != b; }
+inline bool operator!=(const std::string& a, const InternedString& b) { return a != b.str(); }
+
+std::ostream& operator<<(std::ostream& out, const InternedString& text);
+
+} // namespace dcp
+
+template <>
+struct std::hash<dcp::InternedString> {
+    size_t operator()(const dcp::InternedString& text) const {
+        return std::hash<const std::string*>()(text.value_);
+    }
+};
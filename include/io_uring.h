@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+namespace dcp {
+
+// Minimal io_uring wrapper over the raw syscalls (liburing is not required).
+// One ring is owned and driven by a single thread. Prepared entries are
+// queued in the shared submission ring and handed to the kernel together by
+// the next submit()/wait(), so a batch of operations costs one syscall.
+class IoUring {
+private:
+    int ringFd_ = -1;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    unsigned pending_ = 0; // prepared but not yet submitted
+    unsigned features_ = 0;
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize);
+
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Returns false if the kernel has no usable io_uring (old kernel, seccomp, ...)
+    bool init(unsigned entries);
+
+    // Returns a zeroed entry with the opcode, fd and user data filled in; the
+    // caller sets the op-specific fields. Flushes to the kernel when full.
+    io_uring_sqe* prepare(uint8_t opcode, int fd, uint64_t userData);
+
+    // Free submission entries; prepare() flushes the ring once none are left
+    unsigned space() const { return sqEntries_ - (*sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)); }
+
+    int submit();
+    // Submits pending entries and waits for at least one completion or the timeout
+    int wait(int timeoutMs);
+
+    // Visits every available completion, then releases them to the kernel
+    template <typename Handler>
+    unsigned forEachCompletion(Handler&& handler) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            // Copy out first: the handler may prepare entries that flush the ring
+            io_uring_cqe cqe = cqes_[head & cqMask_];
+            __atomic_store_n(cqHead_, ++head, __ATOMIC_RELEASE);
+            handler(cqe);
+            ++count;
+            tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        }
+        return count;
+    }
+
+    // Whether io_uring can be used on this host at all
+    static bool supported();
+};
+
+} // namespace dcp
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "service_registry.h"
+#include "monitoring.h"
+
+namespace dcp {
+
+// Drives the registry's lease wheel: sleeps until the next lease is due,
+// expires it, and counts expirations and evictions in Monitoring.
+class LeaseReaper {
+private:
+    std::shared_ptr<ServiceRegistry> registry_;
+    std::shared_ptr<Monitoring> monitoring_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    
+    void run();
+    
+public:
+    static constexpr int kMaxSleepMs = 250; // bounds the delay for leases added while asleep
+    
+    LeaseReaper(std::shared_ptr<ServiceRegistry> registry, std::shared_ptr<Monitoring> monitoring);
+    ~LeaseReaper();
+    
+    void start();
+    void stop();
+    bool isRunning() const { return running_; }
+};
+
+} // namespace dcp
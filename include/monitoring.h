@@ -30,6 +30,9 @@ public:
                          const std::unordered_map<std::string, std::string>& labels = {});
     void setGauge(const std::string& name, double value,
                   const std::unordered_map<std::string, std::string>& labels = {});
+    // Publishes a counter maintained elsewhere (e.g. an atomic in the HTTP server)
+    void setCounter(const std::string& name, double value,
+                    const std::unordered_map<std::string, std::string>& labels = {});
     void recordHistogram(const std::string& name, double value,
                         const std::unordered_map<std::string, std::string>& labels = {});
     
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+
+namespace dcp {
+
+// IPv4 or IPv6 address parsed once from its text form, so probes and
+// balancers can build a sockaddr without going through inet_pton again.
+class NetAddress {
+private:
+    uint8_t family_;     // AF_INET, AF_INET6, or 0 when not an IP literal
+    uint8_t bytes_[16];  // network byte order; the first 4 for IPv4
+
+public:
+    NetAddress();
+
+    // Invalid unless `text` is a numeric IPv4 or IPv6 address
+    static NetAddress parse(const std::string& text);
+    // From a stored family() and bytes(); invalid for an unknown family
+    static NetAddress fromBytes(int family, const uint8_t* bytes);
+
+    bool valid() const { return family_ != 0; }
+    int family() const { return family_; }
+    const uint8_t* bytes() const { return bytes_; }
+
+    // Fills `out` for connect(); returns the address length, 0 when invalid
+    socklen_t toSockaddr(uint16_t port, sockaddr_storage& out) const;
+    std::string toString() const;
+
+    bool operator==(const NetAddress& other) const;
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+} // namespace dcp
@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "write_ahead_log.h"
+
+namespace dcp {
+
+class HttpClient;
+
+// One member of a Raft group: leader election, log replication and log
+// compaction through snapshots, for a state machine supplied by the caller.
+//
+// Members reach each other over HTTP: the owner routes POST /raft/vote,
+// /raft/append and /raft/snapshot to the handle* methods, whose request and
+// response bodies are binary. Each peer is served by its own thread and
+// keep-alive connection. A leader sends AppendEntries batches of up to
+// maxBatchBytes and keeps up to maxInflight of them in flight on the
+// connection, so replication is not paced by round trips.
+//
+// The log, current term and vote are kept in a WriteAheadLog in
+// `directory`; a follower syncs it before answering, and the leader counts
+// its own entries towards a majority once they are synced (the leader's
+// syncs group-commit whatever was proposed meanwhile). Once snapshotEntries
+// entries have been applied, the state machine writes a snapshot and the
+// log before it is dropped; followers too far behind receive the snapshot.
+//
+// Elections use pre-votes, and members that heard from a leader within the
+// election timeout refuse to vote, so a member rejoining after a partition
+// does not depose a working leader. A leader that loses contact with a
+// majority for an election timeout steps down.
+class RaftNode {
+public:
+    struct Options {
+        std::string id;
+        std::map<std::string, std::string> members; // id -> host:port, this member included
+        std::string directory = "data/raft";
+        FsyncPolicy fsync = FsyncPolicy::ALWAYS;
+        std::chrono::milliseconds heartbeatInterval{50};
+        std::chrono::milliseconds electionTimeout{500}; // randomized within [t, 2t)
+        uint64_t snapshotEntries = 10000; // applied entries between snapshots, 0 = never
+        size_t maxBatchBytes = 256 * 1024; // of commands per AppendEntries
+        size_t maxInflight = 4;            // pipelined AppendEntries per peer
+    };
+
+    // The replicated state. apply() is called on one thread, in log order;
+    // the snapshot calls are made on that thread too, between applies.
+    struct StateMachine {
+        std::function<std::string(uint64_t index, const std::string& command)> apply;
+        // Writes the state after entry `index` (of `term`) to `path`
+        std::function<bool(const std::string& path, uint64_t index, uint64_t term)> saveSnapshot;
+        // Replaces the state with the snapshot at `path`, reporting where it was taken
+        std::function<bool(const std::string& path, uint64_t& index, uint64_t& term)> loadSnapshot;
+    };
+
+    enum class Role { FOLLOWER, PRE_CANDIDATE, CANDIDATE, LEADER };
+
+    // COMMITTED: applied here, with the state machine's result.
+    // LOST: leadership changed (or the node stopped) first; the entry may
+    // or may not commit later.
+    enum class Outcome { COMMITTED, LOST };
+    using Callback = std::function<void(Outcome outcome, const std::string& result)>;
+
+    struct Status {
+        std::string id;
+        Role role = Role::FOLLOWER;
+        uint64_t term = 0;
+        std::string leader;
+        uint64_t firstIndex = 0; // oldest entry still in the log
+        uint64_t lastIndex = 0;
+        uint64_t commitIndex = 0;
+        uint64_t lastApplied = 0;
+        uint64_t snapshotIndex = 0;
+        uint64_t snapshots = 0;  // taken or installed since start
+        struct Peer {
+            std::string id;
+            uint64_t matchIndex = 0;
+            uint64_t nextIndex = 0;
+            int64_t lastAckMs = -1; // leader only; -1 when never acked
+        };
+        std::vector<Peer> peers;
+    };
+
+    RaftNode(const Options& options, StateMachine stateMachine);
+    ~RaftNode();
+    RaftNode(const RaftNode&) = delete;
+    RaftNode& operator=(const RaftNode&) = delete;
+
+    // Loads the snapshot and log, then starts the member's threads
+    bool start();
+    // Stops the threads; outstanding proposals complete as LOST
+    void stop();
+
+    // Appends `command` to the log when this member leads; false otherwise.
+    // `done` runs on the apply thread (or the caller's, when the proposal is
+    // refused it does not run at all) and must not block for long.
+    bool propose(std::string command, Callback done = nullptr);
+
+    std::string handleVote(std::string_view request);
+    std::string handleAppend(std::string_view request);
+    std::string handleSnapshot(std::string_view request);
+
+    bool isLeader() const;
+    std::string leaderId() const;
+    // host:port of the leader, empty while there is none
+    std::string leaderAddress() const;
+    // Whether this member's applied state is known to be at most
+    // `maxStaleness` behind the leader's committed state
+    bool readable(std::chrono::milliseconds maxStaleness) const;
+    Status status() const;
+
+    static const char* toString(Role role);
+
+private:
+    struct Entry {
+        uint64_t term;
+        std::string command; // empty for the no-op a new leader appends
+    };
+
+    struct Peer {
+        std::string id;
+        std::string host;
+        uint16_t port = 0;
+        uint64_t nextIndex = 1;
+        uint64_t matchIndex = 0;
+        uint64_t voteRound = 0; // election round a vote was last requested in
+        std::chrono::steady_clock::time_point lastAck; // send time of the newest acked request
+        std::thread thread;
+    };
+
+    struct Pending {
+        uint64_t term;
+        Callback done;
+    };
+
+    Options options_;
+    StateMachine stateMachine_;
+    WriteAheadLog wal_;
+    std::string snapshotPath_;
+    size_t quorum_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable peerWake_;  // new entries, role changes
+    std::condition_variable applyWake_; // commits, lost proposals
+    std::condition_variable tickWake_;  // leader entries to sync
+
+    // Persistent state (guarded by mutex_)
+    uint64_t currentTerm_;
+    std::string votedFor_;
+    uint64_t baseIndex_; // the log starts after this entry
+    uint64_t baseTerm_;
+    std::deque<Entry> log_;
+    uint64_t snapshotIndex_;
+    uint64_t snapshotTerm_;
+
+    // Volatile state (guarded by mutex_)
+    Role role_;
+    std::string leaderId_;
+    uint64_t commitIndex_;
+    uint64_t lastApplied_;
+    uint64_t electionRound_;
+    size_t votes_;
+    bool electionReady_; // own vote durable, requests may go out
+    bool preVoteWon_;
+    std::chrono::steady_clock::time_point electionDeadline_;
+    std::chrono::steady_clock::time_point lastContact_; // follower: last message from the leader
+    std::chrono::steady_clock::time_point leaderSince_;
+    uint64_t leaderStartIndex_; // the new leader's no-op
+    uint64_t durableIndex_;     // leader: own log synced through here
+    bool syncPending_;
+    std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> freshness_; // follower: commit index, when heard
+    std::map<uint64_t, Pending> pending_;
+    std::vector<Callback> lost_;
+    std::vector<std::unique_ptr<Peer>> peers_;
+    std::mt19937 random_;
+    std::atomic<uint64_t> snapshots_;
+
+    // Snapshot being received (guarded by mutex_)
+    int receiveFd_;
+    uint64_t receiveIndex_;
+    uint64_t receiveTerm_;
+    uint64_t receiveOffset_;
+
+    std::mutex applyMutex_; // held while the state machine changes
+    std::atomic<bool> running_;
+    std::thread tickThread_;
+    std::thread applyThread_;
+
+    uint64_t lastIndex() const { return baseIndex_ + log_.size(); }
+    uint64_t termAt(uint64_t index) const; // 0 when not in the log
+    const Entry& entryAt(uint64_t index) const { return log_[index - baseIndex_ - 1]; }
+    bool logUpToDate(uint64_t lastIndex, uint64_t lastTerm) const;
+    void resetElectionDeadline();
+
+    void persistState();
+    void persistEntry(uint64_t index, const Entry& entry);
+    void rewriteLog();
+    bool recover();
+
+    void becomeFollower(uint64_t term);
+    void becomeLeader();
+    void advanceCommit();
+    void failPending();
+    bool quorumContact(std::chrono::steady_clock::time_point since) const;
+    void pruneFreshness();
+
+    void runTicker();
+    void runApply();
+    void runPeer(Peer& peer);
+    void requestVote(Peer& peer, HttpClient& client, std::unique_lock<std::mutex>& lock);
+    bool sendSnapshot(Peer& peer, HttpClient& client, std::unique_lock<std::mutex>& lock);
+    void takeSnapshot();
+    bool installSnapshot(const std::string& path, uint64_t index, uint64_t term);
+};
+
+} // namespace dcp
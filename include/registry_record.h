@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "service_registry.h"
+
+namespace dcp {
+
+// Binary encoding of registry and config changes, shared by the
+// write-ahead log and replication. Every record starts with its type;
+// registry records then carry the revision they were made at (0 when
+// they have none yet).
+enum class RecordType : uint8_t {
+    REGISTER = 1,
+    UNREGISTER = 2,
+    STATUS = 3,
+    CONFIG = 4,
+    HEARTBEAT = 5 // replication only; lease renewals are not logged
+};
+
+class RecordWriter {
+public:
+    explicit RecordWriter(std::string& out) : out_(out) {}
+
+    template <typename T>
+    void put(T value) {
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        out_.append(value);
+    }
+
+private:
+    std::string& out_;
+};
+
+class RecordReader {
+public:
+    RecordReader(const char* data, size_t size) : p_(data), end_(data + size), ok_(true) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, p_, sizeof(T));
+        p_ += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t size = get<uint32_t>();
+        if (!ok_ || static_cast<size_t>(end_ - p_) < size) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string value(p_, size);
+        p_ += size;
+        return value;
+    }
+
+    // The rest of the input, unread
+    std::string_view rest() const { return std::string_view(p_, static_cast<size_t>(end_ - p_)); }
+    bool ok() const { return ok_; }
+    // Everything read, nothing left over
+    bool complete() const { return ok_ && p_ == end_; }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_;
+};
+
+// One decoded record; which members are set depends on `type`
+struct RegistryRecord {
+    RecordType type = RecordType::REGISTER;
+    uint64_t revision = 0;
+    std::string id;                   // UNREGISTER, STATUS, HEARTBEAT
+    std::shared_ptr<Service> service; // REGISTER
+    ServiceStatus status = ServiceStatus::UNKNOWN; // STATUS
+    std::string section;              // CONFIG
+    nlohmann::json value;             // CONFIG; null removes the section
+};
+
+void encodeService(const Service& service, uint64_t revision, std::string& out);
+void encodeUnregister(const std::string& id, uint64_t revision, std::string& out);
+void encodeStatus(const std::string& id, ServiceStatus status, uint64_t revision, std::string& out);
+void encodeHeartbeat(const std::string& id, std::string& out);
+void encodeConfig(const std::string& section, const nlohmann::json& value, std::string& out);
+// The record for a change the registry published
+void encodeEvent(const RegistryEvent& event, std::string& out);
+
+// False when the record is truncated, malformed or of an unknown type
+bool decodeRecord(const char* data, size_t size, RegistryRecord& record);
+
+} // namespace dcp
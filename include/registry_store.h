@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include "service_registry.h"
+#include "config_manager.h"
+#include "write_ahead_log.h"
+
+namespace dcp {
+
+// Durable registry and runtime configuration.
+//
+// Every registry change the registry publishes, and every config section
+// set at runtime, is appended to a write-ahead log as it happens. Writers
+// that must not acknowledge a change before it is durable call sync(),
+// which group-commits the log. A background thread flushes the log on an
+// interval and, once the log has grown past a threshold, writes a snapshot
+// (registry.snapshot, see SnapshotFile) and drops the log segments it covers.
+//
+// recover() loads the snapshot, replays the log tail on top of it and
+// resumes the registry at the last logged revision.
+class RegistryStore {
+public:
+    struct Options {
+        std::string directory = "data";
+        FsyncPolicy fsync = FsyncPolicy::ALWAYS;
+        std::chrono::milliseconds flushInterval{100};
+        uint64_t snapshotAfterBytes = 64ull * 1024 * 1024; // of log since the last snapshot; 0 = never
+    };
+
+    struct RecoveryStats {
+        size_t snapshotRecords = 0; // services and config sections
+        size_t logRecords = 0;   // replayed from the log
+        uint64_t revision = 0;   // registry revision after recovery
+        double seconds = 0;
+    };
+
+private:
+    std::shared_ptr<ServiceRegistry> registry_;
+    std::shared_ptr<ConfigManager> config_;
+    Options options_;
+    WriteAheadLog wal_;
+
+    // Config sections set at runtime; they are applied over the config file on recovery
+    std::mutex configMutex_;
+    std::map<std::string, nlohmann::json> configOverrides_;
+
+    std::mutex checkpointMutex_; // one snapshot at a time
+    std::atomic<uint64_t> snapshots_;
+    RecoveryStats recovery_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+
+    std::string snapshotPath() const;
+    bool loadSnapshot(uint64_t& revision, uint64_t& firstSegment);
+    bool loadLegacySnapshot(const std::string& content, uint64_t& revision, uint64_t& firstSegment);
+    bool applyRecord(const char* data, size_t size, uint64_t skipThrough, uint64_t& revision);
+    void run();
+
+public:
+    RegistryStore(std::shared_ptr<ServiceRegistry> registry, std::shared_ptr<ConfigManager> config,
+                  const Options& options);
+    ~RegistryStore();
+
+    // Before start(): restores the registry and config from disk
+    bool recover();
+    // Starts logging changes and the flush/snapshot thread
+    void start();
+    // Stops logging and leaves a snapshot behind, so the next start replays nothing
+    void stop();
+
+    // Waits until every change logged so far is as durable as the fsync policy promises
+    bool sync();
+    // Writes a snapshot now and drops the log it covers
+    bool checkpoint();
+
+    const RecoveryStats& lastRecovery() const { return recovery_; }
+    uint64_t logBytes() const { return wal_.segmentBytes(); }
+    uint64_t syncCount() const { return wal_.syncCount(); }
+    uint64_t snapshotCount() const { return snapshots_.load(); }
+};
+
+} // namespace dcp
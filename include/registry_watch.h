@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "service_registry.h"
+#include "http_server.h"
+
+namespace dcp {
+
+// Long-poll watches on the registry change log.
+//
+// A watch names the last revision its client has seen. If the registry has
+// logged changes past it, the watch is answered at once; otherwise it is
+// parked until a change is logged or its timeout passes. Parked watches are
+// answered from one thread, and watches that saw the same revision share
+// one built reply, so serialization cost follows the number of changes
+// rather than the number of watchers.
+class RegistryWatch {
+public:
+    // Builds the reply for a client that has seen `revision`
+    using ReplyBuilder = std::function<HttpResponse(uint64_t revision)>;
+
+private:
+    struct Watcher {
+        uint64_t revision;
+        std::chrono::steady_clock::time_point deadline;
+        HttpResponder responder;
+    };
+
+    std::shared_ptr<ServiceRegistry> registry_;
+    ReplyBuilder buildReply_;
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Watcher> watchers_;
+    uint64_t latestRevision_;
+    bool running_;
+
+    void run();
+
+public:
+    RegistryWatch(std::shared_ptr<ServiceRegistry> registry, ReplyBuilder buildReply);
+    ~RegistryWatch();
+
+    void start();
+    // Answers every parked watch before returning
+    void stop();
+
+    void watch(uint64_t revision, std::chrono::milliseconds timeout, HttpResponder responder);
+    size_t parkedWatchers() const;
+};
+
+} // namespace dcp
@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "service_registry.h"
+#include "config_manager.h"
+#include "raft_node.h"
+
+namespace dcp {
+
+// The registry and runtime config kept consistent across a cluster of
+// control planes, as the state machine of a RaftNode.
+//
+// Writes are submitted on the leader as log entries. An entry is a run of
+// length-prefixed registry records (see registry_record.h), applied as one
+// registry batch on every member once it commits; heartbeats are entries
+// too, so every member's leases stay current. Lease expiry and probe results
+// are proposed by the leader only: on the other members the registry hands
+// due leases back here instead of changing, and the change arrives through
+// the log. Snapshots are SnapshotFiles whose config blob also records the
+// log position they were taken at.
+class ReplicatedRegistry {
+public:
+    struct Options {
+        RaftNode::Options raft;
+        std::chrono::milliseconds maxStaleness{1000}; // for reads served by followers
+    };
+
+    // Runs once the change is applied here (committed) or is lost to a
+    // change of leader; `applied` holds one result per record submitted
+    using Completion = std::function<void(bool committed, const std::vector<bool>& applied)>;
+
+private:
+    std::shared_ptr<ServiceRegistry> registry_;
+    std::shared_ptr<ConfigManager> config_;
+    Options options_;
+    std::unique_ptr<RaftNode> node_;
+
+    // Config sections set through the log, as in RegistryStore
+    std::mutex configMutex_;
+    std::map<std::string, nlohmann::json> configOverrides_;
+
+    bool propose(std::string command, size_t records, Completion done);
+    std::string apply(const std::string& command);
+    bool saveSnapshot(const std::string& path, uint64_t index, uint64_t term);
+    bool loadSnapshot(const std::string& path, uint64_t& index, uint64_t& term);
+
+public:
+    ReplicatedRegistry(std::shared_ptr<ServiceRegistry> registry, std::shared_ptr<ConfigManager> config,
+                       const Options& options);
+    ~ReplicatedRegistry();
+
+    // Restores the state from disk and joins the cluster
+    bool start();
+    void stop();
+
+    // False, without calling `done`, when this member does not lead
+    bool submit(const std::vector<RegistryOperation>& operations, Completion done);
+    // Sets each section of the `sections` object (null removes one)
+    bool submitConfig(const nlohmann::json& sections, Completion done);
+    // Probe results and lease expiry; taken only on the leader
+    bool proposeStatus(const std::string& serviceId, ServiceStatus status);
+    bool proposeLeaseExpiry(const std::string& serviceId, bool evict);
+
+    RaftNode& node() { return *node_; }
+    bool isLeader() const { return node_->isLeader(); }
+    std::string leaderAddress() const { return node_->leaderAddress(); }
+    // Whether reads served here are within the staleness bound
+    bool readable() const { return node_->readable(options_.maxStaleness); }
+    nlohmann::json status() const;
+};
+
+} // namespace dcp
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace dcp {
+
+// Bump allocator for everything built while serving one request: header
+// and parameter tables, copied header values and the response head.
+// Memory is only reclaimed all at once by reset(), which keeps the first
+// block so a reused arena serves typical requests without touching the heap.
+//
+// An arena is used by one thread at a time. The server makes the
+// connection's arena current for the thread working on its request, and
+// containers such as HttpFields pick it up from there.
+class RequestArena {
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t blockSize_;
+    size_t offset_;   // next free byte in blocks_.back()
+    size_t used_;
+
+public:
+    static constexpr size_t kDefaultBlockSize = 4096;
+
+    explicit RequestArena(size_t blockSize = kDefaultBlockSize);
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // Alignment may not exceed alignof(std::max_align_t)
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    std::string_view copy(std::string_view text);
+    void reset();
+
+    size_t bytesUsed() const { return used_; } // since the last reset
+
+    // Arena of the request the calling thread is working on, or nullptr
+    static RequestArena* current();
+
+    // Makes an arena current for the enclosing block
+    class Scope {
+    private:
+        RequestArena* previous_;
+
+    public:
+        explicit Scope(RequestArena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+} // namespace dcp
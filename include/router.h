@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+namespace dcp {
+
+struct HttpRequest;
+struct HttpResponse;
+class HttpResponder;
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+// Answers through the responder, possibly after returning (e.g. long polls)
+using HttpDeferredHandler = std::function<void(const HttpRequest&, HttpResponder)>;
+
+// Admission priority; lower values are served first and shed last
+enum class RoutePriority {
+    HIGH = 0,    // registration, heartbeats, config writes
+    NORMAL = 1,
+    LOW = 2      // dashboard, metrics scrapes, static files
+};
+
+struct RoutePolicy {
+    RoutePriority priority = RoutePriority::NORMAL;
+    int maxConcurrency = 0; // requests of this route queued or running at once, 0 = unlimited
+};
+
+struct Route {
+    std::string method;
+    std::string pattern;
+    HttpHandler handler;
+    HttpDeferredHandler deferredHandler; // used instead of handler when set
+    RoutePolicy policy;
+    std::atomic<int> inFlight{0};
+};
+
+struct RouteMatch {
+    static constexpr size_t kMaxParams = 8;
+
+    const Route* route = nullptr;
+    size_t paramCount = 0;
+    std::string_view paramNames[kMaxParams];
+    std::string_view paramValues[kMaxParams]; // slices of the looked-up path
+};
+
+// Compiled radix tree router, one tree per HTTP method. Patterns may contain
+// `:name` segments, which capture one path segment, and a trailing `*` or
+// `*name`, which captures the rest of the path. Static segments win over
+// parameters, which win over wildcards. Lookup does not allocate.
+//
+// Routes are added during setup; lookups are safe to run concurrently once
+// no more routes are being added.
+class Router {
+private:
+    struct Node {
+        std::string prefix;
+        std::vector<std::unique_ptr<Node>> children; // static edges, distinct first bytes
+        std::unique_ptr<Node> paramChild;
+        std::string paramName;
+        std::unique_ptr<Node> wildcardChild;
+        std::string wildcardName;
+        Route* route = nullptr;
+    };
+
+    struct MethodTree {
+        std::string method;
+        std::unique_ptr<Node> root;
+    };
+
+    std::vector<MethodTree> trees_;
+    std::vector<std::unique_ptr<Route>> routes_;
+
+    Node* rootFor(const std::string& method);
+    static Node* insertStatic(Node* node, std::string_view text);
+    static bool match(const Node* node, std::string_view path, RouteMatch& result);
+
+public:
+    Router() = default;
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    // Throws std::invalid_argument for malformed patterns
+    Route& add(const std::string& method, const std::string& pattern, HttpHandler handler,
+               RoutePolicy policy = RoutePolicy());
+    bool find(std::string_view method, std::string_view path, RouteMatch& result) const;
+
+    const std::vector<std::unique_ptr<Route>>& routes() const { return routes_; }
+};
+
+} // namespace dcp
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include "service_registry.h"
+
+namespace dcp {
+
+// A service as the API returns it
+nlohmann::json serviceToJson(const Service& service);
+
+// Members of that representation, as bits of a field mask
+struct ServiceFields {
+    enum : uint32_t {
+        HOST = 1 << 0,
+        ID = 1 << 1,
+        LAST_HEARTBEAT = 1 << 2,
+        METADATA = 1 << 3,
+        NAME = 1 << 4,
+        PORT = 1 << 5,
+        STATUS = 1 << 6,
+        TTL_MS = 1 << 7,
+        ALL = (1 << 8) - 1
+    };
+};
+
+// Parses a comma-separated list of member names ("id,name,status"). Returns
+// false and sets `unknown` to the offending name if one is not a member.
+bool parseServiceFields(std::string_view list, uint32_t& fields, std::string& unknown);
+
+// Appends the members of `service` selected by `fields` as compact JSON,
+// without building a document; with every member selected the text is
+// what serviceToJson(service).dump() produces
+void appendServiceJson(const Service& service, uint32_t fields, std::string& out);
+
+// Builds a service from a registration body (id, name, host, port, metadata,
+// ttl_ms). Returns null and sets `error` when a field is missing or out of
+// range; throws nlohmann::json::exception when one has the wrong type.
+std::shared_ptr<Service> serviceFromJson(const nlohmann::json& json, std::string& error);
+
+} // namespace dcp
@@ -2,42 +2,321 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <chrono>
 #include <functional>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include "interned_string.h"
+#include "net_address.h"
+#include "timer_wheel.h"
 
 namespace dcp {
 
+enum class ServiceStatus : uint8_t {
+    UNKNOWN,
+    HEALTHY,
+    UNHEALTHY
+};
+
+const char* toString(ServiceStatus status);
+// Unrecognized text maps to UNKNOWN
+ServiceStatus parseServiceStatus(const std::string& text);
+
+// Immutable key/value metadata kept as one flat, key-sorted array. Equal
+// metadata sets are shared by every instance that carries them, and
+// copy-on-write record updates share the set with the record they replace.
+class ServiceMetadata {
+public:
+    using Entry = std::pair<InternedString, std::string>;
+    
+    // Later duplicates of a key win
+    static std::shared_ptr<const ServiceMetadata> make(std::vector<std::pair<std::string, std::string>> entries);
+    static std::shared_ptr<const ServiceMetadata> empty();
+    
+    const std::string* find(const std::string& key) const;
+    size_t size() const { return entries_.size(); }
+    std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+    std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+    
+private:
+    std::vector<Entry> entries_;
+};
+
+// Names and hosts are interned, the host is pre-parsed into `address`
+// (invalid when it is not an IP literal) and metadata is shared, which
+// keeps a record to about a hundred bytes.
 struct Service {
     std::string id;
-    std::string name;
-    std::string host;
-    int port;
-    std::string status; // "healthy", "unhealthy", "unknown"
-    std::unordered_map<std::string, std::string> metadata;
+    InternedString name;
+    InternedString host;
+    NetAddress address;
+    uint16_t port;
+    ServiceStatus status;
+    uint32_t ttlMs; // lease length; 0 when health comes from probes instead
+    uint32_t nameSlot; // set by the registry: the record's entry in its name index
+    std::shared_ptr<const ServiceMetadata> metadata;
     std::chrono::system_clock::time_point lastHeartbeat;
     
     Service(const std::string& id, const std::string& name, 
             const std::string& host, int port)
-        : id(id), name(name), host(host), port(port), 
-          status("unknown"), lastHeartbeat(std::chrono::system_clock::now()) {}
+        : id(id), name(name), host(host), address(NetAddress::parse(host)), port(static_cast<uint16_t>(port)), 
+          status(ServiceStatus::UNKNOWN), ttlMs(0), nameSlot(0), metadata(ServiceMetadata::empty()),
+          lastHeartbeat(std::chrono::system_clock::now()) {}
+    
+    // For records restored from disk, whose strings are interned and address parsed already
+    Service(const std::string& id, InternedString name, InternedString host, const NetAddress& address, int port)
+        : id(id), name(name), host(host), address(address), port(static_cast<uint16_t>(port)),
+          status(ServiceStatus::UNKNOWN), ttlMs(0), nameSlot(0), metadata(ServiceMetadata::empty()),
+          lastHeartbeat(std::chrono::system_clock::now()) {}
+};
+
+// What scans over a service name need, stored contiguously per name
+struct ServiceEndpoint {
+    const Service* service; // owned by the snapshot the endpoint came from
+    NetAddress address;
+    uint16_t port;
+    ServiceStatus status;
+    uint32_t ttlMs; // lease length; 0 when health comes from probes instead
+};
+
+// One entry of the registry's change log. `service` is the record as of the
+// change; for UNREGISTERED it is the record that was removed.
+struct RegistryEvent {
+    enum class Type {
+        REGISTERED,
+        UNREGISTERED,
+        STATUS_CHANGED
+    };
+    
+    uint64_t revision; // snapshot version that first included the change
+    Type type;
+    std::shared_ptr<Service> service;
+};
+
+const char* toString(RegistryEvent::Type type);
+
+// One write of a ServiceRegistry::apply() batch
+struct RegistryOperation {
+    enum class Type {
+        REGISTER,
+        UNREGISTER,
+        HEARTBEAT
+    };
+    
+    Type type;
+    std::shared_ptr<Service> service; // REGISTER
+    std::string serviceId;            // UNREGISTER, HEARTBEAT
+};
+
+// Immutable view of the registry at one version. Services reachable from a
+// published snapshot are never modified: writers replace a changed record
+// with an updated copy in the next snapshot, which shares every shard and
+// name list it did not touch with this one.
+class RegistrySnapshot {
+public:
+    using ServiceList = std::vector<std::shared_ptr<Service>>;
+    static constexpr size_t kShards = 64;
+    
+    RegistrySnapshot();
+    
+    uint64_t version() const { return version_; }
+    size_t size() const { return size_; }
+    std::shared_ptr<Service> find(const std::string& id) const;
+    const ServiceList& servicesByName(const std::string& name) const;
+    const ServiceList& healthyServices(const std::string& name) const;
+    const std::vector<ServiceEndpoint>& endpoints(const std::string& name) const;
+    
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& shard : ids_) {
+            for (const auto& [id, service] : *shard) {
+                fn(service);
+            }
+        }
+    }
+
+private:
+    friend class ServiceRegistry;
+    
+    // Instances sharing a name, the healthy ones among them, and the
+    // endpoints of `all` in the same order. Where each instance sits in
+    // them is kept by its Service::nameSlot, so removals and status changes
+    // are O(1) per change; the slots are flat and cheap to copy on write.
+    struct NameIndex {
+        static constexpr uint32_t kNotHealthy = UINT32_MAX;
+        struct Position {
+            uint32_t all;
+            uint32_t healthy;
+        };
+        
+        ServiceList all;
+        ServiceList healthy;
+        std::vector<ServiceEndpoint> endpoints;
+        std::vector<Position> slots;     // by Service::nameSlot
+        std::vector<uint32_t> freeSlots;
+    };
+    using IdShard = std::unordered_map<std::string, std::shared_ptr<Service>>;
+    using NameMap = std::unordered_map<std::string, std::shared_ptr<NameIndex>>;
+    
+    // Only the registry's writer changes these, and only before publishing
+    uint64_t version_;
+    size_t size_;
+    std::shared_ptr<IdShard> ids_[kShards];
+    std::shared_ptr<NameMap> names_[kShards];
+    
+    static size_t shardFor(const std::string& key);
 };
 
+// Service registry with wait-free reads (read-copy-update).
+//
+// Readers work on the latest published RegistrySnapshot and never take a
+// lock; each thread caches the snapshot it last saw and only reloads it
+// when the published version moves on. Writers serialize on a mutex,
+// build the next snapshot copy-on-write and publish it with one atomic
+// store. Inside a Batch, changes are published together when the
+// outermost batch ends; writes from other threads wait until then, so
+// every write outside a batch is published before it returns.
+//
+// Instances registered with a TTL hold a lease that heartbeats renew. A
+// lease that runs out marks its instance unhealthy, and one left expired
+// for the eviction delay unregisters it. Leases sit in a timer wheel, so
+// expiring them costs O(expired) however many instances there are.
+//
+// The snapshot version doubles as the registry revision. Registrations,
+// unregistrations and status changes are also appended to a bounded change
+// log, so watchers can catch up from a revision without a full snapshot.
 class ServiceRegistry {
 private:
-    std::unordered_map<std::string, std::shared_ptr<Service>> services_;
-    mutable std::mutex mutex_;
+    mutable std::mutex writeMutex_;
+    std::shared_ptr<const RegistrySnapshot> published_; // atomic_load/atomic_store only
+    std::atomic<uint64_t> publishedVersion_;
+    const uint64_t registryId_;
+    
+    // Writer state, guarded by writeMutex_
+    std::shared_ptr<RegistrySnapshot> draft_; // next snapshot, null when nothing changed
+    bool idsCopied_[RegistrySnapshot::kShards];
+    bool namesCopied_[RegistrySnapshot::kShards];
+    std::unordered_set<std::string> namesTouched_;
+    int batchDepth_;
+    std::thread::id batchOwner_; // thread whose batch is open
+    std::condition_variable batchEnded_;
+    std::vector<RegistryEvent> pendingEvents_; // logged once the draft is published
+    std::function<void(uint64_t)> changeListener_;
+    std::function<void(const std::vector<RegistryEvent>&)> journal_;
+    
+    // Leases, also guarded by writeMutex_
+    struct Lease {
+        TimerWheel::Timer timer;
+        std::string serviceId;
+        bool expired = false;
+    };
+    TimerWheel leaseWheel_;
+    std::unordered_map<std::string, std::unique_ptr<Lease>> leases_;
+    std::chrono::milliseconds leaseEvictAfter_;
+    std::function<bool(const std::string&, bool)> leaseExpiryHandler_;
+    
+    // Change log, oldest first
+    mutable std::mutex logMutex_;
+    std::deque<RegistryEvent> changeLog_;
+    size_t changeLogCapacity_;
+    uint64_t trimmedRevision_; // newest revision dropped from the log
+    
+    std::unique_lock<std::mutex> lockForWrite();
+    RegistrySnapshot& draft();
+    RegistrySnapshot::IdShard& mutableShard(const std::string& id);
+    RegistrySnapshot::NameIndex& mutableName(const std::string& name);
+    void addToName(const std::shared_ptr<Service>& service);
+    void removeFromName(const std::shared_ptr<Service>& service);
+    void replaceService(const std::shared_ptr<Service>& current, const std::shared_ptr<Service>& updated);
+    static void removeFromAll(RegistrySnapshot::NameIndex& index, uint32_t position);
+    static void removeFromHealthy(RegistrySnapshot::NameIndex& index, uint32_t position);
+    void logEvent(RegistryEvent::Type type, const std::shared_ptr<Service>& service);
+    void armLease(const std::string& serviceId, std::chrono::milliseconds after, bool expired);
+    void dropLease(const std::string& serviceId);
+    void addService(const std::shared_ptr<Service>& service);
+    void removeService(const std::shared_ptr<Service>& service);
+    bool renew(const std::string& serviceId);
+    std::shared_ptr<Service> currentService(const std::string& serviceId) const;
+    void commit();
+    void publish();
 
 public:
+    // Groups writes into one published snapshot
+    class Batch {
+    private:
+        ServiceRegistry& registry_;
+    
+    public:
+        explicit Batch(ServiceRegistry& registry);
+        ~Batch();
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+    };
+    
+    static constexpr size_t kDefaultChangeLogCapacity = 4096;
+    
+    explicit ServiceRegistry(size_t changeLogCapacity = kDefaultChangeLogCapacity);
+    
+    // Latest published state; never blocks
+    std::shared_ptr<const RegistrySnapshot> snapshot() const;
+    uint64_t version() const { return publishedVersion_.load(std::memory_order_acquire); }
+    
+    // Appends the logged changes after `revision`, oldest first. Returns false
+    // when the log no longer reaches back that far, or the revision is newer
+    // than the registry; the caller should then start over from a snapshot.
+    bool changesSince(uint64_t revision, std::vector<RegistryEvent>& events) const;
+    uint64_t latestChangeRevision() const;
+    // Called with the revision after each publish that logged changes. It
+    // runs on the writing thread with the write lock held, so keep it short.
+    void setChangeListener(std::function<void(uint64_t revision)> listener);
+    // Receives the changes of each publish, in revision order, before they
+    // are logged; also runs under the write lock. Used for persistence.
+    void setJournal(std::function<void(const std::vector<RegistryEvent>& events)> journal);
+    // Recovery only: publishes the current state as `revision` and clears the
+    // change log, so revisions keep growing across restarts and watchers
+    // from before the restart resync
+    void restoreRevision(uint64_t revision);
+    
     bool registerService(const std::shared_ptr<Service>& service);
+    // Applies `operations` in order under one write lock, published as one
+    // snapshot. Entry i of the result is false when operation i named an
+    // unknown instance (or registered a null service).
+    std::vector<bool> apply(const std::vector<RegistryOperation>& operations);
     bool unregisterService(const std::string& serviceId);
     std::shared_ptr<Service> getService(const std::string& serviceId) const;
     std::vector<std::shared_ptr<Service>> getServicesByName(const std::string& name) const;
     std::vector<std::shared_ptr<Service>> getAllServices() const;
-    bool updateServiceStatus(const std::string& serviceId, const std::string& status);
+    bool updateServiceStatus(const std::string& serviceId, ServiceStatus status);
     void updateHeartbeat(const std::string& serviceId);
+    
+    // Heartbeat for a leased instance: restarts its lease and marks it
+    // healthy. Renewals that change nothing else are published lazily,
+    // with the next write or lease tick. False if the service is unknown.
+    bool renewLease(const std::string& serviceId);
+    // Fires due leases; returns how many expired and were evicted
+    struct LeaseExpiry {
+        size_t expired = 0;
+        size_t evicted = 0;
+    };
+    LeaseExpiry expireLeases(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    // Milliseconds until expireLeases has work to do, at most `limit`
+    int nextLeaseTimeoutMs(int limit) const;
+    // How long an expired instance stays registered; 0 keeps it indefinitely
+    void setLeaseEvictAfter(std::chrono::milliseconds delay);
+    // Replicated registries: due leases are handed to `handler` (evict is
+    // false for expiry, true for eviction) instead of changing the registry,
+    // which hears back through the replicated log. An eviction is offered
+    // again every eviction delay until the instance is gone. The handler
+    // runs under the write lock and returns whether it acted on the lease.
+    void setLeaseExpiryHandler(std::function<bool(const std::string& serviceId, bool evict)> handler);
+    size_t leaseCount() const;
     std::vector<std::shared_ptr<Service>> getHealthyServices(const std::string& name) const;
 };
 
-} // namespace dcp
\ No newline at end of file
+} // namespace dcp
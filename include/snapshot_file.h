@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "service_registry.h"
+
+namespace dcp {
+
+// Binary registry snapshot, laid out to be read in place through mmap.
+//
+//   header      fixed size, checksummed, with the offset of every section
+//   strings     offset table plus one blob; ids, names, hosts and metadata
+//               texts each appear once
+//   records     fixed-size service records sorted by id, so an id is found
+//               by binary search without building anything
+//   metadata    distinct metadata sets, as runs of key/value string indexes
+//   config      JSON text of the runtime config overrides
+//
+// Integers are stored in host byte order; the file is not meant to move
+// between machines of different endianness.
+class SnapshotFile {
+public:
+    static constexpr uint32_t kFormat = 2;
+
+    struct Header {
+        char magic[8];
+        uint32_t format;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t revision;     // registry revision the snapshot was taken at
+        uint64_t firstSegment; // first log segment not covered by the snapshot
+        uint32_t serviceCount;
+        uint32_t stringCount;
+        uint32_t metadataSetCount;
+        uint32_t metadataEntryCount;
+        uint64_t stringOffsets;   // uint32_t[stringCount + 1], relative to stringData
+        uint64_t stringData;
+        uint64_t records;
+        uint64_t metadataSets;
+        uint64_t metadataEntries;
+        uint64_t config;
+        uint64_t configSize;
+        uint32_t bodyChecksum;    // CRC-32C of everything after the header
+        uint32_t headerChecksum;  // CRC-32C of the header up to this field
+    };
+
+    struct Record {
+        uint32_t id;          // string indexes
+        uint32_t name;
+        uint32_t host;
+        uint16_t port;
+        uint8_t status;
+        uint8_t family;       // of `address`; 0 when the host is not an IP literal
+        uint8_t address[16];
+        uint32_t ttlMs;
+        uint32_t metadataSet; // 0 is the empty set
+        int64_t lastHeartbeatMs; // system clock
+    };
+
+    struct MetadataSet {
+        uint32_t first; // index of the first entry
+        uint32_t count;
+    };
+
+    struct MetadataEntry {
+        uint32_t key;
+        uint32_t value;
+    };
+
+    SnapshotFile() = default;
+    ~SnapshotFile();
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // Maps and validates `path`. On failure `error` says why; `missing` is
+    // set when the file does not exist.
+    bool open(const std::string& path, std::string& error, bool* missing = nullptr);
+    void close();
+
+    // Writes `services` (any order) atomically: to a temporary file that is
+    // fsynced and then renamed over `path`
+    static bool write(const std::string& path, const std::vector<std::shared_ptr<Service>>& services,
+                      uint64_t revision, uint64_t firstSegment, const std::string& config, std::string& error);
+
+    uint64_t revision() const { return header_->revision; }
+    uint64_t firstSegment() const { return header_->firstSegment; }
+    size_t size() const { return header_->serviceCount; }
+    size_t stringCount() const { return header_->stringCount; }
+    size_t metadataSetCount() const { return header_->metadataSetCount; }
+
+    const Record& record(size_t index) const { return records_[index]; }
+    std::string_view string(uint32_t index) const {
+        return std::string_view(stringData_ + stringOffsets_[index], stringOffsets_[index + 1] - stringOffsets_[index]);
+    }
+    const MetadataSet& metadataSet(uint32_t index) const { return metadataSets_[index]; }
+    const MetadataEntry& metadataEntry(uint32_t index) const { return metadataEntries_[index]; }
+    std::string_view config() const { return std::string_view(base_ + header_->config, header_->configSize); }
+
+    // Record with `id`, straight from the mapping; null when absent
+    const Record* find(std::string_view id) const;
+    // Materializes one record
+    std::shared_ptr<Service> service(const Record& record) const;
+    // Materializes every record, in id order, sharing interned strings and
+    // metadata sets between them
+    std::vector<std::shared_ptr<Service>> services() const;
+
+private:
+    const char* base_ = nullptr;
+    size_t mappedSize_ = 0;
+    const Header* header_ = nullptr;
+    const uint32_t* stringOffsets_ = nullptr;
+    const char* stringData_ = nullptr;
+    const Record* records_ = nullptr;
+    const MetadataSet* metadataSets_ = nullptr;
+    const MetadataEntry* metadataEntries_ = nullptr;
+
+    bool validate(std::string& error);
+    std::shared_ptr<const ServiceMetadata> metadata(uint32_t setIndex) const;
+    std::shared_ptr<Service> makeService(const Record& record, InternedString name, InternedString host,
+                                         std::shared_ptr<const ServiceMetadata> metadata) const;
+};
+
+} // namespace dcp
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace dcp {
+
+struct StaticFile {
+    std::string filePath;
+    std::string contentType;
+    std::string etag;
+    std::string lastModified;      // HTTP-date
+    time_t mtime = 0;
+    off_t size = 0;
+    std::shared_ptr<const std::string> content; // null for files served with sendfile
+    std::chrono::steady_clock::time_point checkedAt;
+};
+
+// Caches static assets in memory keyed by request path. Entries are
+// revalidated against the file's mtime and size at most once per
+// revalidate interval; files larger than the per-file limit (or that would
+// exceed the total budget) keep only their metadata and are streamed from
+// disk on each request.
+class StaticFileCache {
+private:
+    std::string rootDir_;
+    size_t maxFileSize_;
+    size_t maxTotalSize_;
+    std::chrono::milliseconds revalidateInterval_;
+    size_t totalSize_;
+    std::unordered_map<std::string, std::shared_ptr<const StaticFile>> entries_;
+    mutable std::mutex mutex_;
+
+    std::shared_ptr<const StaticFile> load(const std::string& filePath, const struct stat& st);
+
+public:
+    StaticFileCache(const std::string& rootDir,
+                    size_t maxFileSize = 256 * 1024,
+                    size_t maxTotalSize = 64 * 1024 * 1024,
+                    std::chrono::milliseconds revalidateInterval = std::chrono::milliseconds(1000));
+
+    // Returns nullptr if the path is invalid or the file does not exist
+    std::shared_ptr<const StaticFile> lookup(const std::string& path);
+
+    const std::string& rootDir() const { return rootDir_; }
+    size_t totalSize() const;
+    void clear();
+
+    static std::string contentTypeFor(const std::string& filePath);
+    static std::string formatHttpDate(time_t time);
+    static bool parseHttpDate(const std::string& value, time_t& time);
+};
+
+} // namespace dcp
@@ -0,0 +1,49 @@
+#pragma once
+#include <functional>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace dcp {
+
+// Fixed-size pool of worker threads draining a shared task queue.
+//
+// Tasks carry a priority (0 = highest) and are always taken from the
+// highest non-empty priority first. When the pool is bounded, lower
+// priorities are admitted only while the queue is less full: priority p
+// may occupy up to (kPriorityLevels - p) / kPriorityLevels of maxQueued,
+// so low-priority work is shed first under overload.
+class ThreadPool {
+public:
+    static constexpr size_t kPriorityLevels = 3;
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_[kPriorityLevels];
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t numThreads_;
+    size_t maxQueued_;
+    size_t queued_;
+    bool running_;
+
+    void workerLoop();
+
+public:
+    explicit ThreadPool(size_t numThreads, size_t maxQueued = 0);
+    ~ThreadPool();
+
+    void start();
+    void stop();
+
+    // Returns false if the pool is not running or the task was not admitted
+    bool submit(std::function<void()> task, size_t priority = 0);
+
+    size_t size() const { return numThreads_; }
+    size_t queueDepth() const;
+    size_t queueDepth(size_t priority) const;
+};
+
+} // namespace dcp
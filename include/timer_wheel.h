@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace dcp {
+
+// Hierarchical timing wheel for very large numbers of coarse deadlines.
+//
+// Four levels of 64 slots: level 0 holds timers due within 64 ticks, each
+// higher level covers 64 times the span of the one below. Timers are
+// intrusive list nodes, so scheduling, rescheduling and cancelling are
+// O(1); a higher-level slot is redistributed into the levels below when
+// the wheel reaches it. Deadlines beyond the top level are clamped.
+//
+// Not thread-safe: each event loop owns one wheel.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expiry = 0;      // in ticks
+        void* context = nullptr;  // owner's pointer, handed back on expiry
+
+        Timer() = default;
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        bool armed() const { return next != nullptr; }
+    };
+
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+                        Clock::time_point start = Clock::now());
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // (Re)arms the timer; a deadline that has already passed fires on the next tick
+    void schedule(Timer& timer, Clock::time_point deadline);
+    void cancel(Timer& timer);
+
+    // Fires every timer due by `now`; the handler may schedule or cancel timers
+    template <typename Handler>
+    void advance(Clock::time_point now, Handler&& onExpired) {
+        uint64_t target = toTick(now);
+        if (size_ == 0 && current_ < target) {
+            current_ = target;
+            return;
+        }
+        while (current_ < target) {
+            ++current_;
+            cascade();
+            size_t slot = current_ & (kSlots - 1);
+            occupied_[0] &= ~(uint64_t(1) << slot);
+
+            // Detach the slot first so handlers can safely reschedule into it
+            Timer due;
+            splice(slots_[0][slot], due);
+            while (due.next != &due) {
+                Timer* timer = due.next;
+                unlink(*timer);
+                --size_;
+                onExpired(*timer);
+            }
+        }
+    }
+
+    // Milliseconds until the next tick with work to do, at most `limit`
+    int nextTimeoutMs(Clock::time_point now, int limit) const;
+
+    size_t size() const { return size_; }
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    std::chrono::milliseconds tick_;
+    Clock::time_point start_;
+    uint64_t current_;   // last tick processed
+    size_t size_;
+    Timer slots_[kLevels][kSlots]; // list sentinels
+    uint64_t occupied_[kLevels];   // slots that may hold timers
+
+    uint64_t toTick(Clock::time_point time) const;
+    void place(Timer& timer);
+    void cascade();
+    static void unlink(Timer& timer);
+    static void splice(Timer& from, Timer& to);
+};
+
+} // namespace dcp
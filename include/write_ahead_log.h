@@ -0,0 +1,90 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace dcp {
+
+// CRC-32C (Castagnoli) of `size` bytes, continuing from `crc`
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// When appended records reach stable storage
+enum class FsyncPolicy {
+    ALWAYS,   // sync() returns once the records are on disk (group commit)
+    INTERVAL, // sync() hands them to the kernel; a background flush fsyncs them
+    NONE      // records survive a process crash but not a power loss
+};
+
+// Parses "always", "interval" or "none"; false for anything else
+bool parseFsyncPolicy(const std::string& text, FsyncPolicy& policy);
+
+// Append-only log of opaque records, split into numbered segment files
+// (wal-<segment>.log) in one directory. Every record is framed with its
+// length and checksum, so a torn write at the tail is detected on open.
+//
+// Appending only copies the record into a buffer, which makes it cheap
+// enough to call under other locks. sync() writes out everything appended
+// so far; concurrent callers share one write and one fsync (group commit):
+// while one of them is flushing, the others' records pile up behind it and
+// go out together in the next flush.
+class WriteAheadLog {
+public:
+    using RecordHandler = std::function<void(const char* data, size_t size)>;
+
+private:
+    std::string directory_;
+    FsyncPolicy policy_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_;
+    int fd_;
+    uint64_t segment_;
+    std::string pending_;  // framed records not yet written
+    uint64_t appended_;    // records appended since open
+    uint64_t written_;     // records handed to the kernel
+    uint64_t durable_;     // records known to be on disk
+    uint64_t segmentBytes_;
+    uint64_t syncs_;
+    bool flushing_;
+    bool failed_;
+
+    std::string segmentPath(uint64_t segment) const;
+    int openSegment(uint64_t segment);
+    void syncDirectory();
+    bool flushLocked(std::unique_lock<std::mutex>& lock, bool durable);
+
+public:
+    WriteAheadLog(const std::string& directory, FsyncPolicy policy);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Passes every intact record from segment `firstSegment` on to `replay`,
+    // oldest first, and deletes older segments. A torn or corrupt record ends
+    // the log: its segment is cut there and any later segments are removed.
+    // Appends then go to a new segment.
+    bool open(uint64_t firstSegment, const RecordHandler& replay);
+    void close();
+
+    void append(const char* data, size_t size);
+    void append(const std::string& record) { append(record.data(), record.size()); }
+    // Makes every record appended so far as durable as the policy promises
+    bool sync() { return flush(policy_ == FsyncPolicy::ALWAYS); }
+    // Writes out appended records, and fsyncs them when `durable` is set
+    bool flush(bool durable);
+
+    // Closes the current segment (fsynced) and starts the next one, whose
+    // number is returned. Segments before it can be dropped once a snapshot
+    // covers them.
+    uint64_t rotate();
+    void removeSegmentsBefore(uint64_t segment);
+
+    FsyncPolicy policy() const { return policy_; }
+    uint64_t segmentBytes() const;
+    uint64_t syncCount() const;
+};
+
+} // namespace dcp
@@ -17,10 +17,60 @@ bool ConfigManager::loadConfig() {
         config_["server"] = nlohmann::json::object();
         config_["server"]["port"] = 8080;
         config_["server"]["host"] = "0.0.0.0";
+        config_["server"]["worker_threads"] = 0;
+        config_["server"]["listeners"] = 1;
+        config_["server"]["pin_listener_threads"] = false;
+        config_["server"]["backlog"] = 4096;
+        config_["server"]["keep_alive_timeout_ms"] = 5000;
+        config_["server"]["header_timeout_ms"] = 10000;
+        config_["server"]["body_timeout_ms"] = 30000;
+        config_["server"]["write_timeout_ms"] = 30000;
+        config_["server"]["max_requests_per_connection"] = 1000;
+        config_["server"]["max_queued_requests"] = 1024;
+        config_["server"]["retry_after_seconds"] = 1;
+        config_["server"]["io_uring"] = true;
         
         config_["health_check"] = nlohmann::json::object();
         config_["health_check"]["interval_ms"] = 30000;
         config_["health_check"]["timeout_ms"] = 5000;
+        config_["health_check"]["recheck_interval_ms"] = 2000;
+        config_["health_check"]["stable_interval_ms"] = 60000;
+        config_["health_check"]["jitter"] = 0.1;
+        config_["health_check"]["rise"] = 2;
+        config_["health_check"]["fall"] = 3;
+        config_["health_check"]["max_concurrent_probes"] = 1024;
+        config_["health_check"]["max_idle_connections"] = 1024;
+        config_["health_check"]["io_uring"] = true;
+        
+        config_["registry"] = nlohmann::json::object();
+        config_["registry"]["lease_evict_after_ms"] = 60000;
+        
+        config_["persistence"] = nlohmann::json::object();
+        config_["persistence"]["enabled"] = true;
+        config_["persistence"]["directory"] = "data";
+        config_["persistence"]["fsync"] = "always";
+        config_["persistence"]["flush_interval_ms"] = 100;
+        config_["persistence"]["snapshot_after_bytes"] = 67108864;
+        
+        config_["cluster"] = nlohmann::json::object();
+        config_["cluster"]["enabled"] = false;
+        config_["cluster"]["node_id"] = "";
+        config_["cluster"]["members"] = nlohmann::json::object();
+        config_["cluster"]["heartbeat_interval_ms"] = 50;
+        config_["cluster"]["election_timeout_ms"] = 500;
+        config_["cluster"]["snapshot_entries"] = 10000;
+        config_["cluster"]["max_staleness_ms"] = 1000;
+        
+        config_["gossip"] = nlohmann::json::object();
+        config_["gossip"]["enabled"] = false;
+        config_["gossip"]["node_id"] = "";
+        config_["gossip"]["bind"] = "0.0.0.0:7946";
+        config_["gossip"]["advertise"] = "";
+        config_["gossip"]["seeds"] = nlohmann::json::array();
+        config_["gossip"]["protocol_period_ms"] = 1000;
+        config_["gossip"]["ping_timeout_ms"] = 300;
+        config_["gossip"]["indirect_probes"] = 3;
+        config_["gossip"]["suspicion_multiplier"] = 4;
         
         config_["load_balancer"] = nlohmann::json::object();
         config_["load_balancer"]["algorithm"] = "round_robin";
@@ -29,7 +79,7 @@ bool ConfigManager::loadConfig() {
         config_["monitoring"]["enabled"] = true;
         config_["monitoring"]["export_interval_ms"] = 10000;
         
-        return saveConfig();
+        return true;
     }
     
     try {
@@ -48,11 +98,6 @@ bool ConfigManager::loadConfig() {
     }
 }
 
-bool ConfigManager::saveConfig() {
-    // Skip file saving for now - in-memory config only for this demo
-    return true;
-}
-
 bool ConfigManager::has(const std::string& key) const {
     std::lock_guard<std::mutex> lock(mutex_);
     return config_.find(key) != config_.end();
@@ -60,7 +105,9 @@ bool ConfigManager::has(const std::string& key) const {
 
 void ConfigManager::remove(const std::string& key) {
     std::lock_guard<std::mutex> lock(mutex_);
-    config_.erase(key);
+    if (config_.erase(key) > 0 && changeListener_) {
+        changeListener_(key, nullptr);
+    }
 }
 
 nlohmann::json ConfigManager::getSection(const std::string& section) const {
@@ -75,15 +122,27 @@ nlohmann::json ConfigManager::getSection(const std::string& section) const {
 void ConfigManager::setSection(const std::string& section, const nlohmann::json& value) {
     std::lock_guard<std::mutex> lock(mutex_);
     config_[section] = value;
+    if (changeListener_) {
+        changeListener_(section, value);
+    }
 }
 
-std::string ConfigManager::toString() const {
+nlohmann::json ConfigManager::toJson() const {
     std::lock_guard<std::mutex> lock(mutex_);
     nlohmann::json jsonData;
     for (const auto& [key, value] : config_) {
         jsonData[key] = value;
     }
-    return jsonData.dump(4);
+    return jsonData;
+}
+
+std::string ConfigManager::toString() const {
+    return toJson().dump(4);
+}
+
+void ConfigManager::setChangeListener(std::function<void(const std::string& section, const nlohmann::json& value)> listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    changeListener_ = std::move(listener);
 }
 
 } // namespace dcp
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "control_plane.h"
+#include "service_json.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
 #include <iostream>
 #include <sstream>
 #include <thread>
@@ -7,6 +12,75 @@
 
 namespace dcp {
 
+namespace {
+
+constexpr int kDefaultWatchTimeoutMs = 30000;
+constexpr int kMaxWatchTimeoutMs = 60000;
+constexpr int kMaxWatchers = 4096; // parked watches each hold a connection
+constexpr size_t kMaxBatchOperations = 1000;
+constexpr size_t kMaxPageSize = 10000;
+constexpr size_t kListChunkBytes = 32 * 1024;     // per piece of a streamed service list
+constexpr size_t kListStreamThreshold = 256;      // smaller lists are sent in one piece
+
+// Query values arrive as sent: undo percent-encoding and '+' for space
+std::string decodeQueryValue(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            out.push_back(' ');
+        } else if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out.push_back(static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(text[i]);
+        }
+    }
+    return out;
+}
+
+// Page cursors are the last id served, hex-encoded so any id is URL-safe
+std::string encodeCursor(const std::string& id) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(id.size() * 2);
+    for (unsigned char c : id) {
+        out.push_back(kDigits[c >> 4]);
+        out.push_back(kDigits[c & 15]);
+    }
+    return out;
+}
+
+bool decodeCursor(std::string_view cursor, std::string& id) {
+    if (cursor.size() % 2 != 0) {
+        return false;
+    }
+    id.clear();
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        if (!std::isxdigit(static_cast<unsigned char>(cursor[i])) ||
+            !std::isxdigit(static_cast<unsigned char>(cursor[i + 1]))) {
+            return false;
+        }
+        id.push_back(static_cast<char>(std::stoi(std::string(cursor.substr(i, 2)), nullptr, 16)));
+    }
+    return true;
+}
+
+// Body for a write that did not take effect: 500 when it could not be made
+// durable, 503 when leadership moved before it committed
+void setWriteError(HttpResponse& response, int status, const std::string& what) {
+    response.status = status;
+    if (status == 503) {
+        response.headers["Retry-After"] = "1";
+        response.body = "{\"error\": \"Leadership changed before the " + what + " committed; retry\"}";
+    } else {
+        response.body = "{\"error\": \"Failed to persist " + what + "\"}";
+    }
+}
+
+} // namespace
+
 ControlPlane::ControlPlane(int port) : running_(false) {
     serviceRegistry_ = std::make_shared<ServiceRegistry>();
     healthChecker_ = std::make_shared<HealthChecker>(serviceRegistry_);
@@ -14,6 +88,78 @@ ControlPlane::ControlPlane(int port) : running_(false) {
     configManager_ = std::make_shared<ConfigManager>();
     monitoring_ = std::make_shared<Monitoring>();
     httpServer_ = std::make_shared<HttpServer>(port);
+    registryWatch_ = std::make_shared<RegistryWatch>(serviceRegistry_, [this](uint64_t revision) {
+        return buildWatchReply(revision, false);
+    });
+    leaseReaper_ = std::make_shared<LeaseReaper>(serviceRegistry_, monitoring_);
+    
+    nlohmann::json persistenceConfig = configManager_->getSection("persistence");
+    nlohmann::json clusterConfig = configManager_->getSection("cluster");
+    nlohmann::json gossipConfig = configManager_->getSection("gossip");
+    FsyncPolicy fsyncPolicy = FsyncPolicy::ALWAYS;
+    std::string fsync = persistenceConfig.value("fsync", "always");
+    if (!parseFsyncPolicy(fsync, fsyncPolicy)) {
+        std::cerr << "Unknown persistence.fsync policy \"" << fsync << "\", using \"always\"" << std::endl;
+    }
+    if (clusterConfig.value("enabled", false)) {
+        // The cluster log is the persistence: it replaces the registry store
+        ReplicatedRegistry::Options options;
+        options.raft.id = clusterConfig.value("node_id", "");
+        options.raft.members = clusterConfig.value("members", std::map<std::string, std::string>());
+        options.raft.directory = persistenceConfig.value("directory", "data") + "/raft";
+        options.raft.fsync = fsyncPolicy;
+        options.raft.heartbeatInterval = std::chrono::milliseconds(
+            clusterConfig.value("heartbeat_interval_ms", static_cast<int>(options.raft.heartbeatInterval.count())));
+        options.raft.electionTimeout = std::chrono::milliseconds(
+            clusterConfig.value("election_timeout_ms", static_cast<int>(options.raft.electionTimeout.count())));
+        options.raft.snapshotEntries = clusterConfig.value("snapshot_entries", options.raft.snapshotEntries);
+        options.maxStaleness = std::chrono::milliseconds(
+            clusterConfig.value("max_staleness_ms", static_cast<int>(options.maxStaleness.count())));
+        replicatedRegistry_ = std::make_shared<ReplicatedRegistry>(serviceRegistry_, configManager_, options);
+        healthChecker_->setStatusWriter([this](const std::string& serviceId, ServiceStatus status) {
+            return writeServiceStatus(serviceId, status);
+        });
+    } else if (persistenceConfig.value("enabled", true)) {
+        RegistryStore::Options options;
+        options.directory = persistenceConfig.value("directory", options.directory);
+        options.fsync = fsyncPolicy;
+        options.flushInterval = std::chrono::milliseconds(
+            persistenceConfig.value("flush_interval_ms", static_cast<int>(options.flushInterval.count())));
+        options.snapshotAfterBytes = persistenceConfig.value("snapshot_after_bytes", options.snapshotAfterBytes);
+        registryStore_ = std::make_shared<RegistryStore>(serviceRegistry_, configManager_, options);
+    }
+    if (gossipConfig.value("enabled", false)) {
+        // Instances in the gossip group are members under their service id
+        GossipMember::Options options;
+        options.id = gossipConfig.value("node_id", "");
+        if (options.id.empty()) {
+            options.id = clusterConfig.value("node_id", "");
+        }
+        if (options.id.empty()) {
+            options.id = "control-plane";
+        }
+        options.bindAddress = gossipConfig.value("bind", options.bindAddress);
+        options.advertiseAddress = gossipConfig.value("advertise", options.advertiseAddress);
+        options.seeds = gossipConfig.value("seeds", options.seeds);
+        options.protocolPeriod = std::chrono::milliseconds(
+            gossipConfig.value("protocol_period_ms", static_cast<int>(options.protocolPeriod.count())));
+        options.pingTimeout = std::chrono::milliseconds(
+            gossipConfig.value("ping_timeout_ms", static_cast<int>(options.pingTimeout.count())));
+        options.indirectProbes = gossipConfig.value("indirect_probes", options.indirectProbes);
+        options.suspicionMultiplier = gossipConfig.value("suspicion_multiplier", options.suspicionMultiplier);
+        gossip_ = std::make_shared<GossipMember>(options, [this](const GossipMember::Member& member) {
+            handleGossipChange(member);
+        });
+        // Catches instances registered after their member's last change
+        healthChecker_->setExternalStatus([this](const std::string& serviceId, bool& alive) {
+            GossipMember::Member member;
+            if (!gossip_->find(serviceId, member) || member.state == GossipMember::State::SUSPECT) {
+                return false;
+            }
+            alive = member.state == GossipMember::State::ALIVE;
+            return true;
+        });
+    }
     
     setupRoutes();
 }
@@ -29,15 +175,72 @@ bool ControlPlane::start() {
     
     std::cout << "Starting Distributed System Control Plane..." << std::endl;
     
+    // Restore state first: it may include config set at runtime before the restart
+    if (registryStore_) {
+        if (!registryStore_->recover()) {
+            std::cerr << "Failed to recover registry state" << std::endl;
+            return false;
+        }
+        registryStore_->start();
+    }
+    if (replicatedRegistry_ && !replicatedRegistry_->start()) {
+        std::cerr << "Failed to join the cluster" << std::endl;
+        return false;
+    }
+    
     // Set static directory for web UI
     httpServer_->setStaticDirectory("web");
     
+    // Apply server tuning from configuration
+    nlohmann::json serverConfig = configManager_->getSection("server");
+    HttpServerConfig httpConfig = httpServer_->getConfig();
+    httpConfig.workerThreads = serverConfig.value("worker_threads", httpConfig.workerThreads);
+    httpConfig.listeners = serverConfig.value("listeners", httpConfig.listeners);
+    httpConfig.pinListenerThreads = serverConfig.value("pin_listener_threads", httpConfig.pinListenerThreads);
+    httpConfig.backlog = serverConfig.value("backlog", httpConfig.backlog);
+    httpConfig.keepAliveTimeoutMs = serverConfig.value("keep_alive_timeout_ms", httpConfig.keepAliveTimeoutMs);
+    httpConfig.headerTimeoutMs = serverConfig.value("header_timeout_ms", httpConfig.headerTimeoutMs);
+    httpConfig.bodyTimeoutMs = serverConfig.value("body_timeout_ms", httpConfig.bodyTimeoutMs);
+    httpConfig.writeTimeoutMs = serverConfig.value("write_timeout_ms", httpConfig.writeTimeoutMs);
+    httpConfig.maxRequestsPerConnection = serverConfig.value("max_requests_per_connection",
+                                                             httpConfig.maxRequestsPerConnection);
+    httpConfig.maxQueuedRequests = serverConfig.value("max_queued_requests", httpConfig.maxQueuedRequests);
+    httpConfig.retryAfterSeconds = serverConfig.value("retry_after_seconds", httpConfig.retryAfterSeconds);
+    httpConfig.ioUring = serverConfig.value("io_uring", httpConfig.ioUring);
+    httpServer_->setConfig(httpConfig);
+    
+    nlohmann::json healthConfig = configManager_->getSection("health_check");
+    HealthCheckConfig checkConfig = healthChecker_->getConfig();
+    checkConfig.intervalMs = healthConfig.value("interval_ms", checkConfig.intervalMs);
+    checkConfig.timeoutMs = healthConfig.value("timeout_ms", checkConfig.timeoutMs);
+    checkConfig.recheckIntervalMs = healthConfig.value("recheck_interval_ms", checkConfig.recheckIntervalMs);
+    checkConfig.stableIntervalMs = healthConfig.value("stable_interval_ms", checkConfig.stableIntervalMs);
+    checkConfig.jitter = healthConfig.value("jitter", checkConfig.jitter);
+    checkConfig.rise = healthConfig.value("rise", checkConfig.rise);
+    checkConfig.fall = healthConfig.value("fall", checkConfig.fall);
+    checkConfig.maxConcurrentProbes = healthConfig.value("max_concurrent_probes", checkConfig.maxConcurrentProbes);
+    checkConfig.maxIdleConnections = healthConfig.value("max_idle_connections", checkConfig.maxIdleConnections);
+    checkConfig.ioUring = healthConfig.value("io_uring", checkConfig.ioUring);
+    healthChecker_->setConfig(checkConfig);
+    
+    nlohmann::json registryConfig = configManager_->getSection("registry");
+    serviceRegistry_->setLeaseEvictAfter(std::chrono::milliseconds(
+        registryConfig.value("lease_evict_after_ms", 60000)));
+    
+    registryWatch_->start();
+    leaseReaper_->start();
+    
     // Start HTTP server
     if (!httpServer_->start()) {
         std::cerr << "Failed to start HTTP server" << std::endl;
         return false;
     }
     
+    if (gossip_ && !gossip_->start()) {
+        std::cerr << "Failed to start gossip" << std::endl;
+        return false;
+    }
+    
     // Start health checker
     healthChecker_->start();
     
@@ -54,47 +257,112 @@ void ControlPlane::stop() {
     
     std::cout << "Stopping Control Plane..." << std::endl;
     
+    registryWatch_->stop(); // answers parked watches while the server can still send
+    leaseReaper_->stop();
+    if (gossip_) {
+        gossip_->stop();
+    }
     healthChecker_->stop();
+    if (replicatedRegistry_) {
+        replicatedRegistry_->stop(); // writes still waiting on the log are answered 503
+    }
     httpServer_->stop();
+    if (registryStore_) {
+        registryStore_->stop(); // last, so it captures every change
+    }
     
     running_ = false;
     std::cout << "Control Plane stopped" << std::endl;
 }
 
 void ControlPlane::setupRoutes() {
+    // Under overload, registry writes are admitted ahead of reads, and reads
+    // ahead of dashboard and metrics scrapes
+    const RoutePolicy writePolicy{RoutePriority::HIGH, 0};
+    const RoutePolicy readPolicy{RoutePriority::NORMAL, 0};
+    const RoutePolicy scrapePolicy{RoutePriority::LOW, 4};
+    
     // API Routes
     httpServer_->get("/api/services", [this](const HttpRequest& req) { 
         return handleGetServices(req); 
-    });
+    }, readPolicy);
     
-    httpServer_->post("/api/services/register", [this](const HttpRequest& req) { 
-        return handleRegisterService(req); 
-    });
+    // Long poll; bounded because every parked watch keeps its connection busy
+    httpServer_->getDeferred("/api/services/watch", [this](const HttpRequest& req, HttpResponder responder) {
+        handleWatchServices(req, std::move(responder));
+    }, RoutePolicy{RoutePriority::NORMAL, kMaxWatchers});
     
-    httpServer_->post("/api/services/unregister", [this](const HttpRequest& req) { 
-        return handleUnregisterService(req); 
-    });
+    httpServer_->get("/api/services/:id", [this](const HttpRequest& req) { 
+        return handleGetService(req); 
+    }, readPolicy);
+    
+    // Writes are deferred: clustered, they are answered once the log commits them
+    httpServer_->postDeferred("/api/services/register", [this](const HttpRequest& req, HttpResponder responder) { 
+        handleRegisterService(req, std::move(responder)); 
+    }, writePolicy);
+    
+    httpServer_->postDeferred("/api/services/unregister", [this](const HttpRequest& req, HttpResponder responder) { 
+        handleUnregisterService(req, std::move(responder)); 
+    }, writePolicy);
+    
+    httpServer_->postDeferred("/api/services/:id/heartbeat", [this](const HttpRequest& req, HttpResponder responder) { 
+        handleHeartbeat(req, std::move(responder)); 
+    }, writePolicy);
+    
+    httpServer_->postDeferred("/api/services/batch", [this](const HttpRequest& req, HttpResponder responder) { 
+        handleBatch(req, std::move(responder)); 
+    }, writePolicy);
     
     httpServer_->get("/api/metrics", [this](const HttpRequest& req) { 
         return handleGetMetrics(req); 
-    });
+    }, scrapePolicy);
     
     httpServer_->get("/api/config", [this](const HttpRequest& req) { 
         return handleGetConfig(req); 
-    });
+    }, readPolicy);
     
-    httpServer_->post("/api/config", [this](const HttpRequest& req) { 
-        return handleUpdateConfig(req); 
-    });
+    httpServer_->postDeferred("/api/config", [this](const HttpRequest& req, HttpResponder responder) { 
+        handleUpdateConfig(req, std::move(responder)); 
+    }, writePolicy);
+    
+    httpServer_->get("/api/cluster", [this](const HttpRequest& req) { 
+        return handleGetCluster(req); 
+    }, readPolicy);
+    
+    httpServer_->get("/api/gossip", [this](const HttpRequest& req) { 
+        return handleGetGossip(req); 
+    }, readPolicy);
+    
+    httpServer_->get("/api/health", [this](const HttpRequest& req) { 
+        return handleGetHealth(req); 
+    }, readPolicy);
+    
+    if (replicatedRegistry_) {
+        // Cluster members' RPCs; shed like writes, since writes wait on them
+        auto raftRoute = [this](std::string (RaftNode::*rpc)(std::string_view)) {
+            return [this, rpc](const HttpRequest& req) {
+                HttpResponse response;
+                response.headers["Content-Type"] = "application/octet-stream";
+                response.body = (replicatedRegistry_->node().*rpc)(req.body);
+                if (response.body.empty()) {
+                    response.status = 400;
+                }
+                return response;
+            };
+        };
+        httpServer_->post("/raft/vote", raftRoute(&RaftNode::handleVote), writePolicy);
+        httpServer_->post("/raft/append", raftRoute(&RaftNode::handleAppend), writePolicy);
+        httpServer_->post("/raft/snapshot", raftRoute(&RaftNode::handleSnapshot), writePolicy);
+    }
     
     httpServer_->get("/", [this](const HttpRequest& req) { 
         return handleDashboard(req); 
-    });
+    }, scrapePolicy);
     
     // Proxy route (catch-all for service requests)
     httpServer_->get("/proxy/*", [this](const HttpRequest& req) { 
         return handleProxyRequest(req); 
-    });
+    }, readPolicy);
 }
 
 HttpResponse ControlPlane::handleGetServices(const HttpRequest& request) {
@@ -102,27 +370,128 @@ HttpResponse ControlPlane::handleGetServices(const HttpRequest& request) {
     
     HttpResponse response;
     response.headers["Content-Type"] = "application/json";
+    auto fail = [&response](const std::string& error) {
+        response.status = 400;
+        response.body = nlohmann::json{{"error", error}}.dump();
+    };
+    if (redirectStaleRead(request, response)) {
+        return response;
+    }
     
     try {
-        nlohmann::json result = nlohmann::json::array();
-        auto services = serviceRegistry_->getAllServices();
-        
-        for (const auto& service : services) {
-            nlohmann::json serviceJson;
-            serviceJson["id"] = service->id;
-            serviceJson["name"] = service->name;
-            serviceJson["host"] = service->host;
-            serviceJson["port"] = service->port;
-            serviceJson["status"] = service->status;
-            serviceJson["metadata"] = service->metadata;
-            
-            auto time_t = std::chrono::system_clock::to_time_t(service->lastHeartbeat);
-            serviceJson["lastHeartbeat"] = time_t;
-            
-            result.push_back(serviceJson);
+        // Filters, all optional: ?name=web&status=healthy&metadata=zone:eu&metadata=canary
+        std::string name = decodeQueryValue(request.params.get("name"));
+        std::string statusText = decodeQueryValue(request.params.get("status"));
+        bool byStatus = !statusText.empty();
+        ServiceStatus status = parseServiceStatus(statusText);
+        if (byStatus && status == ServiceStatus::UNKNOWN && statusText != "unknown") {
+            fail("Invalid status, expected healthy, unhealthy or unknown");
+            return response;
+        }
+        std::vector<std::pair<std::string, std::string>> metadataFilters; // key, value ("" = any)
+        std::vector<bool> metadataNeedsValue;
+        for (const auto& [param, value] : request.params) {
+            if (param == "metadata") {
+                std::string filter = decodeQueryValue(value);
+                size_t colon = filter.find(':');
+                metadataFilters.emplace_back(filter.substr(0, colon),
+                                             colon == std::string::npos ? "" : filter.substr(colon + 1));
+                metadataNeedsValue.push_back(colon != std::string::npos);
+            }
+        }
+        
+        uint32_t fields = ServiceFields::ALL;
+        std::string unknownField;
+        if (request.params.contains("fields") &&
+            !parseServiceFields(decodeQueryValue(request.params.get("fields")), fields, unknownField)) {
+            fail("Unknown field: " + unknownField);
+            return response;
+        }
+        
+        // Pages are in id order; the cursor is where the previous page ended
+        size_t limit = 0;
+        if (request.params.contains("limit")) {
+            std::string_view text = request.params.get("limit");
+            auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), limit);
+            if (ec != std::errc() || end != text.data() + text.size() || limit == 0 || limit > kMaxPageSize) {
+                fail("Invalid limit, expected 1 to " + std::to_string(kMaxPageSize));
+                return response;
+            }
+        }
+        std::string after;
+        bool paged = limit > 0 || request.params.contains("cursor");
+        if (!decodeCursor(request.params.get("cursor"), after)) {
+            fail("Invalid cursor");
+            return response;
+        }
+        
+        // Only pointers are collected: the snapshot keeps the records alive
+        auto snapshot = serviceRegistry_->snapshot();
+        std::vector<const Service*> matches;
+        auto consider = [&](const std::shared_ptr<Service>& service) {
+            if (byStatus && service->status != status) {
+                return;
+            }
+            if (!after.empty() && service->id <= after) {
+                return;
+            }
+            for (size_t i = 0; i < metadataFilters.size(); ++i) {
+                const std::string* value = service->metadata->find(metadataFilters[i].first);
+                if (!value || (metadataNeedsValue[i] && *value != metadataFilters[i].second)) {
+                    return;
+                }
+            }
+            matches.push_back(service.get());
+        };
+        if (!name.empty()) {
+            for (const auto& service : snapshot->servicesByName(name)) {
+                consider(service);
+            }
+        } else {
+            snapshot->forEach(consider);
         }
         
-        response.body = result.dump(4);
+        if (paged) {
+            auto byId = [](const Service* a, const Service* b) { return a->id < b->id; };
+            size_t pageSize = limit > 0 ? limit : kMaxPageSize;
+            if (matches.size() > pageSize) {
+                std::partial_sort(matches.begin(), matches.begin() + pageSize, matches.end(), byId);
+                matches.resize(pageSize);
+                response.headers["X-Next-Cursor"] = encodeCursor(matches.back()->id);
+            } else {
+                std::sort(matches.begin(), matches.end(), byId);
+            }
+        }
+        
+        // Clients can watch for changes from here
+        response.headers["X-Registry-Revision"] = std::to_string(snapshot->version());
+        
+        // Serialized a piece at a time, so a large list is never held in memory whole
+        size_t count = matches.size();
+        size_t next = 0;
+        auto writeList = [snapshot, matches = std::move(matches), fields, next](std::string& out) mutable {
+            if (next == 0) {
+                out.push_back('[');
+            }
+            size_t full = out.size() + kListChunkBytes;
+            while (next < matches.size() && out.size() < full) {
+                if (next > 0) {
+                    out.push_back(',');
+                }
+                appendServiceJson(*matches[next++], fields, out);
+            }
+            if (next < matches.size()) {
+                return true;
+            }
+            out.push_back(']');
+            return false;
+        };
+        if (count > kListStreamThreshold && request.version == "HTTP/1.1") {
+            response.streamBody = std::move(writeList);
+        } else {
+            while (writeList(response.body)) {
+            }
+        }
         monitoring_->recordRequestCount("/api/services", "GET");
         
     } catch (const std::exception& e) {
@@ -137,108 +506,530 @@ HttpResponse ControlPlane::handleGetServices(const HttpRequest& request) {
     return response;
 }
 
-HttpResponse ControlPlane::handleRegisterService(const HttpRequest& request) {
+HttpResponse ControlPlane::handleGetService(const HttpRequest& request) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    if (redirectStaleRead(request, response)) {
+        return response;
+    }
+    
+    auto service = serviceRegistry_->getService(std::string(request.params.at("id")));
+    if (service) {
+        response.body = serviceToJson(*service).dump(4);
+    } else {
+        response.status = 404;
+        response.body = "{\"error\": \"Service not found\"}";
+    }
+    
+    monitoring_->recordRequestCount("/api/services/:id", "GET");
+    return response;
+}
+
+void ControlPlane::handleWatchServices(const HttpRequest& request, HttpResponder responder) {
+    monitoring_->recordRequestCount("/api/services/watch", "GET");
+    
+    uint64_t revision = 0;
+    int timeoutMs = kDefaultWatchTimeoutMs;
+    try {
+        if (request.params.contains("timeout_ms")) {
+            timeoutMs = std::clamp(std::stoi(std::string(request.params.at("timeout_ms"))), 0, kMaxWatchTimeoutMs);
+        }
+        if (!request.params.contains("revision")) {
+            responder.send(buildWatchReply(0, true)); // No revision yet: start from a snapshot
+            return;
+        }
+        revision = std::stoull(std::string(request.params.at("revision")));
+    } catch (const std::exception&) {
+        HttpResponse response;
+        response.status = 400;
+        response.headers["Content-Type"] = "application/json";
+        response.body = "{\"error\": \"revision and timeout_ms must be non-negative integers\"}";
+        responder.send(std::move(response));
+        return;
+    }
+    
+    registryWatch_->watch(revision, std::chrono::milliseconds(timeoutMs), std::move(responder));
+}
+
+HttpResponse ControlPlane::buildWatchReply(uint64_t revision, bool full) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    
+    nlohmann::json result;
+    std::vector<RegistryEvent> events;
+    auto snapshot = serviceRegistry_->snapshot();
+    
+    // Fall back to the full list when the log no longer covers the client's
+    // revision, or when replaying it would cost more than the list itself
+    if (!full && serviceRegistry_->changesSince(revision, events) && events.size() <= snapshot->size()) {
+        nlohmann::json changes = nlohmann::json::array();
+        for (const auto& event : events) {
+            nlohmann::json change;
+            change["revision"] = event.revision;
+            change["type"] = toString(event.type);
+            change["service"] = serviceToJson(*event.service);
+            changes.push_back(change);
+        }
+        result["revision"] = events.empty() ? revision : events.back().revision;
+        result["full"] = false;
+        result["events"] = changes;
+    } else {
+        nlohmann::json services = nlohmann::json::array();
+        snapshot->forEach([&services](const std::shared_ptr<Service>& service) {
+            services.push_back(serviceToJson(*service));
+        });
+        result["revision"] = snapshot->version();
+        result["full"] = true;
+        result["services"] = services;
+    }
+    
+    // Shared so every watch answered with this reply reuses the same body
+    response.sharedBody = std::make_shared<const std::string>(result.dump());
+    return response;
+}
+
+void ControlPlane::handleRegisterService(const HttpRequest& request, HttpResponder responder) {
     auto startTime = std::chrono::steady_clock::now();
     
     HttpResponse response;
     response.headers["Content-Type"] = "application/json";
+    if (redirectWrite(request, response)) {
+        responder.send(std::move(response));
+        return;
+    }
     
+    RegistryOperation operation{};
+    operation.type = RegistryOperation::Type::REGISTER;
     try {
         nlohmann::json requestJson = nlohmann::json::parse(request.body);
         
-        std::string id = requestJson.value("id", "");
-        std::string name = requestJson.value("name", "");
-        std::string host = requestJson.value("host", "localhost");
-        int port = requestJson.value("port", 0);
-        
-        if (id.empty() || name.empty() || port <= 0) {
+        std::string error;
+        operation.service = serviceFromJson(requestJson, error);
+        if (!operation.service) {
             response.status = 400;
-            response.body = "{\"error\": \"Missing required fields: id, name, port\"}";
-            return response;
-        }
-        
-        auto service = std::make_shared<Service>(id, name, host, port);
-        
-        // Set metadata if provided
-        if (requestJson.contains("metadata")) {
-            for (auto& [key, value] : requestJson["metadata"].items()) {
-                service->metadata[key] = value.get<std::string>();
-            }
+            response.body = "{\"error\": \"" + error + "\"}";
         }
+    } catch (const std::exception& e) {
+        response.status = 400;
+        response.body = "{\"error\": \"Invalid JSON: " + std::string(e.what()) + "\"}";
+    }
+    if (!operation.service) {
+        responder.send(std::move(response));
+        return;
+    }
+    
+    std::shared_ptr<Service> service = operation.service;
+    applyOperations({operation}, [this, service, startTime, responder](int status, const std::vector<bool>& applied) mutable {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
         
-        if (serviceRegistry_->registerService(service)) {
+        if (status != 200) {
+            setWriteError(response, status, "registration");
+        } else if (!applied[0]) {
+            response.status = 500;
+            response.body = "{\"error\": \"Failed to register service\"}";
+        } else {
             nlohmann::json result;
             result["success"] = true;
             result["message"] = "Service registered successfully";
             response.body = result.dump(4);
-            
-            std::cout << "Service registered: " << name << " (" << id << ") at " 
-                     << host << ":" << port << std::endl;
-        } else {
-            response.status = 500;
-            response.body = "{\"error\": \"Failed to register service\"}";
         }
         
         monitoring_->recordRequestCount("/api/services/register", "POST");
+        auto endTime = std::chrono::steady_clock::now();
+        auto duration = std::chrono::duration<double>(endTime - startTime).count();
+        monitoring_->recordRequestDuration("/api/services/register", duration);
         
-    } catch (const std::exception& e) {
-        response.status = 400;
-        response.body = "{\"error\": \"Invalid JSON: " + std::string(e.what()) + "\"}";
-    }
-    
-    auto endTime = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration<double>(endTime - startTime).count();
-    monitoring_->recordRequestDuration("/api/services/register", duration);
-    
-    return response;
+        responder.send(std::move(response));
+    });
 }
 
-HttpResponse ControlPlane::handleUnregisterService(const HttpRequest& request) {
+void ControlPlane::handleUnregisterService(const HttpRequest& request, HttpResponder responder) {
     auto startTime = std::chrono::steady_clock::now();
     
     HttpResponse response;
     response.headers["Content-Type"] = "application/json";
+    if (redirectWrite(request, response)) {
+        responder.send(std::move(response));
+        return;
+    }
     
+    RegistryOperation operation{};
+    operation.type = RegistryOperation::Type::UNREGISTER;
     try {
         nlohmann::json requestJson = nlohmann::json::parse(request.body);
-        std::string id = requestJson.value("id", "");
+        operation.serviceId = requestJson.value("id", "");
         
-        if (id.empty()) {
+        if (operation.serviceId.empty()) {
             response.status = 400;
             response.body = "{\"error\": \"Missing required field: id\"}";
-            return response;
         }
+    } catch (const std::exception& e) {
+        response.status = 400;
+        response.body = "{\"error\": \"Invalid JSON: " + std::string(e.what()) + "\"}";
+    }
+    if (operation.serviceId.empty()) {
+        responder.send(std::move(response));
+        return;
+    }
+    
+    std::string id = operation.serviceId;
+    applyOperations({operation}, [this, id, startTime, responder](int status, const std::vector<bool>& applied) mutable {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
         
-        if (serviceRegistry_->unregisterService(id)) {
+        if (status != 200) {
+            setWriteError(response, status, "unregistration");
+        } else if (!applied[0]) {
+            response.status = 404;
+            response.body = "{\"error\": \"Service not found\"}";
+        } else {
             nlohmann::json result;
             result["success"] = true;
             result["message"] = "Service unregistered successfully";
             response.body = result.dump(4);
-            
-            std::cout << "Service unregistered: " << id << std::endl;
+        }
+        
+        monitoring_->recordRequestCount("/api/services/unregister", "POST");
+        auto endTime = std::chrono::steady_clock::now();
+        auto duration = std::chrono::duration<double>(endTime - startTime).count();
+        monitoring_->recordRequestDuration("/api/services/unregister", duration);
+        
+        responder.send(std::move(response));
+    });
+}
+
+void ControlPlane::handleHeartbeat(const HttpRequest& request, HttpResponder responder) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    if (redirectWrite(request, response)) {
+        responder.send(std::move(response));
+        return;
+    }
+    
+    // No body to parse: the id in the path is all a heartbeat carries
+    RegistryOperation operation{};
+    operation.type = RegistryOperation::Type::HEARTBEAT;
+    operation.serviceId = std::string(request.params.at("id"));
+    applyOperations({operation}, [this, responder](int status, const std::vector<bool>& applied) mutable {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
+        
+        if (status != 200) {
+            setWriteError(response, status, "heartbeat");
+        } else if (applied[0]) {
+            response.body = "{\"success\": true}";
         } else {
             response.status = 404;
             response.body = "{\"error\": \"Service not found\"}";
         }
         
-        monitoring_->recordRequestCount("/api/services/unregister", "POST");
+        monitoring_->recordRequestCount("/api/services/:id/heartbeat", "POST");
+        responder.send(std::move(response));
+    });
+}
+
+void ControlPlane::handleBatch(const HttpRequest& request, HttpResponder responder) {
+    auto startTime = std::chrono::steady_clock::now();
+    
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    if (redirectWrite(request, response)) {
+        responder.send(std::move(response));
+        return;
+    }
+    
+    // Invalid items are answered here; the rest go to the registry together
+    nlohmann::json results = nlohmann::json::array();
+    std::vector<RegistryOperation> valid;
+    std::vector<size_t> positions;
+    try {
+        nlohmann::json requestJson = nlohmann::json::parse(request.body);
+        if (!requestJson.contains("operations") || !requestJson["operations"].is_array()) {
+            response.status = 400;
+            response.body = "{\"error\": \"Missing required field: operations\"}";
+            responder.send(std::move(response));
+            return;
+        }
+        const nlohmann::json& operations = requestJson["operations"];
+        if (operations.size() > kMaxBatchOperations) {
+            response.status = 413;
+            response.body = "{\"error\": \"Too many operations (at most " + std::to_string(kMaxBatchOperations) + ")\"}";
+            responder.send(std::move(response));
+            return;
+        }
         
+        for (const auto& item : operations) {
+            nlohmann::json result;
+            std::string op = item.is_object() ? item.value("op", "") : "";
+            result["op"] = op;
+            std::string error;
+            RegistryOperation operation{};
+            try {
+                if (op == "register") {
+                    operation.type = RegistryOperation::Type::REGISTER;
+                    operation.service = serviceFromJson(item, error);
+                    result["id"] = item.value("id", "");
+                } else if (op == "unregister" || op == "heartbeat") {
+                    operation.type = op == "unregister" ? RegistryOperation::Type::UNREGISTER
+                                                        : RegistryOperation::Type::HEARTBEAT;
+                    operation.serviceId = item.value("id", "");
+                    result["id"] = operation.serviceId;
+                    if (operation.serviceId.empty()) {
+                        error = "Missing required field: id";
+                    }
+                } else {
+                    error = "Unknown op, expected register, unregister or heartbeat";
+                }
+            } catch (const nlohmann::json::exception& e) {
+                error = std::string("Invalid JSON: ") + e.what();
+            }
+            
+            if (error.empty()) {
+                positions.push_back(results.size());
+                valid.push_back(std::move(operation));
+            } else {
+                result["status"] = 400;
+                result["error"] = error;
+            }
+            results.push_back(std::move(result));
+        }
     } catch (const std::exception& e) {
         response.status = 400;
         response.body = "{\"error\": \"Invalid JSON: " + std::string(e.what()) + "\"}";
+        responder.send(std::move(response));
+        return;
     }
     
-    auto endTime = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration<double>(endTime - startTime).count();
-    monitoring_->recordRequestDuration("/api/services/unregister", duration);
+    auto done = [this, results = std::move(results), positions = std::move(positions), startTime, responder]
+                (int status, const std::vector<bool>& applied) mutable {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
+        
+        if (status != 200) {
+            setWriteError(response, status, "batch");
+            responder.send(std::move(response));
+            return;
+        }
+        
+        size_t succeeded = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            nlohmann::json& result = results[positions[i]];
+            if (applied[i]) {
+                result["status"] = 200;
+                ++succeeded;
+            } else {
+                result["status"] = 404;
+                result["error"] = "Service not found";
+            }
+        }
+        
+        size_t total = results.size();
+        nlohmann::json body;
+        body["results"] = std::move(results);
+        body["succeeded"] = succeeded;
+        body["failed"] = total - succeeded;
+        body["revision"] = serviceRegistry_->version();
+        response.body = body.dump(4);
+        
+        monitoring_->recordRequestCount("/api/services/batch", "POST");
+        auto endTime = std::chrono::steady_clock::now();
+        auto duration = std::chrono::duration<double>(endTime - startTime).count();
+        monitoring_->recordRequestDuration("/api/services/batch", duration);
+        
+        responder.send(std::move(response));
+    };
+    applyOperations(valid, std::move(done));
+}
+
+void ControlPlane::applyOperations(const std::vector<RegistryOperation>& operations,
+                                   std::function<void(int status, const std::vector<bool>& applied)> done) {
+    if (gossip_) {
+        // Members usually join the group before they register: start them
+        // from the group's view rather than waiting for their next change
+        for (const auto& operation : operations) {
+            GossipMember::Member member;
+            const std::string* probe = operation.service ? operation.service->metadata->find("probe") : nullptr;
+            if (probe && *probe == "gossip" && gossip_->find(operation.service->id, member) &&
+                member.state != GossipMember::State::SUSPECT) {
+                operation.service->status = member.state == GossipMember::State::ALIVE ? ServiceStatus::HEALTHY
+                                                                                      : ServiceStatus::UNHEALTHY;
+            }
+        }
+    }
+    if (!replicatedRegistry_) {
+        std::vector<bool> applied = serviceRegistry_->apply(operations);
+        done(persistChanges() ? 200 : 500, applied);
+        return;
+    }
     
-    return response;
+    // Answered from the apply thread once the entry commits here
+    bool proposed = replicatedRegistry_->submit(operations, [done](bool committed, const std::vector<bool>& applied) {
+        done(committed ? 200 : 503, applied);
+    });
+    if (!proposed) {
+        done(503, std::vector<bool>(operations.size(), false)); // lost leadership since redirectWrite
+    }
+}
+
+void ControlPlane::applyConfig(const nlohmann::json& sections, std::function<void(int status)> done) {
+    if (!replicatedRegistry_) {
+        for (auto& [section, values] : sections.items()) {
+            configManager_->setSection(section, values);
+        }
+        done(persistChanges() ? 200 : 500);
+        return;
+    }
+    
+    bool proposed = replicatedRegistry_->submitConfig(sections, [done](bool committed, const std::vector<bool>&) {
+        done(committed ? 200 : 503);
+    });
+    if (!proposed) {
+        done(503);
+    }
+}
+
+bool ControlPlane::redirectWrite(const HttpRequest& request, HttpResponse& response) {
+    if (!replicatedRegistry_ || replicatedRegistry_->isLeader()) {
+        return false;
+    }
+    return redirectToLeader(request, response);
+}
+
+bool ControlPlane::redirectStaleRead(const HttpRequest& request, HttpResponse& response) {
+    if (!replicatedRegistry_ || replicatedRegistry_->readable()) {
+        return false;
+    }
+    if (replicatedRegistry_->isLeader()) {
+        // A leader that has yet to apply its first entry, or lost its quorum
+        response.status = 503;
+        response.headers["Retry-After"] = "1";
+        response.body = "{\"error\": \"Leader cannot confirm its state is current\"}";
+        return true;
+    }
+    return redirectToLeader(request, response);
+}
+
+bool ControlPlane::redirectToLeader(const HttpRequest& request, HttpResponse& response) {
+    std::string leader = replicatedRegistry_->leaderAddress();
+    if (leader.empty()) {
+        response.status = 503;
+        response.headers["Retry-After"] = "1";
+        response.body = "{\"error\": \"No leader elected\"}";
+        return true;
+    }
+    
+    // 307 keeps the method and body, so clients simply resend to the leader
+    std::string location = "http://" + leader + std::string(request.path);
+    if (!request.query.empty()) {
+        location += "?" + std::string(request.query);
+    }
+    response.status = 307;
+    response.headers["Location"] = location;
+    response.body = "{\"error\": \"Not the leader\", \"leader\": \"" + leader + "\"}";
+    return true;
+}
+
+void ControlPlane::recordServerMetrics() {
+    static const char* const kPriorityNames[] = {"high", "normal", "low"};
+    
+    HttpServerStats stats = httpServer_->getStats();
+    for (size_t i = 0; i < ThreadPool::kPriorityLevels; ++i) {
+        monitoring_->setGauge("http_queue_depth", static_cast<double>(stats.queueDepth[i]),
+                              {{"priority", kPriorityNames[i]}});
+    }
+    monitoring_->setCounter("http_requests_shed_total", static_cast<double>(stats.shedQueueFull),
+                            {{"reason", "queue_full"}});
+    monitoring_->setCounter("http_requests_shed_total", static_cast<double>(stats.shedRouteLimit),
+                            {{"reason", "route_limit"}});
+    
+    static const char* const kTimeoutNames[] = {"header", "body", "idle", "write"};
+    for (size_t i = 0; i < kConnectionTimeoutKinds; ++i) {
+        monitoring_->setCounter("http_connection_timeouts_total", static_cast<double>(stats.timeouts[i]),
+                                {{"phase", kTimeoutNames[i]}});
+    }
+    
+    monitoring_->setGauge("registry_revision", static_cast<double>(serviceRegistry_->version()));
+    monitoring_->setGauge("registry_watchers", static_cast<double>(registryWatch_->parkedWatchers()));
+    monitoring_->setGauge("registry_leases", static_cast<double>(serviceRegistry_->leaseCount()));
+    if (registryStore_) {
+        monitoring_->setGauge("registry_wal_bytes", static_cast<double>(registryStore_->logBytes()));
+        monitoring_->setCounter("registry_wal_syncs_total", static_cast<double>(registryStore_->syncCount()));
+        monitoring_->setCounter("registry_snapshots_total", static_cast<double>(registryStore_->snapshotCount()));
+    }
+    if (replicatedRegistry_) {
+        RaftNode::Status status = replicatedRegistry_->node().status();
+        monitoring_->setGauge("raft_term", static_cast<double>(status.term));
+        monitoring_->setGauge("raft_leader", status.role == RaftNode::Role::LEADER ? 1.0 : 0.0);
+        monitoring_->setGauge("raft_commit_index", static_cast<double>(status.commitIndex));
+        monitoring_->setGauge("raft_applied_index", static_cast<double>(status.lastApplied));
+        monitoring_->setCounter("registry_snapshots_total", static_cast<double>(status.snapshots));
+    }
+    ProbeTotals probes = healthChecker_->getProbeTotals();
+    monitoring_->setCounter("health_probe_connections_total", static_cast<double>(probes.connectionsOpened),
+                            {{"connection", "new"}});
+    monitoring_->setCounter("health_probe_connections_total", static_cast<double>(probes.connectionsReused),
+                            {{"connection", "reused"}});
+    monitoring_->setGauge("health_probe_idle_connections", static_cast<double>(probes.idleConnections));
+    if (gossip_) {
+        static const GossipMember::State kStates[] = {GossipMember::State::ALIVE, GossipMember::State::SUSPECT,
+                                                      GossipMember::State::DEAD, GossipMember::State::LEFT};
+        size_t counts[std::size(kStates)] = {};
+        for (const auto& member : gossip_->members()) {
+            ++counts[static_cast<size_t>(member.state) - 1];
+        }
+        for (size_t i = 0; i < std::size(kStates); ++i) {
+            monitoring_->setGauge("gossip_members", static_cast<double>(counts[i]),
+                                  {{"state", GossipMember::toString(kStates[i])}});
+        }
+        GossipMember::Stats stats = gossip_->stats();
+        monitoring_->setCounter("gossip_messages_sent_total", static_cast<double>(stats.messagesSent));
+        monitoring_->setCounter("gossip_bytes_sent_total", static_cast<double>(stats.bytesSent));
+    }
+}
+
+bool ControlPlane::writeServiceStatus(const std::string& serviceId, ServiceStatus status) {
+    if (replicatedRegistry_) {
+        return replicatedRegistry_->proposeStatus(serviceId, status); // false on followers
+    }
+    return serviceRegistry_->updateServiceStatus(serviceId, status);
+}
+
+void ControlPlane::handleGossipChange(const GossipMember::Member& member) {
+    // A suspect may yet refute; only alive and dead are verdicts
+    ServiceStatus status;
+    if (member.state == GossipMember::State::ALIVE) {
+        status = ServiceStatus::HEALTHY;
+    } else if (member.state == GossipMember::State::DEAD || member.state == GossipMember::State::LEFT) {
+        status = ServiceStatus::UNHEALTHY;
+    } else {
+        return;
+    }
+    auto service = serviceRegistry_->getService(member.id);
+    if (!service || service->status == status) {
+        return;
+    }
+    const std::string* probe = service->metadata->find("probe");
+    if (!probe || *probe != "gossip") {
+        return; // probed by the health checker
+    }
+    if (writeServiceStatus(service->id, status)) {
+        std::cout << "Service " << service->name << " (" << service->id << ") status changed to: "
+                  << toString(status) << " (gossip: " << GossipMember::toString(member.state) << ")\n";
+    }
+}
+
+bool ControlPlane::persistChanges() {
+    // Group commit: concurrent handlers waiting here share one fsync
+    return !registryStore_ || registryStore_->sync();
 }
 
 HttpResponse ControlPlane::handleGetMetrics(const HttpRequest& request) {
     HttpResponse response;
     
-    std::string format = request.params.count("format") ? request.params.at("format") : "prometheus";
+    recordServerMetrics();
+    
+    std::string_view format = request.params.get("format", "prometheus");
     
     if (format == "json") {
         response.headers["Content-Type"] = "application/json";
@@ -254,33 +1045,115 @@ HttpResponse ControlPlane::handleGetMetrics(const HttpRequest& request) {
 HttpResponse ControlPlane::handleGetConfig(const HttpRequest& request) {
     HttpResponse response;
     response.headers["Content-Type"] = "application/json";
+    if (redirectStaleRead(request, response)) {
+        return response;
+    }
     response.body = configManager_->toString();
     return response;
 }
 
-HttpResponse ControlPlane::handleUpdateConfig(const HttpRequest& request) {
+void ControlPlane::handleUpdateConfig(const HttpRequest& request, HttpResponder responder) {
     HttpResponse response;
     response.headers["Content-Type"] = "application/json";
+    if (redirectWrite(request, response)) {
+        responder.send(std::move(response));
+        return;
+    }
     
+    nlohmann::json configJson;
     try {
-        nlohmann::json configJson = nlohmann::json::parse(request.body);
-        
-        for (auto& [section, values] : configJson.items()) {
-            configManager_->setSection(section, values);
-        }
-        
-        configManager_->saveConfig();
-        
-        nlohmann::json result;
-        result["success"] = true;
-        result["message"] = "Configuration updated successfully";
-        response.body = result.dump(4);
-        
+        configJson = nlohmann::json::parse(request.body);
     } catch (const std::exception& e) {
         response.status = 400;
         response.body = "{\"error\": \"" + std::string(e.what()) + "\"}";
+        responder.send(std::move(response));
+        return;
     }
     
+    applyConfig(configJson, [responder](int status) mutable {
+        HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
+        
+        if (status != 200) {
+            setWriteError(response, status, "configuration");
+        } else {
+            nlohmann::json result;
+            result["success"] = true;
+            result["message"] = "Configuration updated successfully";
+            response.body = result.dump(4);
+        }
+        
+        responder.send(std::move(response));
+    });
+}
+
+HttpResponse ControlPlane::handleGetCluster(const HttpRequest& request) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    response.body = replicatedRegistry_ ? replicatedRegistry_->status().dump(4) : "{\"enabled\": false}";
+    return response;
+}
+
+HttpResponse ControlPlane::handleGetHealth(const HttpRequest& request) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    
+    std::vector<ProbeStats> stats = healthChecker_->getProbeStats();
+    std::sort(stats.begin(), stats.end(),
+              [](const ProbeStats& a, const ProbeStats& b) { return a.serviceId < b.serviceId; });
+    nlohmann::json instances = nlohmann::json::array();
+    for (const auto& probe : stats) {
+        nlohmann::json entry = {{"id", probe.serviceId},
+                                {"probe", probe.probe},
+                                {"status", toString(probe.status)},
+                                {"successes", probe.successes},
+                                {"failures", probe.failures},
+                                {"checkedAt", std::chrono::system_clock::to_time_t(probe.checkedAt)}};
+        if (std::string(probe.probe) != "gossip") {
+            entry["rttMs"] = probe.rtt.count() / 1000.0;
+        }
+        if (probe.httpStatus != 0) {
+            entry["httpStatus"] = probe.httpStatus;
+            entry["reused"] = probe.reused;
+        }
+        instances.push_back(std::move(entry));
+    }
+    ProbeTotals totals = healthChecker_->getProbeTotals();
+    nlohmann::json result;
+    result["instances"] = std::move(instances);
+    result["connections"] = {{"opened", totals.connectionsOpened},
+                             {"reused", totals.connectionsReused},
+                             {"idle", totals.idleConnections}};
+    response.body = result.dump(4);
+    return response;
+}
+
+HttpResponse ControlPlane::handleGetGossip(const HttpRequest& request) {
+    HttpResponse response;
+    response.headers["Content-Type"] = "application/json";
+    if (!gossip_) {
+        response.body = "{\"enabled\": false}";
+        return response;
+    }
+    
+    nlohmann::json members = nlohmann::json::array();
+    for (const auto& member : gossip_->members()) {
+        members.push_back({{"id", member.id},
+                           {"address", member.address},
+                           {"state", GossipMember::toString(member.state)},
+                           {"incarnation", member.incarnation}});
+    }
+    GossipMember::Stats stats = gossip_->stats();
+    nlohmann::json result;
+    result["enabled"] = true;
+    result["id"] = gossip_->id();
+    result["alive"] = gossip_->aliveCount();
+    result["members"] = std::move(members);
+    result["stats"] = {{"messagesSent", stats.messagesSent},
+                       {"bytesSent", stats.bytesSent},
+                       {"messagesReceived", stats.messagesReceived},
+                       {"bytesReceived", stats.bytesReceived}};
+    response.body = result.dump(4);
     return response;
 }
 
@@ -346,26 +1219,49 @@ HttpResponse ControlPlane::handleDashboard(const HttpRequest& request) {
     </div>
     
     <script>
-        function refreshServices() {
-            fetch('/api/services')
+        // Kept current by long-polling the registry watch instead of re-reading the list
+        let services = new Map();
+        let revision = null;
+        
+        function renderServices() {
+            const container = document.getElementById('services');
+            if (services.size === 0) {
+                container.innerHTML = '<p>No services registered</p>';
+                return;
+            }
+            container.innerHTML = Array.from(services.values()).map(service => 
+                '<div class="service ' + service.status + '">' +
+                '<strong>' + service.name + '</strong> (' + service.id + ')<br>' +
+                'Location: ' + service.host + ':' + service.port + '<br>' +
+                'Status: ' + service.status.toUpperCase() +
+                '</div>'
+            ).join('');
+        }
+        
+        function watchServices() {
+            const url = revision === null ? '/api/services/watch' : '/api/services/watch?revision=' + revision;
+            fetch(url)
                 .then(response => response.json())
-                .then(services => {
-                    const container = document.getElementById('services');
-                    if (services.length === 0) {
-                        container.innerHTML = '<p>No services registered</p>';
-                        return;
+                .then(update => {
+                    if (update.full) {
+                        services = new Map(update.services.map(service => [service.id, service]));
+                    } else {
+                        update.events.forEach(event => {
+                            if (event.type === 'unregistered') {
+                                services.delete(event.service.id);
+                            } else {
+                                services.set(event.service.id, event.service);
+                            }
+                        });
                     }
-                    container.innerHTML = services.map(service => 
-                        '<div class="service ' + service.status + '">' +
-                        '<strong>' + service.name + '</strong> (' + service.id + ')<br>' +
-                        'Location: ' + service.host + ':' + service.port + '<br>' +
-                        'Status: ' + service.status.toUpperCase() +
-                        '</div>'
-                    ).join('');
+                    revision = update.revision;
+                    renderServices();
+                    watchServices();
                 })
                 .catch(error => {
                     document.getElementById('services').innerHTML = '<p>Error loading services</p>';
                     console.error('Error:', error);
+                    setTimeout(watchServices, 5000);
                 });
         }
         
@@ -407,7 +1303,6 @@ HttpResponse ControlPlane::handleDashboard(const HttpRequest& request) {
                 if (result.success) {
                     alert('Service registered successfully!');
                     document.querySelector('form').reset();
-                    refreshServices();
                 } else {
                     alert('Error: ' + result.error);
                 }
@@ -418,12 +1313,9 @@ HttpResponse ControlPlane::handleDashboard(const HttpRequest& request) {
             });
         }
         
-        setInterval(function() {
-            refreshServices();
-            refreshMetrics();
-        }, 10000);
+        setInterval(refreshMetrics, 10000);
         
-        refreshServices();
+        watchServices();
         refreshMetrics();
     </script>
 </body>
@@ -0,0 +1,734 @@
+#include "gossip_member.h"
+#include "net_address.h"
+#include "registry_record.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace dcp {
+
+namespace {
+
+// Every packet starts with the version, the type, a sequence number and
+// the sender's id, and ends with a count of updates and the updates
+enum class MessageType : uint8_t {
+    PING = 1,     // target id; answered with an ACK of the same seq
+    ACK = 2,
+    PING_REQ = 3, // target id and address: ping it and forward its ACK
+    SYNC_REQ = 4, // answered with SYNCs carrying every member
+    SYNC = 5      // updates only
+};
+
+constexpr uint8_t kVersion = 1;
+constexpr size_t kMaxPacket = 1400; // within an Ethernet MTU
+constexpr size_t kMinEncoded = 19;   // an update with one-byte id and address
+constexpr size_t kReceiveBatch = 64;
+constexpr int kSocketBufferBytes = 4 << 20;
+constexpr size_t kLeaveNotices = 3;
+
+using Member = GossipMember::Member;
+using State = GossipMember::State;
+
+// host:port, or [v6]:port
+bool splitAddress(const std::string& address, std::string& host, uint16_t& port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size()) {
+        return false;
+    }
+    unsigned long value = 0;
+    for (size_t i = colon + 1; i < address.size(); ++i) {
+        if (address[i] < '0' || address[i] > '9' || (value = value * 10 + (address[i] - '0')) > 65535) {
+            return false;
+        }
+    }
+    host = address.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+std::string joinAddress(const std::string& host, uint16_t port) {
+    bool v6 = host.find(':') != std::string::npos;
+    return (v6 ? "[" + host + "]" : host) + ":" + std::to_string(port);
+}
+
+bool isWildcard(const std::string& host) {
+    return host.empty() || host == "0.0.0.0" || host == "::";
+}
+
+NetAddress sourceAddress(const sockaddr_storage& from) {
+    if (from.ss_family == AF_INET) {
+        const auto* addr = reinterpret_cast<const sockaddr_in*>(&from);
+        return NetAddress::fromBytes(AF_INET, reinterpret_cast<const uint8_t*>(&addr->sin_addr));
+    }
+    if (from.ss_family == AF_INET6) {
+        const auto* addr = reinterpret_cast<const sockaddr_in6*>(&from);
+        return NetAddress::fromBytes(AF_INET6, reinterpret_cast<const uint8_t*>(&addr->sin6_addr));
+    }
+    return NetAddress();
+}
+
+size_t encodedSize(const Member& member) {
+    return sizeof(uint8_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t) + member.id.size() + member.address.size();
+}
+
+void encodeMember(const Member& member, std::string& out) {
+    RecordWriter writer(out);
+    writer.put(static_cast<uint8_t>(member.state));
+    writer.put(member.incarnation);
+    writer.put(member.id);
+    writer.put(member.address);
+}
+
+bool live(State state) {
+    return state == State::ALIVE || state == State::SUSPECT;
+}
+
+} // namespace
+
+GossipMember::GossipMember(const Options& options, EventHandler onChange)
+    : options_(options), onChange_(std::move(onChange)), fd_(-1), wakeFd_(-1), family_(AF_INET),
+      incarnation_(0), livePeers_(0), probeNext_(0), broadcastOrder_(0), nextSeq_(1), random_(std::random_device()()), probeSeq_(0),
+      probeAcked_(false), indirectSent_(false), messagesSent_(0), bytesSent_(0), messagesReceived_(0),
+      bytesReceived_(0), running_(false) {
+}
+
+GossipMember::~GossipMember() {
+    stop();
+}
+
+bool GossipMember::start() {
+    if (running_) {
+        return true;
+    }
+
+    std::string host;
+    uint16_t port = 0;
+    sockaddr_storage bindAddr;
+    socklen_t bindLen = 0;
+    if (!splitAddress(options_.bindAddress, host, port) ||
+        (bindLen = NetAddress::parse(host.empty() ? "0.0.0.0" : host).toSockaddr(port, bindAddr)) == 0) {
+        std::cerr << "Invalid gossip bind address: " << options_.bindAddress << std::endl;
+        return false;
+    }
+    family_ = bindAddr.ss_family;
+    fd_ = socket(family_, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ < 0 || wakeFd_ < 0 || bind(fd_, reinterpret_cast<sockaddr*>(&bindAddr), bindLen) != 0) {
+        std::cerr << "Failed to bind gossip socket to " << options_.bindAddress << ": " << std::strerror(errno)
+                  << std::endl;
+        stop();
+        return false;
+    }
+    // Joins answer with the whole member list at once
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kSocketBufferBytes, sizeof(kSocketBufferBytes));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &kSocketBufferBytes, sizeof(kSocketBufferBytes));
+    if (port == 0) {
+        sockaddr_storage bound;
+        socklen_t boundLen = sizeof(bound);
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&bound), &boundLen);
+        port = ntohs(family_ == AF_INET ? reinterpret_cast<sockaddr_in*>(&bound)->sin_port
+                                        : reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    address_ = options_.advertiseAddress.empty() ? joinAddress(host, port) : options_.advertiseAddress;
+    for (const auto& seed : options_.seeds) {
+        sockaddr_storage addr;
+        socklen_t length;
+        if (resolve(seed, addr, length)) {
+            requestSync(addr, length);
+        } else {
+            std::cerr << "Cannot resolve gossip seed " << seed << std::endl;
+        }
+    }
+    periodEnd_ = Clock::now();
+    nextSync_ = periodEnd_ + options_.syncInterval;
+    running_ = true;
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void GossipMember::stop() {
+    if (running_) {
+        {
+            // Leaving is news like any other; a few members are enough to spread it
+            std::lock_guard<std::mutex> lock(mutex_);
+            Member left = self();
+            left.state = State::LEFT;
+            std::string packet = header(static_cast<uint8_t>(MessageType::SYNC), 0);
+            RecordWriter(packet).put(static_cast<uint16_t>(1));
+            encodeMember(left, packet);
+            for (Peer* peer : randomPeers(kLeaveNotices, std::string())) {
+                send(packet, peer->addr, peer->addrLen);
+            }
+        }
+        running_ = false;
+        uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) < 0) {
+            // The poll timeout ends the loop anyway
+        }
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+    }
+}
+
+std::vector<Member> GossipMember::members() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Member> result;
+    result.reserve(peers_.size() + 1);
+    result.push_back(self());
+    for (const auto& [id, peer] : peers_) {
+        result.push_back(peer.member);
+    }
+    return result;
+}
+
+bool GossipMember::find(const std::string& id, Member& member) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id == options_.id) {
+        member = self();
+        return true;
+    }
+    auto it = peers_.find(id);
+    if (it == peers_.end()) {
+        return false;
+    }
+    member = it->second.member;
+    return true;
+}
+
+size_t GossipMember::aliveCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return liveCount() + 1;
+}
+
+GossipMember::Stats GossipMember::stats() const {
+    Stats stats;
+    stats.messagesSent = messagesSent_;
+    stats.bytesSent = bytesSent_;
+    stats.messagesReceived = messagesReceived_;
+    stats.bytesReceived = bytesReceived_;
+    return stats;
+}
+
+const char* GossipMember::toString(State state) {
+    switch (state) {
+        case State::ALIVE: return "alive";
+        case State::SUSPECT: return "suspect";
+        case State::DEAD: return "dead";
+        case State::LEFT: return "left";
+    }
+    return "unknown";
+}
+
+Member GossipMember::self() const {
+    Member member;
+    member.id = options_.id;
+    member.address = address_;
+    member.state = State::ALIVE;
+    member.incarnation = incarnation_;
+    return member;
+}
+
+std::chrono::milliseconds GossipMember::suspicionTimeout() const {
+    double scale = std::max(1.0, std::log10(static_cast<double>(liveCount() + 1)));
+    return std::chrono::milliseconds(
+        static_cast<int64_t>(options_.suspicionMultiplier * scale * options_.protocolPeriod.count()));
+}
+
+bool GossipMember::resolve(const std::string& address, sockaddr_storage& out, socklen_t& length) const {
+    std::string host;
+    uint16_t port = 0;
+    if (!splitAddress(address, host, port) || isWildcard(host)) {
+        return false;
+    }
+    NetAddress literal = NetAddress::parse(host);
+    if (literal.valid()) {
+        length = literal.toSockaddr(port, out);
+        return length > 0;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = family_;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &results) != 0 || !results) {
+        return false;
+    }
+    std::memcpy(&out, results->ai_addr, results->ai_addrlen);
+    length = results->ai_addrlen;
+    freeaddrinfo(results);
+    return true;
+}
+
+void GossipMember::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto now = Clock::now();
+        runTimers(now);
+
+        Clock::time_point wake = periodEnd_;
+        if (!probeTarget_.empty() && !probeAcked_ && !indirectSent_) {
+            wake = std::min(wake, probeStart_ + options_.pingTimeout);
+        }
+        if (!suspicions_.empty()) {
+            wake = std::min(wake, suspicions_.top().deadline);
+        }
+        if (options_.syncInterval.count() > 0) {
+            wake = std::min(wake, nextSync_);
+        }
+        dispatchChanges(lock);
+
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(wake - Clock::now());
+        pollfd fds[2] = {{fd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        lock.unlock();
+        poll(fds, 2, static_cast<int>(std::max<int64_t>(0, wait.count())));
+        lock.lock();
+        if (fds[0].revents & POLLIN) {
+            receive();
+        }
+    }
+    dispatchChanges(lock);
+}
+
+void GossipMember::receive() {
+    char buffer[65536];
+    for (size_t i = 0; i < kReceiveBatch; ++i) {
+        sockaddr_storage from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t n = recvfrom(fd_, buffer, sizeof(buffer), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &fromLen);
+        if (n < 0) {
+            return;
+        }
+        ++messagesReceived_;
+        bytesReceived_ += static_cast<uint64_t>(n);
+        handlePacket(buffer, static_cast<size_t>(n), from, fromLen);
+    }
+}
+
+void GossipMember::handlePacket(const char* data, size_t size, const sockaddr_storage& from, socklen_t fromLen) {
+    RecordReader reader(data, size);
+    uint8_t version = reader.get<uint8_t>();
+    auto type = static_cast<MessageType>(reader.get<uint8_t>());
+    uint32_t seq = reader.get<uint32_t>();
+    std::string sender = reader.getString();
+    std::string target;
+    std::string targetAddress;
+    if (type == MessageType::PING || type == MessageType::PING_REQ) {
+        target = reader.getString();
+    }
+    if (type == MessageType::PING_REQ) {
+        targetAddress = reader.getString();
+    }
+    uint16_t count = reader.get<uint16_t>();
+    std::vector<Member> updates(reader.ok() ? count : 0);
+    for (auto& update : updates) {
+        uint8_t state = reader.get<uint8_t>();
+        update.state = static_cast<State>(state);
+        update.incarnation = reader.get<uint64_t>();
+        update.id = reader.getString();
+        update.address = reader.getString();
+        if (state < static_cast<uint8_t>(State::ALIVE) || state > static_cast<uint8_t>(State::LEFT)) {
+            return;
+        }
+    }
+    if (!reader.complete() || version != kVersion || sender.empty()) {
+        return;
+    }
+    for (auto& update : updates) {
+        applyUpdate(std::move(update), sender, from);
+    }
+
+    switch (type) {
+        case MessageType::PING: {
+            if (target != options_.id) {
+                return; // meant for whoever had this address before
+            }
+            // A sender held suspect or dead is told, so it can refute even
+            // after the news has stopped circulating
+            auto known = peers_.find(sender);
+            const Member* refutable = known != peers_.end() && known->second.member.state != State::ALIVE
+                                          ? &known->second.member
+                                          : nullptr;
+            std::string packet = header(static_cast<uint8_t>(MessageType::ACK), seq);
+            appendBroadcasts(packet, refutable);
+            send(packet, from, fromLen);
+            break;
+        }
+        case MessageType::ACK: {
+            if (!probeTarget_.empty() && seq == probeSeq_) {
+                probeAcked_ = true;
+                break;
+            }
+            auto relay = relays_.find(seq);
+            if (relay != relays_.end()) {
+                std::string packet = header(static_cast<uint8_t>(MessageType::ACK), relay->second.seq);
+                appendBroadcasts(packet);
+                send(packet, relay->second.requester, relay->second.requesterLen);
+                relays_.erase(relay);
+            }
+            break;
+        }
+        case MessageType::PING_REQ: {
+            sockaddr_storage addr;
+            socklen_t length = 0;
+            auto peer = peers_.find(target);
+            if (peer != peers_.end()) {
+                addr = peer->second.addr;
+                length = peer->second.addrLen;
+            } else if (!resolve(targetAddress, addr, length)) {
+                return;
+            }
+            uint32_t relaySeq = nextSeq_++;
+            relays_[relaySeq] = Relay{from, fromLen, seq, Clock::now() + options_.protocolPeriod};
+            std::string packet = header(static_cast<uint8_t>(MessageType::PING), relaySeq);
+            RecordWriter(packet).put(target);
+            appendBroadcasts(packet);
+            send(packet, addr, length);
+            break;
+        }
+        case MessageType::SYNC_REQ:
+            sendSync(from, fromLen);
+            break;
+        case MessageType::SYNC:
+            break;
+    }
+}
+
+void GossipMember::applyUpdate(Member update, const std::string& sender, const sockaddr_storage& from) {
+    if (update.id.empty()) {
+        return;
+    }
+    if (update.id == options_.id) {
+        if (update.state != State::ALIVE && update.incarnation >= incarnation_) {
+            // Refute: a higher incarnation outranks the suspicion everywhere
+            incarnation_ = update.incarnation + 1;
+            queueBroadcast(self());
+        }
+        return;
+    }
+
+    // A member bound to a wildcard address is reached where its packets come from
+    std::string host;
+    uint16_t port = 0;
+    if (update.id == sender && splitAddress(update.address, host, port) && isWildcard(host)) {
+        NetAddress source = sourceAddress(from);
+        if (source.valid()) {
+            update.address = joinAddress(source.toString(), port);
+        }
+    }
+
+    auto now = Clock::now();
+    auto it = peers_.find(update.id);
+    if (it == peers_.end()) {
+        if (!live(update.state)) {
+            return; // nothing to forget
+        }
+        Peer peer;
+        if (!resolve(update.address, peer.addr, peer.addrLen)) {
+            return;
+        }
+        peer.member = update;
+        peer.changedAt = now;
+        peers_.emplace(update.id, std::move(peer));
+        ++livePeers_;
+        // Probed within one pass of the round robin
+        size_t first = std::min(probeNext_, probeOrder_.size());
+        std::uniform_int_distribution<size_t> position(first, probeOrder_.size());
+        probeOrder_.insert(probeOrder_.begin() + static_cast<std::ptrdiff_t>(position(random_)), update.id);
+    } else {
+        const Member& known = it->second.member;
+        bool accept = false;
+        switch (update.state) {
+            case State::ALIVE:
+                accept = update.incarnation > known.incarnation;
+                break;
+            case State::SUSPECT:
+                accept = (known.state == State::ALIVE && update.incarnation >= known.incarnation) ||
+                         (known.state == State::SUSPECT && update.incarnation > known.incarnation);
+                break;
+            case State::DEAD:
+            case State::LEFT:
+                accept = (live(known.state) && update.incarnation >= known.incarnation) ||
+                         update.incarnation > known.incarnation;
+                break;
+        }
+        if (!accept) {
+            return;
+        }
+        if (update.address != known.address &&
+            !resolve(update.address, it->second.addr, it->second.addrLen)) {
+            return;
+        }
+        if (live(known.state) != live(update.state)) {
+            live(update.state) ? ++livePeers_ : --livePeers_;
+        }
+        it->second.member = update;
+        it->second.changedAt = now;
+    }
+
+    if (update.state == State::SUSPECT) {
+        suspicions_.push(Suspicion{now + suspicionTimeout(), update.id, update.incarnation});
+    }
+    queueBroadcast(update);
+    changes_.push_back(std::move(update));
+}
+
+void GossipMember::queueBroadcast(const Member& update) {
+    auto queued = queued_.find(update.id);
+    if (queued != queued_.end()) {
+        broadcasts_.erase(queued->second); // the older news is moot
+    }
+    queued_[update.id] = broadcasts_.insert(Broadcast{0, ++broadcastOrder_, update}).first;
+}
+
+void GossipMember::runTimers(Clock::time_point now) {
+    while (!suspicions_.empty() && suspicions_.top().deadline <= now) {
+        Suspicion suspicion = suspicions_.top();
+        suspicions_.pop();
+        auto it = peers_.find(suspicion.id);
+        if (it != peers_.end() && it->second.member.state == State::SUSPECT &&
+            it->second.member.incarnation == suspicion.incarnation) {
+            Member dead = it->second.member;
+            dead.state = State::DEAD;
+            applyUpdate(std::move(dead), std::string(), sockaddr_storage{});
+        }
+    }
+
+    if (!probeTarget_.empty() && !probeAcked_ && !indirectSent_ && now >= probeStart_ + options_.pingTimeout) {
+        // No direct ack: let others try, in case only our path to it is bad
+        indirectSent_ = true;
+        auto target = peers_.find(probeTarget_);
+        if (target != peers_.end()) {
+            for (Peer* helper : randomPeers(options_.indirectProbes, probeTarget_)) {
+                std::string packet = header(static_cast<uint8_t>(MessageType::PING_REQ), probeSeq_);
+                RecordWriter writer(packet);
+                writer.put(target->second.member.id);
+                writer.put(target->second.member.address);
+                appendBroadcasts(packet);
+                send(packet, helper->addr, helper->addrLen);
+            }
+        }
+    }
+
+    if (now >= periodEnd_) {
+        if (!probeTarget_.empty() && !probeAcked_) {
+            auto target = peers_.find(probeTarget_);
+            if (target != peers_.end() && target->second.member.state == State::ALIVE) {
+                suspect(target->second);
+            }
+        }
+
+        for (auto it = relays_.begin(); it != relays_.end();) {
+            it = it->second.expires <= now ? relays_.erase(it) : std::next(it);
+        }
+        for (auto it = peers_.begin(); it != peers_.end();) {
+            bool forget = !live(it->second.member.state) && now - it->second.changedAt >= options_.deadRetention;
+            it = forget ? peers_.erase(it) : std::next(it);
+        }
+        startProbe(now);
+    }
+
+    if (options_.syncInterval.count() > 0 && now >= nextSync_) {
+        nextSync_ = now + options_.syncInterval;
+        for (Peer* peer : randomPeers(1, std::string())) {
+            requestSync(peer->addr, peer->addrLen);
+        }
+    }
+}
+
+void GossipMember::startProbe(Clock::time_point now) {
+    probeTarget_.clear();
+    probeAcked_ = false;
+    indirectSent_ = false;
+    probeStart_ = now;
+    periodEnd_ = now + options_.protocolPeriod;
+
+    if (liveCount() == 0) {
+        // Alone: keep knocking on the seeds until one answers
+        for (const auto& seed : options_.seeds) {
+            sockaddr_storage addr;
+            socklen_t length;
+            if (resolve(seed, addr, length)) {
+                requestSync(addr, length);
+            }
+        }
+        return;
+    }
+
+    for (;;) {
+        if (probeNext_ >= probeOrder_.size()) {
+            // Next pass over a fresh shuffle of everyone alive
+            probeOrder_.clear();
+            for (const auto& [id, peer] : peers_) {
+                if (live(peer.member.state)) {
+                    probeOrder_.push_back(id);
+                }
+            }
+            std::shuffle(probeOrder_.begin(), probeOrder_.end(), random_);
+            probeNext_ = 0;
+        }
+        auto it = peers_.find(probeOrder_[probeNext_++]);
+        if (it == peers_.end() || !live(it->second.member.state)) {
+            continue;
+        }
+        probeTarget_ = it->first;
+        probeSeq_ = nextSeq_++;
+        std::string packet = header(static_cast<uint8_t>(MessageType::PING), probeSeq_);
+        RecordWriter(packet).put(probeTarget_);
+        appendBroadcasts(packet);
+        send(packet, it->second.addr, it->second.addrLen);
+        return;
+    }
+}
+
+void GossipMember::suspect(const Peer& peer) {
+    Member suspected = peer.member;
+    suspected.state = State::SUSPECT;
+    applyUpdate(std::move(suspected), std::string(), sockaddr_storage{});
+}
+
+void GossipMember::dispatchChanges(std::unique_lock<std::mutex>& lock) {
+    if (changes_.empty()) {
+        return;
+    }
+    std::vector<Member> changes;
+    changes.swap(changes_);
+    if (!onChange_) {
+        return;
+    }
+    lock.unlock();
+    for (const auto& change : changes) {
+        onChange_(change);
+    }
+    lock.lock();
+}
+
+std::string GossipMember::header(uint8_t type, uint32_t seq) const {
+    std::string packet;
+    packet.reserve(kMaxPacket);
+    RecordWriter writer(packet);
+    writer.put(kVersion);
+    writer.put(type);
+    writer.put(seq);
+    writer.put(options_.id);
+    return packet;
+}
+
+void GossipMember::appendBroadcasts(std::string& packet, const Member* first) {
+    size_t countAt = packet.size();
+    uint16_t count = 0;
+    RecordWriter(packet).put(count);
+    if (first) {
+        encodeMember(*first, packet);
+        ++count;
+    }
+
+    // Least-sent news first, so fresh changes are never crowded out; what
+    // is sent goes back in behind, unless it has been sent enough
+    std::vector<std::set<Broadcast>::node_type> sent;
+    for (auto it = broadcasts_.begin(); it != broadcasts_.end() && packet.size() + kMinEncoded <= kMaxPacket;) {
+        if (packet.size() + encodedSize(it->update) > kMaxPacket) {
+            ++it;
+            continue;
+        }
+        encodeMember(it->update, packet);
+        ++count;
+        sent.push_back(broadcasts_.extract(it++));
+    }
+    int limit = options_.retransmitMultiplier *
+                static_cast<int>(std::max(1.0, std::ceil(std::log10(static_cast<double>(liveCount() + 2)))));
+    for (auto& node : sent) {
+        if (++node.value().transmits >= limit) {
+            queued_.erase(node.value().update.id);
+        } else {
+            auto position = broadcasts_.insert(std::move(node)).position;
+            queued_[position->update.id] = position;
+        }
+    }
+    std::memcpy(&packet[countAt], &count, sizeof(count));
+}
+
+void GossipMember::send(const std::string& packet, const sockaddr_storage& to, socklen_t length) {
+    ssize_t n = sendto(fd_, packet.data(), packet.size(), MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&to),
+                       length);
+    if (n > 0) {
+        ++messagesSent_;
+        bytesSent_ += static_cast<uint64_t>(n);
+    }
+}
+
+void GossipMember::sendSync(const sockaddr_storage& to, socklen_t length) {
+    // Every member, as many packets as it takes; dead ones too, so a member
+    // that missed a death, or its own, finds out
+    std::string packet;
+    size_t countAt = 0;
+    uint16_t count = 0;
+    auto add = [&](const Member& member) {
+        if (!packet.empty() && packet.size() + encodedSize(member) > kMaxPacket) {
+            std::memcpy(&packet[countAt], &count, sizeof(count));
+            send(packet, to, length);
+            packet.clear();
+        }
+        if (packet.empty()) {
+            packet = header(static_cast<uint8_t>(MessageType::SYNC), 0);
+            countAt = packet.size();
+            count = 0;
+            RecordWriter(packet).put(count);
+        }
+        encodeMember(member, packet);
+        ++count;
+    };
+    add(self());
+    for (const auto& [id, peer] : peers_) {
+        add(peer.member);
+    }
+    std::memcpy(&packet[countAt], &count, sizeof(count));
+    send(packet, to, length);
+}
+
+void GossipMember::requestSync(const sockaddr_storage& to, socklen_t length) {
+    Member me = self();
+    std::string packet = header(static_cast<uint8_t>(MessageType::SYNC_REQ), 0);
+    appendBroadcasts(packet, &me);
+    send(packet, to, length);
+}
+
+std::vector<GossipMember::Peer*> GossipMember::randomPeers(size_t count, const std::string& exclude) {
+    std::vector<Peer*> candidates;
+    for (auto& [id, peer] : peers_) {
+        if (peer.member.state == State::ALIVE && id != exclude) {
+            candidates.push_back(&peer);
+        }
+    }
+    if (candidates.size() > count) {
+        // Partial Fisher-Yates: the first `count` are a uniform sample
+        for (size_t i = 0; i < count; ++i) {
+            std::uniform_int_distribution<size_t> pick(i, candidates.size() - 1);
+            std::swap(candidates[i], candidates[pick(random_)]);
+        }
+        candidates.resize(count);
+    }
+    return candidates;
+}
+
+} // namespace dcp
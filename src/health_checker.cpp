@@ -2,15 +2,27 @@
 #include <thread>
 #include <chrono>
 #include <iostream>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include <sstream>
 
 namespace dcp {
 
+namespace {
+
+using Clock = TimerWheel::Clock;
+
+constexpr std::chrono::milliseconds kPollInterval{100}; // how soon stop() and registrations are noticed
+constexpr std::chrono::milliseconds kHeartbeatFlush{1000}; // passing checks only refresh heartbeats: batch them
+constexpr uint32_t kStableChecks = 10; // passes in a row before the stable cadence
+constexpr uint32_t kMaxBackoffShift = 6;
+
+} // namespace
+
 HealthChecker::HealthChecker(std::shared_ptr<ServiceRegistry> registry, int checkIntervalMs)
-    : registry_(registry), running_(false), checkIntervalMs_(checkIntervalMs) {
+    : registry_(registry), running_(false), pendingChanges_(0), synced_(false), revision_(0),
+      rng_(std::random_device{}()) {
+    config_.intervalMs = checkIntervalMs;
 }
 
 HealthChecker::~HealthChecker() {
@@ -22,6 +34,12 @@ void HealthChecker::start() {
         return; // Already running
     }
     
+    prober_ = std::make_unique<HealthProber>(config_.maxConcurrentProbes, config_.maxIdleConnections);
+    if (!prober_->init(config_.ioUring)) {
+        running_ = false;
+        return;
+    }
+    
     checkerThread_ = std::thread([this]() { checkServicesHealth(); });
 }
 
@@ -36,59 +54,286 @@ void HealthChecker::stop() {
 }
 
 void HealthChecker::checkServicesHealth() {
+    auto lastPublish = Clock::now();
     while (running_) {
-        auto services = registry_->getAllServices();
+        syncInstances();
+        schedule_.advance(Clock::now(), [this](TimerWheel::Timer& timer) {
+            due_.push_back(static_cast<Instance*>(timer.context)->shared_from_this());
+        });
+        startChecks();
         
-        for (const auto& service : services) {
-            if (!running_) break;
-            
-            bool isHealthy = performHealthCheck(service);
-            std::string newStatus = isHealthy ? "healthy" : "unhealthy";
-            
-            if (service->status != newStatus) {
-                registry_->updateServiceStatus(service->id, newStatus);
-                std::cout << "Service " << service->name << " (" << service->id 
-                         << ") status changed to: " << newStatus << std::endl;
+        int limit = static_cast<int>(kPollInterval.count());
+        prober_->poll(std::chrono::milliseconds(due_.empty() ? schedule_.nextTimeoutMs(Clock::now(), limit) : limit));
+        
+        // Status changes go out at once, heartbeats of passing checks in batches
+        auto now = Clock::now();
+        if (pendingChanges_ > 0 || (!verdicts_.empty() && now - lastPublish >= kHeartbeatFlush)) {
+            publishVerdicts();
+            lastPublish = now;
+        }
+    }
+    
+    // Stopping: outstanding checks are dropped, and a restart begins afresh
+    prober_->cancelAll();
+    for (auto& [id, instance] : instances_) {
+        if (instance->nextCheck.armed()) {
+            schedule_.cancel(instance->nextCheck);
+        }
+    }
+    instances_.clear();
+    due_.clear();
+    verdicts_.clear();
+    pendingChanges_ = 0;
+    synced_ = false;
+    
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.clear();
+    totals_ = ProbeTotals();
+}
+
+void HealthChecker::syncInstances() {
+    std::chrono::milliseconds recheck(config_.recheckIntervalMs);
+    std::vector<RegistryEvent> events;
+    if (synced_ && registry_->changesSince(revision_, events)) {
+        // New registrations get their first check soon, spread over a recheck interval
+        for (const auto& event : events) {
+            if (event.type == RegistryEvent::Type::UNREGISTERED) {
+                untrack(event.service->id);
+            } else {
+                track(event.service, recheck);
             }
+            revision_ = event.revision;
         }
-        
-        // Sleep for the check interval
-        std::this_thread::sleep_for(std::chrono::milliseconds(checkIntervalMs_));
+        return;
+    }
+    
+    // First pass, or the change log no longer reaches back: start over from a
+    // snapshot, spreading the checks of a full registry over a whole interval
+    auto snapshot = registry_->snapshot();
+    std::chrono::milliseconds spread = synced_ ? recheck : std::chrono::milliseconds(config_.intervalMs);
+    snapshot->forEach([this, spread](const std::shared_ptr<Service>& service) { track(service, spread); });
+    std::vector<std::string> gone;
+    for (const auto& [id, instance] : instances_) {
+        if (!snapshot->find(id)) {
+            gone.push_back(id);
+        }
+    }
+    for (const auto& id : gone) {
+        untrack(id);
     }
+    revision_ = snapshot->version();
+    synced_ = true;
 }
 
-bool HealthChecker::performHealthCheck(const std::shared_ptr<Service>& service) {
-    // Simple TCP connection check to the service
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        return false;
+void HealthChecker::track(const std::shared_ptr<Service>& service, std::chrono::milliseconds spread) {
+    // Leased instances report their own health through heartbeats
+    if (service->ttlMs > 0) {
+        untrack(service->id);
+        return;
     }
     
-    // Set socket timeout
-    struct timeval timeout;
-    timeout.tv_sec = 5; // 5 second timeout
-    timeout.tv_usec = 0;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    auto& instance = instances_[service->id];
+    if (!instance) {
+        instance = std::make_shared<Instance>();
+        instance->nextCheck.context = instance.get();
+        std::uniform_int_distribution<int64_t> offset(0, spread.count());
+        schedule_.schedule(instance->nextCheck, Clock::now() + std::chrono::milliseconds(offset(rng_)));
+    }
+    instance->service = service;
+    instance->status = service->status;
+    // Gossip members are watched by their peers
+    const std::string* probe = service->metadata->find("probe");
+    instance->external = externalStatus_ && probe && *probe == "gossip";
     
-    struct sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(service->port);
+    // probe=http fetches probe_path (/health by default) and expects
+    // probe_status (any 2xx by default) and a body containing probe_body
+    instance->http.reset();
+    if (probe && *probe == "http") {
+        auto check = std::make_shared<HttpCheck>();
+        if (const std::string* path = service->metadata->find("probe_path")) {
+            check->path = *path;
+        }
+        if (const std::string* status = service->metadata->find("probe_status")) {
+            std::from_chars(status->data(), status->data() + status->size(), check->expectStatus);
+        }
+        if (const std::string* body = service->metadata->find("probe_body")) {
+            check->expectBody = *body;
+        }
+        instance->http = std::move(check);
+    }
+}
+
+void HealthChecker::untrack(const std::string& serviceId) {
+    auto it = instances_.find(serviceId);
+    if (it == instances_.end()) {
+        return;
+    }
+    Instance& instance = *it->second;
+    instance.removed = true; // for a check still in flight or queued
+    if (instance.nextCheck.armed()) {
+        schedule_.cancel(instance.nextCheck);
+    }
+    instances_.erase(it);
     
-    if (inet_pton(AF_INET, service->host.c_str(), &serverAddr.sin_addr) <= 0) {
-        close(sockfd);
-        return false;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.erase(serviceId);
+}
+
+void HealthChecker::startChecks() {
+    // Due instances take probe slots in order; the rest wait for slots to free up
+    std::chrono::milliseconds timeout(config_.timeoutMs);
+    size_t next = 0;
+    for (; next < due_.size(); ++next) {
+        std::shared_ptr<Instance> instance = due_[next];
+        if (instance->removed) {
+            continue;
+        }
+        if (instance->external) {
+            bool alive = false;
+            if (externalStatus_(instance->service->id, alive)) {
+                instance->last = ProbeResult();
+                instance->last.healthy = alive;
+                record(instance, alive, true); // gossip has confirmed it already
+            } else {
+                schedule_.schedule(instance->nextCheck, Clock::now() + jittered(std::chrono::milliseconds(config_.intervalMs)));
+            }
+            continue;
+        }
+        
+        const Service& service = *instance->service;
+        auto done = [this, instance](const ProbeResult& result) {
+            if (running_ && !instance->removed) {
+                instance->last = result;
+                record(instance, result.healthy, false);
+            }
+        };
+        bool started = instance->http
+                           ? prober_->startHttp(service.address, service.port, instance->http, timeout, done)
+                           : prober_->start(service.address, service.port, timeout, done);
+        if (!started) {
+            if (prober_->inFlight() > 0) {
+                break; // at the cap, or out of descriptors until some close
+            }
+            instance->last = ProbeResult();
+            record(instance, false, false); // could not start even alone
+        }
+    }
+    due_.erase(due_.begin(), due_.begin() + next);
+}
+
+void HealthChecker::record(const std::shared_ptr<Instance>& instance, bool healthy, bool confirmed) {
+    instance->checkedAt = std::chrono::system_clock::now();
+    if (healthy) {
+        ++instance->successes;
+        instance->failures = 0;
+    } else {
+        ++instance->failures;
+        instance->successes = 0;
     }
     
-    int result = connect(sockfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-    close(sockfd);
+    // An unknown status takes the first verdict; a known one needs a streak
+    ServiceStatus verdict = healthy ? ServiceStatus::HEALTHY : ServiceStatus::UNHEALTHY;
+    uint32_t streak = healthy ? instance->successes : instance->failures;
+    uint32_t threshold = std::max<uint32_t>(1, healthy ? config_.rise : config_.fall);
+    bool flips = instance->status != verdict &&
+                 (confirmed || instance->status == ServiceStatus::UNKNOWN || streak >= threshold);
+    if (flips) {
+        instance->status = verdict;
+        ++pendingChanges_;
+    }
+    verdicts_.push_back(Verdict{instance, healthy, flips ? verdict : ServiceStatus::UNKNOWN});
     
-    if (result == 0) {
-        registry_->updateHeartbeat(service->id);
-        return true;
+    std::chrono::milliseconds interval(config_.intervalMs);
+    std::chrono::milliseconds recheck(config_.recheckIntervalMs);
+    std::chrono::milliseconds delay = interval;
+    if (instance->external) {
+        delay = interval;
+    } else if (instance->status != verdict) {
+        delay = recheck; // settle a possible flip quickly
+    } else if (!healthy) {
+        // Down: back off from the recheck interval towards the normal one
+        uint32_t beyond = instance->failures > threshold ? instance->failures - threshold : 0;
+        delay = std::min(interval, recheck * (1 << std::min(beyond, kMaxBackoffShift)));
+    } else if (instance->successes >= kStableChecks) {
+        delay = std::chrono::milliseconds(config_.stableIntervalMs);
     }
+    schedule_.schedule(instance->nextCheck, Clock::now() + jittered(delay));
+}
+
+void HealthChecker::publishVerdicts() {
+    std::ostringstream changes; // logged with one unflushed write
+    {
+        // Publish them as one registry snapshot
+        ServiceRegistry::Batch batch(*registry_);
+        for (const auto& verdict : verdicts_) {
+            Instance& instance = *verdict.instance;
+            if (instance.removed) {
+                continue;
+            }
+            const Service& service = *instance.service;
+            if (verdict.healthy) {
+                registry_->updateHeartbeat(service.id);
+            }
+            if (verdict.newStatus == ServiceStatus::UNKNOWN) {
+                continue;
+            }
+            
+            bool written = statusWriter_ ? statusWriter_(service.id, verdict.newStatus)
+                                         : registry_->updateServiceStatus(service.id, verdict.newStatus);
+            if (!written) {
+                instance.status = service.status; // flips again on a later check
+                continue;
+            }
+            changes << "Service " << service.name << " (" << service.id 
+                    << ") status changed to: " << toString(verdict.newStatus) << '\n';
+        }
+    }
+    
+    std::cout << changes.str();
     
-    return false;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    for (const auto& verdict : verdicts_) {
+        const Instance& instance = *verdict.instance;
+        if (instance.removed) {
+            continue;
+        }
+        ProbeStats& stats = stats_[instance.service->id];
+        stats.serviceId = instance.service->id;
+        stats.probe = instance.external ? "gossip" : instance.http ? "http" : "tcp";
+        stats.status = instance.status;
+        stats.successes = instance.successes;
+        stats.failures = instance.failures;
+        stats.rtt = instance.last.rtt;
+        stats.httpStatus = instance.last.status;
+        stats.reused = instance.last.reused;
+        stats.checkedAt = instance.checkedAt;
+    }
+    totals_.connectionsOpened = prober_->connectionsOpened();
+    totals_.connectionsReused = prober_->connectionsReused();
+    totals_.idleConnections = prober_->idleConnections();
+    verdicts_.clear();
+    pendingChanges_ = 0;
+}
+
+std::vector<ProbeStats> HealthChecker::getProbeStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    std::vector<ProbeStats> result;
+    result.reserve(stats_.size());
+    for (const auto& [id, stats] : stats_) {
+        result.push_back(stats);
+    }
+    return result;
+}
+
+ProbeTotals HealthChecker::getProbeTotals() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return totals_;
+}
+
+std::chrono::milliseconds HealthChecker::jittered(std::chrono::milliseconds delay) {
+    double jitter = std::clamp(config_.jitter, 0.0, 1.0);
+    std::uniform_real_distribution<double> factor(1.0 - jitter, 1.0 + jitter);
+    return std::chrono::milliseconds(static_cast<int64_t>(delay.count() * factor(rng_)));
 }
 
-} // namespace dcp
\ No newline at end of file
+} // namespace dcp
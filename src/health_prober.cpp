@@ -0,0 +1,645 @@
+#include "health_prober.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <fcntl.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#ifdef DCP_HAVE_IO_URING
+#include "io_uring.h"
+#include <linux/time_types.h>
+#endif
+
+namespace dcp {
+
+namespace {
+
+constexpr int kMaxEvents = 256;
+constexpr size_t kMaxResponseBytes = 64 * 1024;
+constexpr std::chrono::seconds kIdleTimeout{60};
+
+#ifdef DCP_HAVE_IO_URING
+constexpr size_t kMaxRingEntries = 32768;
+// Ring user data: connects carry the slot in the low 32 bits and its generation above
+constexpr uint64_t kLinkTimeoutTag = ~0ull;
+constexpr uint64_t kEpollTag = ~0ull - 1;
+#endif
+
+enum class Parse {
+    INCOMPLETE,
+    COMPLETE,
+    INVALID
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+bool parseNumber(std::string_view text, int base, size_t& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return !text.empty() && error == std::errc() && end == text.data() + text.size();
+}
+
+// Parses one response from the start of `data`. Once the peer has closed
+// the connection, a body without a length ends there.
+Parse parseResponse(std::string_view data, bool closed, int& status, std::string& body, bool& keepAlive) {
+    Parse incomplete = closed ? Parse::INVALID : Parse::INCOMPLETE;
+    size_t headEnd = data.find("\r\n\r\n");
+    if (headEnd == std::string_view::npos) {
+        return incomplete;
+    }
+
+    std::string_view head = data.substr(0, headEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string_view statusLine = head.substr(0, lineEnd);
+    size_t space = statusLine.find(' ');
+    size_t code = 0;
+    if (statusLine.compare(0, 5, "HTTP/") != 0 || space == std::string_view::npos ||
+        !parseNumber(statusLine.substr(space + 1, 3), 10, code)) {
+        return Parse::INVALID;
+    }
+    status = static_cast<int>(code);
+    bool http10 = statusLine.compare(0, 8, "HTTP/1.0") == 0;
+
+    std::string_view connection;
+    std::string_view contentLength;
+    bool chunked = false;
+    while (lineEnd != std::string_view::npos) {
+        head.remove_prefix(lineEnd + 2);
+        lineEnd = head.find("\r\n");
+        std::string_view line = head.substr(0, lineEnd);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        if (equalsIgnoreCase(name, "Connection")) {
+            connection = value;
+        } else if (equalsIgnoreCase(name, "Content-Length")) {
+            contentLength = value;
+        } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+            chunked = equalsIgnoreCase(value, "chunked");
+        }
+    }
+    keepAlive = http10 ? equalsIgnoreCase(connection, "keep-alive") : !equalsIgnoreCase(connection, "close");
+
+    std::string_view rest = data.substr(headEnd + 4);
+    body.clear();
+    if (chunked) {
+        size_t pos = 0;
+        while (true) {
+            size_t end = rest.find("\r\n", pos);
+            if (end == std::string_view::npos) {
+                return incomplete;
+            }
+            std::string_view line = rest.substr(pos, end - pos);
+            size_t size = 0;
+            if (!parseNumber(line.substr(0, line.find(';')), 16, size)) {
+                return Parse::INVALID;
+            }
+            pos = end + 2;
+            if (size == 0) {
+                // Trailers end with an empty line
+                while ((end = rest.find("\r\n", pos)) != std::string_view::npos) {
+                    bool last = end == pos;
+                    pos = end + 2;
+                    if (last) {
+                        return Parse::COMPLETE;
+                    }
+                }
+                return incomplete;
+            }
+            if (rest.size() < pos + size + 2) {
+                return incomplete;
+            }
+            body.append(rest.substr(pos, size));
+            pos += size + 2;
+        }
+    }
+    if (!contentLength.empty()) {
+        size_t length = 0;
+        if (!parseNumber(contentLength, 10, length)) {
+            return Parse::INVALID;
+        }
+        if (rest.size() < length) {
+            return incomplete;
+        }
+        body.assign(rest.substr(0, length));
+        return Parse::COMPLETE;
+    }
+    if (status == 204 || status == 304 || status < 200) {
+        return Parse::COMPLETE;
+    }
+    if (!closed) {
+        return Parse::INCOMPLETE;
+    }
+    body.assign(rest);
+    keepAlive = false;
+    return Parse::COMPLETE;
+}
+
+} // namespace
+
+#ifdef DCP_HAVE_IO_URING
+struct HealthProber::Ring {
+    IoUring ring;
+    std::vector<__kernel_timespec> timeouts; // per slot, read by the kernel at submission
+    bool epollArmed = false;                 // a POLL_ADD on the epoll set is outstanding
+};
+#else
+struct HealthProber::Ring {};
+#endif
+
+HealthProber::HealthProber(size_t maxInFlight, size_t maxIdle)
+    : epollFd_(-1), probes_(std::max<size_t>(1, maxInFlight)), inFlight_(0), maxIdle_(maxIdle), idleCount_(0),
+      opened_(0), reused_(0) {
+    freeSlots_.reserve(probes_.size());
+    for (size_t i = probes_.size(); i > 0; --i) {
+        freeSlots_.push_back(static_cast<uint32_t>(i - 1));
+    }
+}
+
+HealthProber::~HealthProber() {
+    for (auto& probe : probes_) {
+        if (probe.fd >= 0) {
+            close(probe.fd);
+        }
+    }
+    for (auto& [key, connections] : idle_) {
+        for (auto& connection : connections) {
+            close(connection->fd);
+        }
+    }
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+    }
+}
+
+bool HealthProber::init(bool ioUring) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+        std::cerr << "Failed to create health probe epoll set: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+#ifdef DCP_HAVE_IO_URING
+    if (ioUring) {
+        // Two entries per connect, plus the watch on the epoll set
+        ring_ = std::make_unique<Ring>();
+        if (!ring_->ring.init(static_cast<unsigned>(std::min(probes_.size() * 2 + 1, kMaxRingEntries)))) {
+            std::cerr << "io_uring is not available for health probes, falling back to epoll" << std::endl;
+            ring_.reset();
+        } else {
+            ring_->timeouts.resize(probes_.size());
+        }
+    }
+#else
+    (void)ioUring;
+#endif
+    return true;
+}
+
+bool HealthProber::start(const NetAddress& address, uint16_t port, std::chrono::milliseconds timeout,
+                         Callback done) {
+    return begin(address, port, nullptr, timeout, std::move(done));
+}
+
+bool HealthProber::startHttp(const NetAddress& address, uint16_t port, std::shared_ptr<const HttpCheck> check,
+                             std::chrono::milliseconds timeout, Callback done) {
+    return begin(address, port, std::move(check), timeout, std::move(done));
+}
+
+bool HealthProber::begin(const NetAddress& address, uint16_t port, std::shared_ptr<const HttpCheck> check,
+                         std::chrono::milliseconds timeout, Callback done) {
+    if (freeSlots_.empty()) {
+        return false;
+    }
+    auto now = Clock::now();
+    sockaddr_storage addr;
+    socklen_t addrLen = address.toSockaddr(port, addr);
+    if (addrLen == 0) {
+        finished_.emplace_back(std::move(done), ProbeResult{}); // nothing to connect to
+        return true;
+    }
+
+    uint32_t slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    ++inFlight_;
+    Probe& probe = probes_[slot];
+    probe.started = now;
+    probe.done = std::move(done);
+    probe.addr = addr;
+    probe.addrLen = addrLen;
+    probe.http = std::move(check);
+    probe.deadline = now + timeout;
+    probe.timer.context = &probe;
+    deadlines_.schedule(probe.timer, probe.deadline);
+
+    if (probe.http) {
+        probe.key.assign(reinterpret_cast<const char*>(&addr), addrLen);
+        std::string host = probe.http->host;
+        if (host.empty()) {
+            host = address.family() == AF_INET6 ? "[" + address.toString() + "]" : address.toString();
+            host += ":" + std::to_string(port);
+        }
+        probe.request = "GET " + probe.http->path + " HTTP/1.1\r\nHost: " + host +
+                        "\r\nUser-Agent: dcp-health-checker\r\nConnection: keep-alive\r\n\r\n";
+        probe.fd = takeIdle(probe.key);
+        if (probe.fd >= 0) {
+            ++reused_;
+            probe.reused = true;
+            probe.sent = 0;
+            probe.response.clear();
+            sendRequest(slot);
+            return true;
+        }
+    }
+    if (!connectProbe(slot)) {
+        // Out of descriptors: hand the slot back without a verdict
+        deadlines_.cancel(probe.timer);
+        probe.done = nullptr;
+        probe.http.reset();
+        freeSlots_.push_back(slot);
+        --inFlight_;
+        return false;
+    }
+    return true;
+}
+
+bool HealthProber::connectProbe(uint32_t slot) {
+    Probe& probe = probes_[slot];
+    // A blocking socket on the ring: io_uring waits for the connect itself
+    int fd = socket(probe.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC | (ring_ ? 0 : SOCK_NONBLOCK), 0);
+    if (fd < 0) {
+        return false;
+    }
+    ++opened_;
+    probe.fd = fd;
+    probe.watched = false;
+    probe.stage = Stage::CONNECTING;
+    probe.reused = false;
+    probe.sent = 0;
+    probe.response.clear();
+
+    if (ring_) {
+        if (!submitConnect(slot)) {
+            finish(slot, false, false);
+        }
+        return true;
+    }
+    // Loopback connects often finish, or are refused, on the spot
+    int rc = connect(fd, reinterpret_cast<const sockaddr*>(&probe.addr), probe.addrLen);
+    if (rc == 0) {
+        if (probe.http) {
+            sendRequest(slot);
+        } else {
+            finish(slot, true, false);
+        }
+    } else if (errno != EINPROGRESS || !watch(slot, EPOLLOUT)) {
+        finish(slot, false, false);
+    }
+    return true;
+}
+
+bool HealthProber::submitConnect(uint32_t slot) {
+#ifdef DCP_HAVE_IO_URING
+    Probe& probe = probes_[slot];
+    IoUring& ring = ring_->ring;
+    if (ring.space() < 2) {
+        ring.submit(); // a connect and its timeout must reach the kernel together
+        if (ring.space() < 2) {
+            return false;
+        }
+    }
+    // The kernel enforces the deadline from here on
+    if (probe.timer.armed()) {
+        deadlines_.cancel(probe.timer);
+    }
+    auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(probe.deadline - Clock::now()).count();
+    __kernel_timespec& timeout = ring_->timeouts[slot];
+    timeout.tv_sec = std::max<int64_t>(0, left) / 1000000000;
+    timeout.tv_nsec = std::max<int64_t>(0, left) % 1000000000;
+
+    io_uring_sqe* sqe = ring.prepare(IORING_OP_CONNECT, probe.fd, static_cast<uint64_t>(probe.generation) << 32 | slot);
+    sqe->addr = reinterpret_cast<uintptr_t>(&probe.addr);
+    sqe->off = probe.addrLen;
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe = ring.prepare(IORING_OP_LINK_TIMEOUT, -1, kLinkTimeoutTag);
+    sqe->addr = reinterpret_cast<uintptr_t>(&timeout);
+    sqe->len = 1;
+    return true;
+#else
+    (void)slot;
+    return false;
+#endif
+}
+
+void HealthProber::connected(uint32_t slot, int result) {
+    Probe& probe = probes_[slot];
+    if (result < 0 || !probe.http) {
+        finish(slot, result == 0, result == -ECANCELED); // canceled by its linked timeout
+        return;
+    }
+    // The HTTP exchange runs on the epoll set, within what is left of the deadline
+    fcntl(probe.fd, F_SETFL, fcntl(probe.fd, F_GETFL) | O_NONBLOCK);
+    deadlines_.schedule(probe.timer, probe.deadline);
+    sendRequest(slot);
+}
+
+bool HealthProber::watch(uint32_t slot, uint32_t events) {
+    Probe& probe = probes_[slot];
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u32 = slot;
+    if (epoll_ctl(epollFd_, probe.watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, probe.fd, &ev) < 0) {
+        return false;
+    }
+    probe.watched = true;
+    return true;
+}
+
+void HealthProber::sendRequest(uint32_t slot) {
+    Probe& probe = probes_[slot];
+    probe.stage = Stage::SENDING;
+    while (probe.sent < probe.request.size()) {
+        ssize_t n = send(probe.fd, probe.request.data() + probe.sent, probe.request.size() - probe.sent,
+                         MSG_NOSIGNAL);
+        if (n > 0) {
+            probe.sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!watch(slot, EPOLLOUT)) {
+                finish(slot, false, false);
+            }
+            return;
+        } else {
+            broken(slot);
+            return;
+        }
+    }
+    probe.stage = Stage::RECEIVING;
+    if (!watch(slot, EPOLLIN)) {
+        finish(slot, false, false);
+    }
+}
+
+void HealthProber::receiveResponse(uint32_t slot) {
+    Probe& probe = probes_[slot];
+    char buffer[16 * 1024];
+    bool closed = false;
+    while (true) {
+        ssize_t n = recv(probe.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            if (probe.response.size() + static_cast<size_t>(n) > kMaxResponseBytes) {
+                finish(slot, false, false);
+                return;
+            }
+            probe.response.append(buffer, static_cast<size_t>(n));
+        } else if (n == 0) {
+            closed = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            broken(slot);
+            return;
+        }
+    }
+    if (closed && probe.response.empty()) {
+        broken(slot);
+        return;
+    }
+
+    int status = 0;
+    bool keepAlive = false;
+    std::string body;
+    Parse parsed = parseResponse(probe.response, closed, status, body, keepAlive);
+    if (parsed == Parse::INCOMPLETE) {
+        return;
+    }
+    if (parsed == Parse::INVALID) {
+        finish(slot, false, false, status);
+        return;
+    }
+    const HttpCheck& check = *probe.http;
+    bool statusMatches = check.expectStatus ? status == check.expectStatus : status >= 200 && status < 300;
+    bool bodyMatches = check.expectBody.empty() || body.find(check.expectBody) != std::string::npos;
+    finish(slot, statusMatches && bodyMatches, false, status, keepAlive && !closed);
+}
+
+void HealthProber::broken(uint32_t slot) {
+    // The connection failed before any response: when it came from the pool,
+    // the endpoint may just have closed it, so try once more on a new one
+    Probe& probe = probes_[slot];
+    if (!probe.reused || !probe.response.empty()) {
+        finish(slot, false, false);
+        return;
+    }
+    close(probe.fd);
+    probe.fd = -1;
+    if (!connectProbe(slot)) {
+        finish(slot, false, false);
+    }
+}
+
+void HealthProber::poll(std::chrono::milliseconds wait) {
+    int timeout = finished_.empty() ? deadlines_.nextTimeoutMs(Clock::now(), static_cast<int>(wait.count())) : 0;
+    if (ring_) {
+        pollRing(timeout);
+    } else {
+        pollEvents(timeout);
+    }
+    auto now = Clock::now();
+    deadlines_.advance(now, [this](TimerWheel::Timer& timer) {
+        finish(static_cast<uint32_t>(static_cast<Probe*>(timer.context) - probes_.data()), false, true);
+    });
+    idleExpiry_.advance(now, [this](TimerWheel::Timer& timer) {
+        dropIdle(*static_cast<IdleConnection*>(timer.context));
+    });
+    runCallbacks();
+}
+
+void HealthProber::pollEvents(int timeoutMs) {
+    epoll_event events[kMaxEvents];
+    int n = epoll_wait(epollFd_, events, kMaxEvents, timeoutMs);
+    for (int i = 0; i < n; ++i) {
+        handleEvent(events[i].data.u32);
+    }
+}
+
+void HealthProber::pollRing(int timeoutMs) {
+#ifdef DCP_HAVE_IO_URING
+    IoUring& ring = ring_->ring;
+    if (!ring_->epollArmed) {
+        io_uring_sqe* sqe = ring.prepare(IORING_OP_POLL_ADD, epollFd_, kEpollTag);
+        if (sqe) {
+            sqe->poll32_events = POLLIN;
+            ring_->epollArmed = true;
+        }
+    }
+    // Submits the connects queued since the last poll and waits in the same call
+    int rc = ring.wait(timeoutMs);
+    if (rc < 0 && rc != -EINTR && rc != -ETIME && rc != -EBUSY) {
+        std::cerr << "Health probe wait failed: " << std::strerror(-rc) << std::endl;
+    }
+    bool events = false;
+    ring.forEachCompletion([this, &events](const io_uring_cqe& cqe) {
+        if (cqe.user_data == kEpollTag) {
+            ring_->epollArmed = false;
+            events = true;
+            return;
+        }
+        if (cqe.user_data == kLinkTimeoutTag) {
+            return;
+        }
+        uint32_t slot = static_cast<uint32_t>(cqe.user_data);
+        if (probes_[slot].generation != cqe.user_data >> 32) {
+            return; // the probe was canceled while its connect was out
+        }
+        connected(slot, cqe.res);
+    });
+    if (events) {
+        pollEvents(0);
+    }
+#else
+    pollEvents(timeoutMs);
+#endif
+}
+
+void HealthProber::handleEvent(uint32_t slot) {
+    Probe& probe = probes_[slot];
+    if (probe.stage == Stage::CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+            error = errno;
+        }
+        if (error != 0 || !probe.http) {
+            finish(slot, error == 0, false);
+        } else {
+            sendRequest(slot);
+        }
+    } else if (probe.stage == Stage::SENDING) {
+        sendRequest(slot);
+    } else {
+        receiveResponse(slot);
+    }
+}
+
+void HealthProber::cancelAll() {
+    for (uint32_t slot = 0; slot < probes_.size(); ++slot) {
+        if (probes_[slot].fd >= 0) {
+            finish(slot, false, false);
+        }
+    }
+    runCallbacks();
+}
+
+void HealthProber::finish(uint32_t slot, bool healthy, bool timedOut, int status, bool keepAlive) {
+    Probe& probe = probes_[slot];
+    if (probe.fd >= 0) {
+        if (keepAlive) {
+            if (probe.watched) {
+                epoll_ctl(epollFd_, EPOLL_CTL_DEL, probe.fd, nullptr);
+            }
+            keepIdle(probe.fd, probe.key);
+        } else {
+            close(probe.fd); // also leaves the epoll set
+        }
+        probe.fd = -1;
+    }
+    probe.watched = false;
+    if (probe.timer.armed()) {
+        deadlines_.cancel(probe.timer);
+    }
+    ProbeResult result;
+    result.healthy = healthy;
+    result.timedOut = timedOut;
+    result.status = status;
+    result.reused = probe.reused;
+    result.rtt = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - probe.started);
+    finished_.emplace_back(std::move(probe.done), result);
+    probe.done = nullptr;
+    probe.http.reset();
+    ++probe.generation;
+    freeSlots_.push_back(slot);
+    --inFlight_;
+}
+
+void HealthProber::runCallbacks() {
+    // Callbacks may start probes, which may finish on the spot
+    std::vector<std::pair<Callback, ProbeResult>> ready;
+    ready.swap(finished_);
+    for (auto& [done, result] : ready) {
+        if (done) {
+            done(result);
+        }
+    }
+}
+
+int HealthProber::takeIdle(const std::string& key) {
+    auto it = idle_.find(key);
+    int fd = -1;
+    while (fd < 0 && it != idle_.end() && !it->second.empty()) {
+        std::unique_ptr<IdleConnection> connection = std::move(it->second.back());
+        it->second.pop_back();
+        --idleCount_;
+        idleExpiry_.cancel(connection->expiry);
+        // An endpoint that closed the connection while it idled left EOF or a reset to read
+        char byte;
+        ssize_t n = recv(connection->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            fd = connection->fd;
+        } else {
+            close(connection->fd);
+        }
+    }
+    if (it != idle_.end() && it->second.empty()) {
+        idle_.erase(it);
+    }
+    return fd;
+}
+
+void HealthProber::keepIdle(int fd, const std::string& key) {
+    if (idleCount_ >= maxIdle_) {
+        close(fd);
+        return;
+    }
+    auto connection = std::make_unique<IdleConnection>();
+    connection->fd = fd;
+    connection->key = key;
+    connection->expiry.context = connection.get();
+    idleExpiry_.schedule(connection->expiry, Clock::now() + kIdleTimeout);
+    idle_[key].push_back(std::move(connection));
+    ++idleCount_;
+}
+
+void HealthProber::dropIdle(IdleConnection& connection) {
+    auto it = idle_.find(connection.key);
+    auto& connections = it->second;
+    auto position = std::find_if(connections.begin(), connections.end(),
+                                 [&connection](const std::unique_ptr<IdleConnection>& c) { return c.get() == &connection; });
+    close(connection.fd);
+    std::swap(*position, connections.back());
+    connections.pop_back(); // destroys `connection`
+    if (connections.empty()) {
+        idle_.erase(it);
+    }
+    --idleCount_;
+}
+
+} // namespace dcp
@@ -0,0 +1,333 @@
+#include "http_client.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <strings.h>
+
+namespace dcp {
+
+namespace {
+
+constexpr size_t kMaxHeaderBytes = 64 * 1024;
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+bool parseSize(std::string_view text, int base, size_t& value) {
+    if (text.empty() || text.size() > 16) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = value * base + digit;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string_view HttpClient::Response::header(std::string_view name) const {
+    for (const auto& [key, value] : headers) {
+        if (equalsIgnoreCase(key, name)) {
+            return value;
+        }
+    }
+    return std::string_view();
+}
+
+HttpClient::HttpClient(const std::string& host, uint16_t port, int timeoutMs)
+    : host_(host), port_(port), timeoutMs_(timeoutMs), fd_(-1), requests_(0), responses_(0) {
+    hostHeader_ = host_ + ":" + std::to_string(port_);
+}
+
+HttpClient::~HttpClient() {
+    close();
+}
+
+bool HttpClient::parseAddress(const std::string& address, std::string& host, uint16_t& port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0) {
+        return false;
+    }
+    size_t value = 0;
+    if (!parseSize(std::string_view(address).substr(colon + 1), 10, value) || value == 0 || value > 65535) {
+        return false;
+    }
+    host = address.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2); // [::1]:8080
+    }
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+bool HttpClient::connect() {
+    close();
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &results) != 0) {
+        return false;
+    }
+
+    for (addrinfo* ai = results; ai && fd_ < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (fd < 0) {
+            continue;
+        }
+        // Connect without blocking so the timeout applies to it too
+        int rc = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc < 0 && errno == EINPROGRESS) {
+            pollfd pfd{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (poll(&pfd, 1, timeoutMs_) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 &&
+                error == 0) {
+                rc = 0;
+            }
+        }
+        if (rc < 0) {
+            ::close(fd);
+            continue;
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        timeval timeout;
+        timeout.tv_sec = timeoutMs_ / 1000;
+        timeout.tv_usec = (timeoutMs_ % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fd_ = fd;
+    }
+    freeaddrinfo(results);
+    return fd_ >= 0;
+}
+
+void HttpClient::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    buffer_.clear();
+    requests_ = 0;
+    responses_ = 0;
+}
+
+bool HttpClient::send(std::string_view method, std::string_view target, std::string_view body,
+                      std::string_view contentType) {
+    if (fd_ < 0 && !connect()) {
+        return false;
+    }
+
+    std::string head;
+    head.reserve(128 + target.size());
+    head.append(method).append(" ").append(target).append(" HTTP/1.1\r\nHost: ").append(hostHeader_);
+    head.append("\r\nContent-Length: ").append(std::to_string(body.size()));
+    if (!body.empty()) {
+        head.append("\r\nContent-Type: ").append(contentType);
+    }
+    head.append("\r\n\r\n");
+
+    // Small bodies go out in the same segment as the head
+    if (body.size() <= 16 * 1024) {
+        head.append(body);
+        body = std::string_view();
+    }
+    for (std::string_view part : {std::string_view(head), body}) {
+        while (!part.empty()) {
+            ssize_t n = ::send(fd_, part.data(), part.size(), MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                close();
+                return false;
+            }
+            part.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+    ++requests_;
+    return true;
+}
+
+bool HttpClient::fill() {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || buffer_.size() + static_cast<size_t>(n) > kMaxResponseSize) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+}
+
+bool HttpClient::readChunked(std::string& body) {
+    size_t pos = 0; // into buffer_
+    while (true) {
+        size_t lineEnd;
+        while ((lineEnd = buffer_.find("\r\n", pos)) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        std::string_view line(buffer_.data() + pos, lineEnd - pos);
+        line = line.substr(0, line.find(';')); // chunk extensions
+        size_t size = 0;
+        if (!parseSize(line, 16, size) || body.size() + size > kMaxResponseSize) {
+            return false;
+        }
+        pos = lineEnd + 2;
+        if (size == 0) {
+            // Trailers end with an empty line
+            while (true) {
+                while ((lineEnd = buffer_.find("\r\n", pos)) == std::string::npos) {
+                    if (!fill()) {
+                        return false;
+                    }
+                }
+                bool last = lineEnd == pos;
+                pos = lineEnd + 2;
+                if (last) {
+                    buffer_.erase(0, pos);
+                    return true;
+                }
+            }
+        }
+        while (buffer_.size() < pos + size + 2) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        body.append(buffer_, pos, size);
+        pos += size + 2;
+    }
+}
+
+bool HttpClient::receive(Response& response) {
+    if (fd_ < 0 || responses_ >= requests_) {
+        return false;
+    }
+    response.status = 0;
+    response.headers.clear();
+    response.body.clear();
+
+    size_t headEnd;
+    while ((headEnd = buffer_.find("\r\n\r\n")) == std::string::npos) {
+        if (buffer_.size() > kMaxHeaderBytes || !fill()) {
+            close();
+            return false;
+        }
+    }
+
+    // Status line, then headers
+    std::string_view head(buffer_.data(), headEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string_view statusLine = head.substr(0, lineEnd);
+    size_t space = statusLine.find(' ');
+    size_t status = 0;
+    if (statusLine.compare(0, 5, "HTTP/") != 0 || space == std::string_view::npos ||
+        !parseSize(statusLine.substr(space + 1, 3), 10, status)) {
+        close();
+        return false;
+    }
+    response.status = static_cast<int>(status);
+    bool http10 = statusLine.compare(0, 8, "HTTP/1.0") == 0;
+    while (lineEnd != std::string_view::npos) {
+        head.remove_prefix(lineEnd + 2);
+        lineEnd = head.find("\r\n");
+        std::string_view line = head.substr(0, lineEnd);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        response.headers.emplace_back(std::string(line.substr(0, colon)), std::string(value));
+    }
+    buffer_.erase(0, headEnd + 4);
+
+    std::string_view connection = response.header("Connection");
+    bool keepAlive = http10 ? equalsIgnoreCase(connection, "keep-alive") : !equalsIgnoreCase(connection, "close");
+    std::string_view contentLength = response.header("Content-Length");
+    bool ok = true;
+    if (equalsIgnoreCase(response.header("Transfer-Encoding"), "chunked")) {
+        ok = readChunked(response.body);
+    } else if (!contentLength.empty()) {
+        size_t length = 0;
+        ok = parseSize(contentLength, 10, length) && length <= kMaxResponseSize;
+        while (ok && buffer_.size() < length) {
+            ok = fill();
+        }
+        if (ok) {
+            response.body.assign(buffer_, 0, length);
+            buffer_.erase(0, length);
+        }
+    } else if (status == 204 || status == 304 || status < 200) {
+        // No body
+    } else {
+        // Delimited by the connection closing
+        while (fill()) {
+        }
+        response.body.swap(buffer_);
+        keepAlive = false;
+    }
+
+    if (!ok) {
+        close();
+        return false;
+    }
+    ++responses_;
+    if (!keepAlive) {
+        close();
+    }
+    return true;
+}
+
+bool HttpClient::request(std::string_view method, std::string_view target, std::string_view body,
+                         Response& response, std::string_view contentType) {
+    // A kept-alive connection may have been closed by the server while idle;
+    // that shows up as a failure before any response byte arrives
+    bool reused = fd_ >= 0 && requests_ > 0;
+    if (send(method, target, body, contentType) && receive(response)) {
+        return true;
+    }
+    if (!reused) {
+        return false;
+    }
+    close();
+    return send(method, target, body, contentType) && receive(response);
+}
+
+} // namespace dcp
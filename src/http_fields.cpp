@@ -0,0 +1,119 @@
+#include "http_fields.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <strings.h>
+
+namespace dcp {
+
+namespace {
+
+constexpr size_t kOwnArenaBlockSize = 512;
+
+} // namespace
+
+HttpFields::HttpFields(bool ignoreCase)
+    : fields_(inline_), size_(0), capacity_(kInlineFields), ignoreCase_(ignoreCase),
+      arena_(RequestArena::current()) {}
+
+HttpFields::HttpFields(const HttpFields& other)
+    : fields_(inline_), size_(0), capacity_(kInlineFields), ignoreCase_(other.ignoreCase_),
+      arena_(other.arena_), ownArena_(other.ownArena_) {
+    *this = other;
+}
+
+HttpFields& HttpFields::operator=(const HttpFields& other) {
+    if (this == &other) {
+        return *this;
+    }
+    // The views point into the other table's arena, so share it
+    arena_ = other.arena_;
+    ownArena_ = other.ownArena_;
+    ignoreCase_ = other.ignoreCase_;
+    fields_ = inline_;
+    capacity_ = kInlineFields;
+    if (other.size_ > capacity_) {
+        fields_ = static_cast<HttpField*>(storage().allocate(other.size_ * sizeof(HttpField), alignof(HttpField)));
+        capacity_ = other.size_;
+    }
+    std::copy(other.begin(), other.end(), fields_);
+    size_ = other.size_;
+    return *this;
+}
+
+bool HttpFields::matches(std::string_view a, std::string_view b) const {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    return ignoreCase_ ? strncasecmp(a.data(), b.data(), a.size()) == 0 : a == b;
+}
+
+RequestArena& HttpFields::storage() {
+    if (arena_) {
+        return *arena_;
+    }
+    if (!ownArena_) {
+        ownArena_ = std::make_shared<RequestArena>(kOwnArenaBlockSize);
+    }
+    return *ownArena_;
+}
+
+void HttpFields::push(std::string_view name, std::string_view value) {
+    if (size_ == capacity_) {
+        // The old array is abandoned to the arena
+        size_t capacity = capacity_ * 2;
+        auto* fields = static_cast<HttpField*>(storage().allocate(capacity * sizeof(HttpField), alignof(HttpField)));
+        std::copy(begin(), end(), fields);
+        fields_ = fields;
+        capacity_ = capacity;
+    }
+    fields_[size_++] = {name, value};
+}
+
+void HttpFields::set(std::string_view name, std::string_view value) {
+    for (size_t i = size_; i > 0; --i) {
+        if (matches(fields_[i - 1].name, name)) {
+            fields_[i - 1].value = storage().copy(value);
+            return;
+        }
+    }
+    RequestArena& arena = storage();
+    std::string_view storedName = arena.copy(name);
+    push(storedName, arena.copy(value));
+}
+
+void HttpFields::append(std::string_view name, std::string_view value) {
+    push(name, value);
+}
+
+bool HttpFields::erase(std::string_view name) {
+    auto last = std::remove_if(fields_, fields_ + size_,
+                               [this, name](const HttpField& field) { return matches(field.name, name); });
+    bool erased = last != fields_ + size_;
+    size_ = static_cast<size_t>(last - fields_);
+    return erased;
+}
+
+const HttpField* HttpFields::find(std::string_view name) const {
+    for (size_t i = size_; i > 0; --i) {
+        if (matches(fields_[i - 1].name, name)) {
+            return &fields_[i - 1];
+        }
+    }
+    return nullptr;
+}
+
+std::string_view HttpFields::get(std::string_view name, std::string_view fallback) const {
+    const HttpField* field = find(name);
+    return field ? field->value : fallback;
+}
+
+std::string_view HttpFields::at(std::string_view name) const {
+    const HttpField* field = find(name);
+    if (!field) {
+        throw std::out_of_range("No such field: " + std::string(name));
+    }
+    return field->value;
+}
+
+} // namespace dcp
@@ -0,0 +1,335 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace dcp {
+
+namespace {
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (toLower(a[i]) != toLower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if the comma-separated header value contains the token
+bool hasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (equalsIgnoreCase(item, token)) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+size_t findCrlf(const char* data, size_t from, size_t length) {
+    for (size_t i = from; i + 1 < length; ++i) {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace
+
+HttpRequestParser::HttpRequestParser(size_t maxRequestSize)
+    : maxRequestSize_(std::min<size_t>(maxRequestSize, std::numeric_limits<uint32_t>::max())) {
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    base_ = "";
+    state_ = State::Headers;
+    scanOffset_ = 0;
+    bodyStart_ = 0;
+    contentLength_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+    chunkRemaining_ = 0;
+    consumed_ = 0;
+    errorStatus_ = 0;
+    method_ = target_ = path_ = query_ = version_ = body_ = Span{};
+    headerCount_ = 0;
+}
+
+HttpHeaderView HttpRequestParser::header(size_t index) const {
+    return {slice(headerNames_[index]), slice(headerValues_[index])};
+}
+
+std::string_view HttpRequestParser::header(std::string_view name) const {
+    for (size_t i = 0; i < headerCount_; ++i) {
+        if (equalsIgnoreCase(slice(headerNames_[i]), name)) {
+            return slice(headerValues_[i]);
+        }
+    }
+    return {};
+}
+
+bool HttpRequestParser::keepAlive() const {
+    std::string_view connection = header("Connection");
+    if (version() == "HTTP/1.1") {
+        return !hasToken(connection, "close");
+    }
+    // HTTP/1.0 must opt in
+    return hasToken(connection, "keep-alive");
+}
+
+ParseResult HttpRequestParser::fail(int status) {
+    state_ = State::Failed;
+    errorStatus_ = status;
+    return ParseResult::Error;
+}
+
+ParseResult HttpRequestParser::parse(char* data, size_t length) {
+    base_ = data;
+
+    switch (state_) {
+        case State::Done:
+            return ParseResult::Complete;
+        case State::Failed:
+            return ParseResult::Error;
+        case State::Headers: {
+            // Resume the terminator search just before the previous end of input
+            size_t from = scanOffset_ >= 3 ? scanOffset_ - 3 : 0;
+            std::string_view buffer(data, length);
+            size_t headerEnd = buffer.find("\r\n\r\n", from);
+            if (headerEnd == std::string_view::npos) {
+                scanOffset_ = length;
+                return length > maxRequestSize_ ? fail(431) : ParseResult::NeedMore;
+            }
+            ParseResult result = parseHead(data, headerEnd);
+            if (result != ParseResult::NeedMore) {
+                return result;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (state_ == State::Body) {
+        if (length - bodyStart_ < contentLength_) {
+            return ParseResult::NeedMore;
+        }
+        body_ = {static_cast<uint32_t>(bodyStart_), static_cast<uint32_t>(contentLength_)};
+        consumed_ = bodyStart_ + contentLength_;
+        state_ = State::Done;
+        return ParseResult::Complete;
+    }
+
+    return parseChunked(data, length);
+}
+
+ParseResult HttpRequestParser::parseHead(const char* data, size_t headerEnd) {
+    // Tolerate empty lines before the request line (RFC 9112 section 2.2)
+    size_t pos = 0;
+    while (pos + 1 < headerEnd && data[pos] == '\r' && data[pos + 1] == '\n') {
+        pos += 2;
+    }
+
+    // Request line: method SP target SP version
+    size_t lineEnd = findCrlf(data, pos, headerEnd + 2);
+    std::string_view line(data + pos, lineEnd - pos);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+    if (sp1 == 0 || sp1 == std::string_view::npos || sp2 == std::string_view::npos ||
+        sp2 == sp1 + 1 || line.compare(sp2 + 1, 5, "HTTP/") != 0) {
+        return fail(400);
+    }
+
+    auto span = [](size_t offset, size_t len) {
+        return Span{static_cast<uint32_t>(offset), static_cast<uint32_t>(len)};
+    };
+    method_ = span(pos, sp1);
+    target_ = span(pos + sp1 + 1, sp2 - sp1 - 1);
+    version_ = span(pos + sp2 + 1, line.size() - sp2 - 1);
+
+    std::string_view target = slice(target_);
+    size_t queryPos = target.find('?');
+    if (queryPos == std::string_view::npos) {
+        path_ = target_;
+    } else {
+        path_ = span(target_.offset, queryPos);
+        query_ = span(target_.offset + queryPos + 1, target.size() - queryPos - 1);
+    }
+
+    // Header fields
+    pos = lineEnd + 2;
+    while (pos < headerEnd + 2) {
+        lineEnd = findCrlf(data, pos, headerEnd + 2);
+        std::string_view field(data + pos, lineEnd - pos);
+        size_t colon = field.find(':');
+        if (colon == 0 || colon == std::string_view::npos) {
+            return fail(400);
+        }
+        if (headerCount_ == kMaxHeaders) {
+            return fail(431);
+        }
+
+        size_t valueStart = colon + 1;
+        size_t valueEnd = field.size();
+        while (valueStart < valueEnd && (field[valueStart] == ' ' || field[valueStart] == '\t')) ++valueStart;
+        while (valueEnd > valueStart && (field[valueEnd - 1] == ' ' || field[valueEnd - 1] == '\t')) --valueEnd;
+
+        headerNames_[headerCount_] = span(pos, colon);
+        headerValues_[headerCount_] = span(pos + valueStart, valueEnd - valueStart);
+        ++headerCount_;
+        pos = lineEnd + 2;
+    }
+
+    bodyStart_ = headerEnd + 4;
+
+    // A proxy that frames the body differently could smuggle a second request
+    // into a pipelined connection, so ambiguous framing is refused (RFC 9112
+    // section 6.3); the error response closes the connection
+    std::string_view contentLength;
+    bool hasContentLength = false;
+    for (size_t i = 0; i < headerCount_; ++i) {
+        if (!equalsIgnoreCase(slice(headerNames_[i]), "Content-Length")) {
+            continue;
+        }
+        std::string_view value = slice(headerValues_[i]);
+        if (hasContentLength && value != contentLength) {
+            return fail(400);
+        }
+        contentLength = value;
+        hasContentLength = true;
+    }
+
+    std::string_view transferEncoding = header("Transfer-Encoding");
+    if (!transferEncoding.empty()) {
+        if (hasContentLength) {
+            return fail(400);
+        }
+        // Only chunked is supported
+        if (!hasToken(transferEncoding, "chunked")) {
+            return fail(501);
+        }
+        readPos_ = bodyStart_;
+        writePos_ = bodyStart_;
+        state_ = State::ChunkSize;
+        return ParseResult::NeedMore;
+    }
+
+    contentLength_ = 0;
+    for (char c : contentLength) {
+        if (c < '0' || c > '9') {
+            return fail(400);
+        }
+        contentLength_ = contentLength_ * 10 + static_cast<size_t>(c - '0');
+        if (contentLength_ > maxRequestSize_) {
+            return fail(413);
+        }
+    }
+    if (bodyStart_ + contentLength_ > maxRequestSize_) {
+        return fail(413);
+    }
+
+    state_ = State::Body;
+    return ParseResult::NeedMore;
+}
+
+ParseResult HttpRequestParser::parseChunked(char* data, size_t length) {
+    while (true) {
+        switch (state_) {
+            case State::ChunkSize: {
+                size_t lineEnd = findCrlf(data, readPos_, length);
+                if (lineEnd == std::string_view::npos) {
+                    return length > maxRequestSize_ ? fail(413) : ParseResult::NeedMore;
+                }
+                size_t size = 0;
+                size_t digits = 0;
+                for (size_t i = readPos_; i < lineEnd; ++i, ++digits) {
+                    char c = toLower(data[i]);
+                    int value;
+                    if (c >= '0' && c <= '9') value = c - '0';
+                    else if (c >= 'a' && c <= 'f') value = c - 'a' + 10;
+                    else break; // Chunk extensions are ignored
+                    size = size * 16 + static_cast<size_t>(value);
+                    if (size > maxRequestSize_) {
+                        return fail(413);
+                    }
+                }
+                if (digits == 0) {
+                    return fail(400);
+                }
+                readPos_ = lineEnd + 2;
+                if (size == 0) {
+                    state_ = State::Trailer;
+                } else {
+                    if (writePos_ - bodyStart_ + size > maxRequestSize_) {
+                        return fail(413);
+                    }
+                    chunkRemaining_ = size;
+                    state_ = State::ChunkData;
+                }
+                break;
+            }
+            case State::ChunkData: {
+                // Decoded data is compacted towards the start of the body in place
+                size_t available = std::min(length - readPos_, chunkRemaining_);
+                if (available > 0 && writePos_ != readPos_) {
+                    std::memmove(data + writePos_, data + readPos_, available);
+                }
+                writePos_ += available;
+                readPos_ += available;
+                chunkRemaining_ -= available;
+                if (chunkRemaining_ > 0) {
+                    return ParseResult::NeedMore;
+                }
+                state_ = State::ChunkDataEnd;
+                break;
+            }
+            case State::ChunkDataEnd: {
+                if (length - readPos_ < 2) {
+                    return ParseResult::NeedMore;
+                }
+                if (data[readPos_] != '\r' || data[readPos_ + 1] != '\n') {
+                    return fail(400);
+                }
+                readPos_ += 2;
+                state_ = State::ChunkSize;
+                break;
+            }
+            case State::Trailer: {
+                size_t lineEnd = findCrlf(data, readPos_, length);
+                if (lineEnd == std::string_view::npos) {
+                    return length > maxRequestSize_ ? fail(413) : ParseResult::NeedMore;
+                }
+                bool last = lineEnd == readPos_;
+                readPos_ = lineEnd + 2;
+                if (last) {
+                    body_ = {static_cast<uint32_t>(bodyStart_), static_cast<uint32_t>(writePos_ - bodyStart_)};
+                    consumed_ = readPos_;
+                    state_ = State::Done;
+                    return ParseResult::Complete;
+                }
+                break; // Trailer fields are ignored
+            }
+            default:
+                return fail(400);
+        }
+    }
+}
+
+} // namespace dcp
@@ -1,24 +1,334 @@
 #include "http_server.h"
+#include "http_parser.h"
 #include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <filesystem>
+#ifdef DCP_HAVE_IO_URING
+#include "io_uring.h"
+#endif
 
 namespace dcp {
 
-HttpServer::HttpServer(int port) : port_(port), running_(false) {}
+namespace {
+
+constexpr size_t kReadChunkSize = 16384;
+constexpr size_t kMaxPooledArenas = 256;
+
+#ifdef DCP_HAVE_IO_URING
+constexpr unsigned kRingEntries = 1024;
+
+// io_uring user data: connection operations carry the Connection pointer in
+// the upper bits and the operation in the low three; loop operations have no pointer
+constexpr uint64_t kOpMask = 7;
+enum : uint64_t {
+    kOpRecv = 1,
+    kOpSend = 2,
+    kOpPollIn = 3,
+    kOpPollOut = 4,
+    kOpAccept = 5,
+    kOpWake = 6,
+    kOpWakePoll = 7
+};
+#endif
+
+const char* statusReason(int status) {
+    switch (status) {
+        case 100: return "Continue";
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 203: return "Non-Authoritative Information";
+        case 204: return "No Content";
+        case 205: return "Reset Content";
+        case 206: return "Partial Content";
+        case 300: return "Multiple Choices";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 402: return "Payment Required";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 406: return "Not Acceptable";
+        case 407: return "Proxy Authentication Required";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 410: return "Gone";
+        case 411: return "Length Required";
+        case 412: return "Precondition Failed";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 415: return "Unsupported Media Type";
+        case 416: return "Range Not Satisfiable";
+        case 417: return "Expectation Failed";
+        case 421: return "Misdirected Request";
+        case 422: return "Unprocessable Entity";
+        case 425: return "Too Early";
+        case 426: return "Upgrade Required";
+        case 428: return "Precondition Required";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 451: return "Unavailable For Legal Reasons";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        case 505: return "HTTP Version Not Supported";
+        case 507: return "Insufficient Storage";
+        case 511: return "Network Authentication Required";
+        default: return "Unknown";
+    }
+}
+
+// Must run with the connection's arena current; fields are views into the receive buffer
+HttpRequest materializeRequest(const HttpRequestParser& parser) {
+    HttpRequest request;
+    request.method = parser.method();
+    request.path = parser.path();
+    request.query = parser.query();
+    request.version = parser.version();
+    
+    for (size_t i = 0; i < parser.headerCount(); ++i) {
+        HttpHeaderView header = parser.header(i);
+        request.headers.append(header.name, header.value);
+    }
+    
+    // Parse query parameters (simple implementation)
+    std::string_view query = parser.query();
+    while (!query.empty()) {
+        size_t ampPos = query.find('&');
+        std::string_view param = query.substr(0, ampPos);
+        size_t eqPos = param.find('=');
+        if (eqPos != std::string_view::npos) {
+            request.params.append(param.substr(0, eqPos), param.substr(eqPos + 1));
+        }
+        if (ampPos == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(ampPos + 1);
+    }
+    
+    request.body = parser.body();
+    return request;
+}
+
+} // namespace
+
+struct HttpServer::Connection {
+    int fd;
+    std::string inBuffer;   // left untouched while a request is processed; the request views it
+    HttpRequestParser parser;
+    size_t requestBytes = 0; // wire bytes of the current request, dropped once it is answered
+    std::unique_ptr<RequestArena> arena; // held from parse until the response is written
+    HttpRequest request;    // kept here rather than in the worker task, which stays small
+    std::string_view outHead; // status line and headers, in the arena
+    std::string outBody;
+    std::shared_ptr<const std::string> outSharedBody;
+    std::shared_ptr<FileBody> outFile;
+    std::function<bool(std::string&)> outStream; // more of a streamed body to come
+    size_t outOffset = 0;   // bytes of head + body already written
+    bool processing = false;
+    bool keepAlive = false;
+    bool peerClosed = false;
+    bool closed = false;
+    int requestCount = 0;
+    TimerWheel::Timer timer; // the deadline for the connection's current phase
+    ConnectionTimeout timeout = ConnectionTimeout::IDLE;
+    
+    // Send arguments live here so they outlive an asynchronous sendmsg
+    struct iovec outIov[2];
+    struct msghdr outMsg{};
+    // io_uring engine only
+    size_t recvBase = 0;    // where the in-flight receive lands in inBuffer
+    bool recvPending = false;
+    int pendingOps = 0;
+    
+    Connection(int fd, size_t maxRequestSize) : fd(fd), parser(maxRequestSize) {
+        timer.context = this;
+    }
+};
+
+struct HttpServer::Completion {
+    std::shared_ptr<Connection> conn;
+    std::string_view head;
+    HttpResponse response;
+    bool keepAlive;
+};
+
+struct HttpResponder::State {
+    std::function<void(HttpResponse)> complete;
+    std::atomic<bool> sent{false};
+    
+    ~State() {
+        if (!sent.exchange(true)) {
+            HttpResponse response;
+            response.status = 500;
+            response.headers["Content-Type"] = "text/plain";
+            response.body = statusReason(500);
+            complete(std::move(response));
+        }
+    }
+};
+
+void HttpResponder::send(HttpResponse response) {
+    if (state_ && !state_->sent.exchange(true)) {
+        auto complete = std::move(state_->complete); // drops the connection once sent
+        complete(std::move(response));
+    }
+}
+
+struct HttpServer::EventLoop {
+    int index = 0;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+    TimerWheel timers;
+    
+    // Responses produced by worker threads, handed back to the loop thread
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+    std::vector<Completion> drained; // swapped with completions so neither reallocates
+    
+    // Reset arenas ready for the next request on any connection of this loop
+    std::vector<std::unique_ptr<RequestArena>> arenaPool;
+    
+    std::unique_ptr<RequestArena> acquireArena() {
+        if (arenaPool.empty()) {
+            return std::make_unique<RequestArena>();
+        }
+        auto arena = std::move(arenaPool.back());
+        arenaPool.pop_back();
+        return arena;
+    }
+    
+    void releaseArena(std::unique_ptr<RequestArena> arena) {
+        if (arena && arenaPool.size() < kMaxPooledArenas) {
+            arena->reset();
+            arenaPool.push_back(std::move(arena));
+        }
+    }
+    
+#ifdef DCP_HAVE_IO_URING
+    std::unique_ptr<IoUring> ring;
+    std::vector<std::shared_ptr<Connection>> draining; // closed with operations still in flight
+    int inFlight = 0;
+    uint64_t wakeValue = 0;
+    bool multishotAccept = true;
+    
+    io_uring_sqe* prepare(uint8_t opcode, const std::shared_ptr<Connection>& conn, uint64_t op) {
+        io_uring_sqe* sqe = ring->prepare(opcode, conn->fd, reinterpret_cast<uintptr_t>(conn.get()) | op);
+        if (sqe) {
+            ++conn->pendingOps;
+            ++inFlight;
+        }
+        return sqe;
+    }
+    
+    void armAccept() {
+        io_uring_sqe* sqe = ring->prepare(IORING_OP_ACCEPT, listenFd, kOpAccept);
+        if (sqe) {
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            if (multishotAccept) {
+                sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+            }
+            ++inFlight;
+        }
+    }
+    
+    void armWake(bool poll = false) {
+        io_uring_sqe* sqe = ring->prepare(poll ? IORING_OP_POLL_ADD : IORING_OP_READ, wakeFd,
+                                          poll ? kOpWakePoll : kOpWake);
+        if (sqe) {
+            if (poll) {
+                sqe->poll32_events = POLLIN;
+            } else {
+                sqe->addr = reinterpret_cast<uintptr_t>(&wakeValue);
+                sqe->len = sizeof(wakeValue);
+            }
+            ++inFlight;
+        }
+    }
+#endif
+    
+    ~EventLoop() {
+        if (listenFd >= 0) close(listenFd);
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+    }
+    
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+FileBody::~FileBody() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+HttpServer::HttpServer(int port)
+    : port_(port), running_(false), shedQueueFull_(0), shedRouteLimit_(0), ioUring_(false) {}
 
 HttpServer::~HttpServer() {
     stop();
 }
 
-void HttpServer::addRoute(const std::string& method, const std::string& path, HttpHandler handler) {
-    std::string key = method + " " + path;
-    routes_[key] = handler;
+void HttpServer::setStaticDirectory(const std::string& dir) {
+    staticDir_ = dir;
+    staticCache_ = dir.empty() ? nullptr : std::make_unique<StaticFileCache>(dir);
+}
+
+void HttpServer::addRoute(const std::string& method, const std::string& path, HttpHandler handler,
+                          RoutePolicy policy) {
+    router_.add(method, path, std::move(handler), policy);
+}
+
+void HttpServer::addDeferredRoute(const std::string& method, const std::string& path,
+                                  HttpDeferredHandler handler, RoutePolicy policy) {
+    Route& route = router_.add(method, path, nullptr, policy);
+    route.deferredHandler = std::move(handler);
+}
+
+HttpServerStats HttpServer::getStats() const {
+    HttpServerStats stats;
+    if (workers_) {
+        for (size_t i = 0; i < ThreadPool::kPriorityLevels; ++i) {
+            stats.queueDepth[i] = workers_->queueDepth(i);
+        }
+    }
+    stats.shedQueueFull = shedQueueFull_;
+    stats.shedRouteLimit = shedRouteLimit_;
+    for (size_t i = 0; i < kConnectionTimeoutKinds; ++i) {
+        stats.timeouts[i] = timeouts_[i];
+    }
+    return stats;
 }
 
 bool HttpServer::start() {
@@ -26,12 +336,83 @@ bool HttpServer::start() {
         return false; // Already running
     }
     
-    serverThread_ = std::thread([this]() { serverLoop(); });
+    // One listener per event loop; with several, SO_REUSEPORT lets the
+    // kernel spread incoming connections across their accept queues
+    int numListeners = std::max(1, config_.listeners);
+    bool reusePort = numListeners > 1;
+    
+#ifdef DCP_HAVE_IO_URING
+    ioUring_ = config_.ioUring && IoUring::supported();
+    if (config_.ioUring && !ioUring_) {
+        std::cerr << "io_uring is not available, falling back to epoll" << std::endl;
+    }
+#else
+    ioUring_ = false;
+#endif
+    
+    for (int i = 0; i < numListeners; ++i) {
+        auto loop = std::make_shared<EventLoop>();
+        loop->index = i;
+        loop->listenFd = openListener(reusePort);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        bool engineReady = false;
+        if (!ioUring_) {
+            loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+            engineReady = loop->epollFd >= 0;
+        }
+#ifdef DCP_HAVE_IO_URING
+        if (ioUring_) {
+            loop->ring = std::make_unique<IoUring>();
+            engineReady = loop->ring->init(kRingEntries);
+        }
+#endif
+        if (loop->listenFd < 0 || !engineReady || loop->wakeFd < 0) {
+            if (loop->listenFd >= 0) {
+                std::cerr << "Error creating event loop" << std::endl;
+            }
+            loops_.clear();
+            running_ = false;
+            return false;
+        }
+        
+        if (!ioUring_) {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = loop->listenFd;
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->listenFd, &ev);
+            ev.data.fd = loop->wakeFd;
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &ev);
+        }
+        
+        loops_.push_back(std::move(loop));
+    }
+    
+    size_t numWorkers = config_.workerThreads > 0
+        ? static_cast<size_t>(config_.workerThreads)
+        : std::max(1u, std::thread::hardware_concurrency());
+    workers_ = std::make_unique<ThreadPool>(numWorkers, config_.maxQueuedRequests);
+    workers_->start();
+    
+    unsigned numCpus = std::max(1u, std::thread::hardware_concurrency());
+    for (auto& loopPtr : loops_) {
+        EventLoop* loop = loopPtr.get();
+        loop->thread = std::thread([this, loop]() { serverLoop(*loop); });
+        
+        if (config_.pinListenerThreads) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(loop->index % numCpus, &cpus);
+            if (pthread_setaffinity_np(loop->thread.native_handle(), sizeof(cpus), &cpus) != 0) {
+                std::cerr << "Could not pin listener " << loop->index << " to CPU " 
+                         << loop->index % numCpus << std::endl;
+            }
+        }
+    }
     
-    // Give the server a moment to start
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << "HTTP Server started on port " << port_ 
+             << " (" << numListeners << " listeners, " << numWorkers << " worker threads, " << ioEngine() << ")" << std::endl;
     
-    return running_;
+    return true;
 }
 
 void HttpServer::stop() {
@@ -39,22 +420,46 @@ void HttpServer::stop() {
         return; // Already stopped
     }
     
-    if (serverThread_.joinable()) {
-        serverThread_.join();
+    for (auto& loop : loops_) {
+        loop->wake();
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+    
+    // Workers may still hold connections; they post completions that are never drained
+    if (workers_) {
+        workers_->stop();
+        workers_.reset();
+    }
+    
+    for (auto& loop : loops_) {
+        for (auto& [fd, conn] : loop->connections) {
+            close(fd);
+        }
     }
+    loops_.clear();
+    
+    std::cout << "HTTP Server stopped" << std::endl;
 }
 
-void HttpServer::serverLoop() {
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+int HttpServer::openListener(bool reusePort) {
+    int serverSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (serverSocket < 0) {
         std::cerr << "Error creating socket" << std::endl;
-        running_ = false;
-        return;
+        return -1;
     }
     
     // Allow socket reuse
     int opt = 1;
     setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reusePort && setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        std::cerr << "Error enabling SO_REUSEPORT" << std::endl;
+        close(serverSocket);
+        return -1;
+    }
     
     struct sockaddr_in serverAddr;
     serverAddr.sin_family = AF_INET;
@@ -64,194 +469,842 @@ void HttpServer::serverLoop() {
     if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
         std::cerr << "Error binding to port " << port_ << std::endl;
         close(serverSocket);
-        running_ = false;
-        return;
+        return -1;
     }
     
-    if (listen(serverSocket, 10) < 0) {
+    int backlog = config_.backlog > 0 ? config_.backlog : SOMAXCONN;
+    if (listen(serverSocket, backlog) < 0) {
         std::cerr << "Error listening on socket" << std::endl;
         close(serverSocket);
-        running_ = false;
+        return -1;
+    }
+    
+    return serverSocket;
+}
+
+void HttpServer::serverLoop(EventLoop& loop) {
+#ifdef DCP_HAVE_IO_URING
+    if (loop.ring) {
+        serverLoopUring(loop);
         return;
     }
+#endif
     
-    std::cout << "HTTP Server started on port " << port_ << std::endl;
+    std::vector<struct epoll_event> events(config_.maxEvents > 0 ? config_.maxEvents : 256);
     
     while (running_) {
+        int timeout = loop.timers.nextTimeoutMs(std::chrono::steady_clock::now(), 1000);
+        int n = epoll_wait(loop.epollFd, events.data(), static_cast<int>(events.size()), timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error waiting for events" << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t mask = events[i].events;
+            
+            if (fd == loop.listenFd) {
+                acceptConnections(loop);
+                continue;
+            }
+            if (fd == loop.wakeFd) {
+                uint64_t count;
+                while (read(loop.wakeFd, &count, sizeof(count)) > 0) {}
+                drainCompletions(loop);
+                continue;
+            }
+            
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) {
+                continue;
+            }
+            auto conn = it->second;
+            
+            if (mask & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(loop, conn);
+                continue;
+            }
+            if (mask & EPOLLIN) {
+                handleReadable(loop, conn);
+            }
+            if ((mask & EPOLLOUT) && !conn->closed) {
+                handleWritable(loop, conn);
+            }
+        }
+        
+        expireTimers(loop);
+    }
+}
+
+#ifdef DCP_HAVE_IO_URING
+void HttpServer::serverLoopUring(EventLoop& loop) {
+    IoUring& ring = *loop.ring;
+    
+    loop.armAccept();
+    loop.armWake();
+    
+    while (running_) {
+        // Submits everything queued since the last pass and waits in one syscall
+        int rc = ring.wait(loop.timers.nextTimeoutMs(std::chrono::steady_clock::now(), 1000));
+        if (rc < 0 && rc != -ETIME && rc != -EINTR && rc != -EBUSY) {
+            std::cerr << "Error waiting for io_uring completions: " << std::strerror(-rc) << std::endl;
+            break;
+        }
+        
+        ring.forEachCompletion([this, &loop](const io_uring_cqe& cqe) {
+            handleUringCompletion(loop, cqe.user_data, cqe.res, cqe.flags);
+        });
+        
+        expireTimers(loop);
+    }
+    
+    // Complete everything still in flight before the buffers it targets are freed
+    shutdown(loop.listenFd, SHUT_RDWR);
+    for (const auto& [fd, conn] : loop.connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    loop.wake();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (loop.inFlight > 0 && std::chrono::steady_clock::now() < deadline) {
+        ring.wait(100);
+        ring.forEachCompletion([&loop](const io_uring_cqe& cqe) {
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                --loop.inFlight;
+            }
+        });
+    }
+}
+
+void HttpServer::handleUringCompletion(EventLoop& loop, uint64_t userData, int result, uint32_t flags) {
+    uint64_t op = userData & kOpMask;
+    bool more = flags & IORING_CQE_F_MORE; // multishot operation still armed
+    if (!more) {
+        --loop.inFlight;
+    }
+    
+    switch (op) {
+        case kOpAccept:
+            if (result >= 0) {
+                auto conn = std::make_shared<Connection>(result, config_.maxRequestSize);
+                loop.connections[result] = conn;
+                armTimeout(loop, *conn, ConnectionTimeout::IDLE);
+                armRecv(loop, conn);
+            } else if (result == -EINVAL && loop.multishotAccept) {
+                loop.multishotAccept = false; // Kernel predates multishot accept
+            } else if (result != -EAGAIN && result != -EINTR && result != -ECONNABORTED) {
+                std::cerr << "Error accepting connection" << std::endl;
+            }
+            if (!more && running_) {
+                loop.armAccept();
+            }
+            return;
+        case kOpWake:
+            if (result == -EAGAIN) {
+                loop.armWake(true); // Non-blocking eventfd on an older kernel: poll first
+                return;
+            }
+            drainCompletions(loop);
+            loop.armWake();
+            return;
+        case kOpWakePoll:
+            loop.armWake();
+            return;
+    }
+    
+    auto* raw = reinterpret_cast<Connection*>(userData & ~kOpMask);
+    --raw->pendingOps;
+    if (raw->closed) {
+        if (raw->pendingOps == 0) {
+            auto it = std::find_if(loop.draining.begin(), loop.draining.end(),
+                                   [raw](const std::shared_ptr<Connection>& c) { return c.get() == raw; });
+            if (it != loop.draining.end()) {
+                loop.draining.erase(it);
+            }
+        }
+        return;
+    }
+    std::shared_ptr<Connection> conn = loop.connections[raw->fd];
+    
+    switch (op) {
+        case kOpRecv:
+            conn->recvPending = false;
+            conn->inBuffer.resize(conn->recvBase + (result > 0 ? result : 0));
+            if (result == -EAGAIN) {
+                // Older kernels hand non-blocking sockets back; wait for readiness
+                io_uring_sqe* sqe = loop.prepare(IORING_OP_POLL_ADD, conn, kOpPollIn);
+                if (!sqe) {
+                    closeConnection(loop, conn);
+                    return;
+                }
+                sqe->poll32_events = POLLIN;
+                conn->recvPending = true;
+                return;
+            }
+            if (result == 0 || (result < 0 && result != -EINTR)) {
+                conn->peerClosed = true;
+            }
+            processInput(loop, conn);
+            armRecv(loop, conn);
+            return;
+        case kOpPollIn:
+            conn->recvPending = false;
+            armRecv(loop, conn);
+            return;
+        case kOpSend:
+            if (result == -EAGAIN) {
+                // Socket buffer full (a slow reader): wait for room instead of resubmitting at once
+                watchConnection(loop, conn, EPOLLOUT);
+                return;
+            }
+            if (result > 0) {
+                conn->outOffset += static_cast<size_t>(result);
+            } else if (result != -EINTR) {
+                closeConnection(loop, conn);
+                return;
+            }
+            handleWritable(loop, conn);
+            return;
+        case kOpPollOut:
+            handleWritable(loop, conn);
+            return;
+    }
+}
+
+void HttpServer::armRecv(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    if (conn->closed || conn->processing || conn->recvPending || conn->peerClosed ||
+        conn->inBuffer.size() > config_.maxRequestSize) {
+        return;
+    }
+    
+    // The kernel fills the tail of the buffer directly; nothing else touches
+    // inBuffer until the completion arrives
+    conn->recvBase = conn->inBuffer.size();
+    conn->inBuffer.resize(conn->recvBase + kReadChunkSize);
+    io_uring_sqe* sqe = loop.prepare(IORING_OP_RECV, conn, kOpRecv);
+    if (!sqe) {
+        conn->inBuffer.resize(conn->recvBase);
+        closeConnection(loop, conn);
+        return;
+    }
+    sqe->addr = reinterpret_cast<uintptr_t>(&conn->inBuffer[conn->recvBase]);
+    sqe->len = kReadChunkSize;
+    conn->recvPending = true;
+}
+#endif
+
+void HttpServer::armTimeout(EventLoop& loop, Connection& conn, ConnectionTimeout kind) {
+    // Header and body deadlines run from the start of the phase, so a client
+    // trickling bytes cannot extend them; the write deadline restarts on progress
+    if (conn.timer.armed() && conn.timeout == kind && kind != ConnectionTimeout::WRITE) {
+        return;
+    }
+    
+    int timeoutMs = 0;
+    switch (kind) {
+        case ConnectionTimeout::HEADER: timeoutMs = config_.headerTimeoutMs; break;
+        case ConnectionTimeout::BODY: timeoutMs = config_.bodyTimeoutMs; break;
+        case ConnectionTimeout::IDLE: timeoutMs = config_.keepAliveTimeoutMs; break;
+        case ConnectionTimeout::WRITE: timeoutMs = config_.writeTimeoutMs; break;
+    }
+    conn.timeout = kind;
+    if (timeoutMs <= 0) {
+        loop.timers.cancel(conn.timer);
+        return;
+    }
+    loop.timers.schedule(conn.timer, std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+}
+
+void HttpServer::expireTimers(EventLoop& loop) {
+    loop.timers.advance(std::chrono::steady_clock::now(), [this, &loop](TimerWheel::Timer& timer) {
+        auto* raw = static_cast<Connection*>(timer.context);
+        auto it = loop.connections.find(raw->fd);
+        if (it != loop.connections.end() && it->second.get() == raw) {
+            handleTimeout(loop, it->second);
+        }
+    });
+}
+
+void HttpServer::handleTimeout(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    ++timeouts_[static_cast<size_t>(conn->timeout)];
+    
+    // A client stuck mid-request is told why; the write deadline bounds the reply
+    if ((conn->timeout == ConnectionTimeout::HEADER || conn->timeout == ConnectionTimeout::BODY) &&
+        !conn->processing) {
+        conn->arena = loop.acquireArena();
+        RequestArena::Scope scope(*conn->arena);
+        rejectRequest(loop, conn, 408);
+        return;
+    }
+    closeConnection(loop, conn);
+}
+
+void HttpServer::acceptConnections(EventLoop& loop) {
+    while (true) {
         struct sockaddr_in clientAddr;
         socklen_t clientLen = sizeof(clientAddr);
         
-        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientLen);
+        int clientSocket = accept4(loop.listenFd, (struct sockaddr*)&clientAddr, &clientLen,
+                                   SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (clientSocket < 0) {
-            if (running_) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
                 std::cerr << "Error accepting connection" << std::endl;
             }
+            return;
+        }
+        
+        auto conn = std::make_shared<Connection>(clientSocket, config_.maxRequestSize);
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = clientSocket;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, clientSocket, &ev) < 0) {
+            close(clientSocket);
             continue;
         }
+        loop.connections[clientSocket] = conn;
+        armTimeout(loop, *conn, ConnectionTimeout::IDLE);
+    }
+}
+
+void HttpServer::handleReadable(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    while (true) {
+        // Receive straight into the connection buffer; the parser works in place
+        size_t used = conn->inBuffer.size();
+        conn->inBuffer.resize(used + kReadChunkSize);
+        ssize_t bytesRead = recv(conn->fd, &conn->inBuffer[used], kReadChunkSize, 0);
+        conn->inBuffer.resize(used + (bytesRead > 0 ? bytesRead : 0));
         
-        // Handle connection in a separate thread for better concurrency
-        std::thread([this, clientSocket]() {
-            handleConnection(clientSocket);
-        }).detach();
+        if (bytesRead > 0) {
+            if (conn->inBuffer.size() > config_.maxRequestSize) {
+                break; // Leave the rest in the socket until this is consumed
+            }
+            continue;
+        }
+        if (bytesRead == 0) {
+            conn->peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn->peerClosed = true;
+        }
+        break;
     }
     
-    close(serverSocket);
-    std::cout << "HTTP Server stopped" << std::endl;
+    processInput(loop, conn);
 }
 
-void HttpServer::handleConnection(int clientSocket) {
-    char buffer[4096] = {0};
-    ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+void HttpServer::processInput(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    if (conn->processing) {
+        return;
+    }
     
-    if (bytesRead <= 0) {
-        close(clientSocket);
+    // Requests are handled one at a time so pipelined responses stay in order
+    ParseResult result = conn->parser.parse(conn->inBuffer.data(), conn->inBuffer.size());
+    if (result != ParseResult::NeedMore) {
+        conn->arena = loop.acquireArena();
+        RequestArena::Scope scope(*conn->arena);
+        if (result == ParseResult::Error) {
+            rejectRequest(loop, conn, conn->parser.errorStatus());
+            return;
+        }
+        
+        // The request refers into inBuffer, so its bytes stay there until the response is written
+        HttpRequest request = materializeRequest(conn->parser);
+        bool keepAlive = conn->parser.keepAlive();
+        conn->requestBytes = conn->parser.consumed();
+        conn->parser.reset();
+        dispatchRequest(loop, conn, std::move(request), keepAlive);
         return;
     }
     
-    std::string requestStr(buffer, bytesRead);
-    HttpRequest request = parseRequest(requestStr);
+    // A half-closed client may still be waiting for its response
+    if (conn->peerClosed) {
+        closeConnection(loop, conn);
+        return;
+    }
+    if (conn->inBuffer.empty()) {
+        armTimeout(loop, *conn, ConnectionTimeout::IDLE);
+    } else {
+        armTimeout(loop, *conn, conn->parser.headersComplete() ? ConnectionTimeout::BODY
+                                                               : ConnectionTimeout::HEADER);
+    }
+}
+
+void HttpServer::rejectRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, int status) {
+    conn->processing = true;
+    loop.timers.cancel(conn->timer);
+    watchConnection(loop, conn, 0);
     
     HttpResponse response;
-    std::string routeKey = request.method + " " + request.path;
+    response.status = status;
+    response.headers["Content-Type"] = "text/plain";
+    response.headers["Connection"] = "close";
+    response.body = statusReason(status);
+    std::string_view head = buildResponseHead(response, *conn->arena);
+    sendResponse(loop, conn, head, std::move(response), false);
+}
+
+void HttpServer::dispatchRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, 
+                                 HttpRequest request, bool keepAlive) {
+    conn->processing = true;
+    keepAlive = keepAlive && (!conn->peerClosed || conn->inBuffer.size() > conn->requestBytes) &&
+        ++conn->requestCount < config_.maxRequestsPerConnection;
     
-    auto it = routes_.find(routeKey);
-    if (it != routes_.end()) {
-        try {
-            response = it->second(request);
-        } catch (const std::exception& e) {
-            response.status = 500;
-            response.body = "Internal Server Error: " + std::string(e.what());
+    // Stop watching for input while the request is being handled; pipelined
+    // requests wait in the socket buffer until the response has been written.
+    // No deadline applies until the response is ready to be sent.
+    watchConnection(loop, conn, 0);
+    loop.timers.cancel(conn->timer);
+    
+    // Route in the loop thread so admission can use the route's policy.
+    // Parameter names belong to the router and values to request.path, so
+    // both views stay valid for the whole request.
+    RouteMatch match;
+    Route* route = nullptr;
+    RoutePriority priority = RoutePriority::LOW; // static files and 404s
+    if (router_.find(request.method, request.path, match)) {
+        route = const_cast<Route*>(match.route);
+        priority = route->policy.priority;
+        for (size_t i = 0; i < match.paramCount; ++i) {
+            request.params.append(match.paramNames[i], match.paramValues[i]);
         }
-    } else if (request.method == "GET" && !staticDir_.empty()) {
-        // Try to serve static file
-        response = handleStaticFile(request.path);
+        
+        int limit = route->policy.maxConcurrency;
+        if (route->inFlight.fetch_add(1) >= limit && limit > 0) {
+            route->inFlight.fetch_sub(1);
+            ++shedRouteLimit_;
+            shedRequest(loop, conn, keepAlive);
+            return;
+        }
+    }
+    
+    conn->request = std::move(request);
+    EventLoop* loopPtr = &loop;
+    bool submitted;
+    if (route && route->deferredHandler) {
+        // The responder keeps the loop alive, since it may outlast stop()
+        std::shared_ptr<EventLoop> owner;
+        for (const auto& candidate : loops_) {
+            if (candidate.get() == &loop) {
+                owner = candidate;
+            }
+        }
+        submitted = workers_->submit([this, owner, conn, keepAlive, route]() {
+            HttpResponder responder;
+            responder.state_ = std::make_shared<HttpResponder::State>();
+            responder.state_->complete = [this, owner, conn, keepAlive, route](HttpResponse response) {
+                completeRequest(*owner, conn, route, keepAlive, std::move(response));
+            };
+            // No current arena: the response may be written, and the arena
+            // recycled, while the handler is still running
+            try {
+                route->deferredHandler(conn->request, std::move(responder));
+            } catch (const std::exception& e) {
+                std::cerr << "Deferred handler failed: " << e.what() << std::endl; // a dropped responder answers 500
+            }
+        }, static_cast<size_t>(priority));
     } else {
-        response.status = 404;
-        response.body = "Not Found";
+        submitted = workers_->submit([this, loopPtr, conn, keepAlive, route]() {
+            // The loop thread leaves the request and arena alone until the completion is drained
+            RequestArena::Scope scope(*conn->arena);
+            completeRequest(*loopPtr, conn, route, keepAlive, executeRequest(route, conn->request));
+        }, static_cast<size_t>(priority));
     }
     
-    std::string responseStr = buildResponse(response);
-    send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
+    if (!submitted) {
+        if (route) {
+            route->inFlight.fetch_sub(1);
+        }
+        if (!running_) {
+            closeConnection(loop, conn);
+            return;
+        }
+        ++shedQueueFull_;
+        shedRequest(loop, conn, keepAlive);
+    }
+}
+
+void HttpServer::shedRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, bool keepAlive) {
+    // Built on the loop thread without running a handler. It goes through the
+    // completion queue rather than straight to sendResponse so a burst of
+    // pipelined requests that are all shed does not recurse through processInput.
+    HttpResponse response;
+    response.status = 503;
+    response.headers["Content-Type"] = "text/plain";
+    response.headers["Retry-After"] = std::to_string(std::max(0, config_.retryAfterSeconds));
+    response.headers["Connection"] = keepAlive ? "keep-alive" : "close";
+    response.body = statusReason(503);
+    std::string_view head = buildResponseHead(response, *conn->arena);
     
-    close(clientSocket);
+    {
+        std::lock_guard<std::mutex> lock(loop.completionMutex);
+        loop.completions.push_back({conn, head, std::move(response), keepAlive});
+    }
+    loop.wake();
 }
 
-HttpRequest HttpServer::parseRequest(const std::string& requestStr) {
-    HttpRequest request;
+void HttpServer::drainCompletions(EventLoop& loop) {
+    std::vector<Completion>& completions = loop.drained;
+    {
+        std::lock_guard<std::mutex> lock(loop.completionMutex);
+        completions.swap(loop.completions);
+    }
+    
+    for (auto& completion : completions) {
+        const auto& conn = completion.conn;
+        if (conn->closed) {
+            continue;
+        }
+        sendResponse(loop, conn, completion.head, std::move(completion.response), completion.keepAlive);
+    }
+    completions.clear();
+}
+
+void HttpServer::sendResponse(EventLoop& loop, const std::shared_ptr<Connection>& conn,
+                              std::string_view head, HttpResponse response, bool keepAlive) {
+    conn->outHead = head;
+    conn->outBody = std::move(response.body);
+    conn->outSharedBody = std::move(response.sharedBody);
+    conn->outFile = std::move(response.fileBody);
+    conn->outStream = std::move(response.streamBody);
+    conn->outOffset = 0;
+    conn->keepAlive = keepAlive;
+    if (conn->outStream) {
+        nextChunk(*conn);
+    }
+    handleWritable(loop, conn);
+}
+
+void HttpServer::nextChunk(Connection& conn) {
+    // Fixed-width size line, filled in once the piece is known; leading
+    // zeros are allowed in a chunk size
+    constexpr size_t kSizeLine = 10; // 8 hex digits + CRLF
+    std::string& out = conn.outBody;
+    out.assign(kSizeLine, '0');
+    bool more;
+    do {
+        more = conn.outStream(out);
+    } while (more && out.size() == kSizeLine);
+    
+    size_t size = out.size() - kSizeLine;
+    if (size > 0) {
+        // Pieces are tens of KB (see HttpResponse::streamBody), far below the 4 GiB 8 digits hold
+        char line[kSizeLine + 1];
+        std::snprintf(line, sizeof(line), "%08x\r\n", static_cast<uint32_t>(size));
+        out.replace(0, kSizeLine, line, kSizeLine);
+        out.append("\r\n");
+    } else {
+        out.clear();
+    }
+    if (!more) {
+        out.append("0\r\n\r\n");
+        conn.outStream = nullptr;
+    }
+}
+
+void HttpServer::handleWritable(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    if (conn->outHead.empty()) {
+        return; // Nothing queued
+    }
     
-    std::istringstream stream(requestStr);
-    std::string line;
+    std::string_view body = conn->outSharedBody ? std::string_view(*conn->outSharedBody)
+                                                : std::string_view(conn->outBody);
+    const size_t headSize = conn->outHead.size();
+    size_t memoryTotal = headSize + body.size();
     
-    // Parse request line
-    if (std::getline(stream, line)) {
-        std::istringstream lineStream(line);
-        lineStream >> request.method >> request.path;
+    // Gather the header block and body into one syscall, resuming after partial writes
+    while (conn->outOffset < memoryTotal || conn->outStream) {
+        if (conn->outOffset >= memoryTotal) {
+            // Streamed body: the chunk in outBody is out, produce the next one
+            nextChunk(*conn);
+            body = conn->outBody;
+            conn->outOffset = headSize;
+            memoryTotal = headSize + body.size();
+            continue;
+        }
+        struct iovec* iov = conn->outIov;
+        int iovCount = 0;
+        if (conn->outOffset < headSize) {
+            iov[iovCount].iov_base = const_cast<char*>(conn->outHead.data() + conn->outOffset);
+            iov[iovCount].iov_len = headSize - conn->outOffset;
+            ++iovCount;
+            if (!body.empty()) {
+                iov[iovCount].iov_base = const_cast<char*>(body.data());
+                iov[iovCount].iov_len = body.size();
+                ++iovCount;
+            }
+        } else {
+            size_t bodyOffset = conn->outOffset - headSize;
+            iov[iovCount].iov_base = const_cast<char*>(body.data() + bodyOffset);
+            iov[iovCount].iov_len = body.size() - bodyOffset;
+            ++iovCount;
+        }
         
-        // Extract query parameters
-        size_t queryPos = request.path.find('?');
-        if (queryPos != std::string::npos) {
-            std::string query = request.path.substr(queryPos + 1);
-            request.path = request.path.substr(0, queryPos);
-            
-            // Parse query parameters (simple implementation)
-            std::istringstream queryStream(query);
-            std::string param;
-            while (std::getline(queryStream, param, '&')) {
-                size_t eqPos = param.find('=');
-                if (eqPos != std::string::npos) {
-                    std::string key = param.substr(0, eqPos);
-                    std::string value = param.substr(eqPos + 1);
-                    request.params[key] = value;
-                }
+        struct msghdr& msg = conn->outMsg;
+        msg = msghdr{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovCount;
+        // Let the kernel coalesce the header block with a following file body
+        int flags = MSG_NOSIGNAL | (conn->outFile ? MSG_MORE : 0);
+#ifdef DCP_HAVE_IO_URING
+        if (loop.ring) {
+            // The completion comes back through handleUringCompletion, which resumes here
+            io_uring_sqe* sqe = loop.prepare(IORING_OP_SENDMSG, conn, kOpSend);
+            if (!sqe) {
+                closeConnection(loop, conn);
+                return;
             }
+            sqe->addr = reinterpret_cast<uintptr_t>(&msg);
+            sqe->msg_flags = static_cast<uint32_t>(flags);
+            armTimeout(loop, *conn, ConnectionTimeout::WRITE);
+            return;
         }
+#endif
+        ssize_t sent = sendmsg(conn->fd, &msg, flags);
+        if (sent > 0) {
+            conn->outOffset += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watchConnection(loop, conn, EPOLLOUT); // Resume once the socket drains
+            armTimeout(loop, *conn, ConnectionTimeout::WRITE);
+            return;
+        }
+        closeConnection(loop, conn);
+        return;
     }
     
-    // Parse headers
-    while (std::getline(stream, line) && line != "\r" && !line.empty()) {
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos) {
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-            // Trim whitespace
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t\r\n") + 1);
-            request.headers[key] = value;
+    // Large static files go straight from the page cache to the socket
+    while (conn->outFile && conn->outFile->length > 0) {
+        FileBody& file = *conn->outFile;
+        ssize_t sent = sendfile(conn->fd, file.fd, &file.offset, file.length);
+        if (sent > 0) {
+            file.length -= static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watchConnection(loop, conn, EPOLLOUT);
+            armTimeout(loop, *conn, ConnectionTimeout::WRITE);
+            return;
         }
+        // Error, or the file shrank underneath us; the response cannot be completed
+        closeConnection(loop, conn);
+        return;
     }
     
-    // Parse body (rest of the request)
-    std::string body;
-    std::string bodyLine;
-    while (std::getline(stream, bodyLine)) {
-        body += bodyLine + "\n";
+    // Response fully written
+    if (!conn->keepAlive) {
+        closeConnection(loop, conn);
+        return;
+    }
+    
+    conn->outHead = {};
+    conn->outBody.clear();
+    conn->outSharedBody.reset();
+    conn->outFile.reset();
+    conn->outStream = nullptr;
+    conn->outOffset = 0;
+    loop.releaseArena(std::move(conn->arena));
+    conn->inBuffer.erase(0, conn->requestBytes);
+    conn->requestBytes = 0;
+    conn->processing = false;
+    
+    // Serve any pipelined request that is already buffered, otherwise wait for more input
+    processInput(loop, conn);
+    if (!conn->closed && !conn->processing) {
+        watchConnection(loop, conn, EPOLLIN);
+    }
+}
+
+void HttpServer::watchConnection(EventLoop& loop, const std::shared_ptr<Connection>& conn, uint32_t events) {
+#ifdef DCP_HAVE_IO_URING
+    if (loop.ring) {
+        // Operations are one-shot, so there is nothing to switch off
+        if (events & EPOLLIN) {
+            armRecv(loop, conn);
+        }
+        if (events & EPOLLOUT) {
+            io_uring_sqe* sqe = loop.prepare(IORING_OP_POLL_ADD, conn, kOpPollOut);
+            if (!sqe) {
+                closeConnection(loop, conn);
+                return;
+            }
+            sqe->poll32_events = POLLOUT;
+        }
+        return;
+    }
+#endif
+    struct epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = conn->fd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+void HttpServer::closeConnection(EventLoop& loop, const std::shared_ptr<Connection>& conn) {
+    if (conn->closed) {
+        return;
+    }
+    conn->closed = true;
+    loop.timers.cancel(conn->timer);
+#ifdef DCP_HAVE_IO_URING
+    if (loop.ring) {
+        // Shutting the socket down completes whatever is still in flight; the
+        // connection outlives the map entry until the kernel is done with it
+        shutdown(conn->fd, SHUT_RDWR);
+        if (conn->pendingOps > 0) {
+            loop.draining.push_back(conn);
+        }
     }
-    if (!body.empty()) {
-        body.pop_back(); // Remove last newline
+#endif
+    if (loop.epollFd >= 0) {
+        epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
     }
-    request.body = body;
+    close(conn->fd);
+    loop.connections.erase(conn->fd);
+}
+
+void HttpServer::completeRequest(EventLoop& loop, const std::shared_ptr<Connection>& conn, Route* route,
+                                 bool keepAlive, HttpResponse response) {
+    // Runs on a worker, or on whichever thread completes a deferred request
+    if (route) {
+        route->inFlight.fetch_sub(1);
+    }
+    keepAlive = keepAlive && running_;
+    response.headers["Connection"] = keepAlive ? "keep-alive" : "close";
+    std::string_view head = buildResponseHead(response, *conn->arena);
     
-    return request;
+    {
+        std::lock_guard<std::mutex> lock(loop.completionMutex);
+        loop.completions.push_back({conn, head, std::move(response), keepAlive});
+    }
+    loop.wake();
 }
 
-std::string HttpServer::buildResponse(const HttpResponse& response) {
-    std::stringstream ss;
+HttpResponse HttpServer::executeRequest(const Route* route, const HttpRequest& request) {
+    HttpResponse response;
     
-    ss << "HTTP/1.1 " << response.status << " ";
-    switch (response.status) {
-        case 200: ss << "OK"; break;
-        case 404: ss << "Not Found"; break;
-        case 500: ss << "Internal Server Error"; break;
-        default: ss << "Unknown"; break;
+    if (route) {
+        try {
+            response = route->handler(request);
+        } catch (const std::exception& e) {
+            response.status = 500;
+            response.body = "Internal Server Error: " + std::string(e.what());
+        }
+    } else if (request.method == "GET" && !staticDir_.empty()) {
+        // Try to serve static file
+        response = handleStaticFile(request);
+    } else {
+        response.status = 404;
+        response.body = "Not Found";
     }
-    ss << "\r\n";
     
-    // Add headers
+    return response;
+}
+
+std::string_view HttpServer::buildResponseHead(const HttpResponse& response, RequestArena& arena) {
+    const char* reason = statusReason(response.status);
+    // 1xx, 204 and 304 responses never carry a body
+    bool hasBody = response.status >= 200 && response.status != 204 && response.status != 304;
+    bool hasContentType = response.headers.contains("Content-Type");
+    char status[16];
+    int statusLength = std::snprintf(status, sizeof(status), "%d", response.status);
+    char contentLength[24];
+    int contentLengthLength = std::snprintf(contentLength, sizeof(contentLength), "%zu", response.bodySize());
+    
+    size_t size = 64 + std::strlen(reason) + statusLength + contentLengthLength;
     for (const auto& [key, value] : response.headers) {
-        ss << key << ": " << value << "\r\n";
+        size += key.size() + value.size() + 4;
     }
     
-    ss << "Content-Length: " << response.body.length() << "\r\n";
-    ss << "\r\n";
-    ss << response.body;
+    // Written straight into the arena; size is an upper bound
+    char* head = static_cast<char*>(arena.allocate(size, 1));
+    char* out = head;
+    auto append = [&out](std::string_view text) {
+        std::memcpy(out, text.data(), text.size());
+        out += text.size();
+    };
+    
+    append("HTTP/1.1 ");
+    append(std::string_view(status, statusLength));
+    append(" ");
+    append(reason);
+    append("\r\n");
     
-    return ss.str();
+    // Add headers
+    for (const auto& [key, value] : response.headers) {
+        append(key);
+        append(": ");
+        append(value);
+        append("\r\n");
+    }
+    if (!hasContentType) {
+        append("Content-Type: text/html\r\n");
+    }
+    
+    if (hasBody && response.streamBody) {
+        append("Transfer-Encoding: chunked\r\n");
+    } else if (hasBody) {
+        append("Content-Length: ");
+        append(std::string_view(contentLength, contentLengthLength));
+        append("\r\n");
+    }
+    append("\r\n");
+    return std::string_view(head, static_cast<size_t>(out - head));
 }
 
-HttpResponse HttpServer::handleStaticFile(const std::string& path) {
+HttpResponse HttpServer::handleStaticFile(const HttpRequest& request) {
     HttpResponse response;
     
-    std::string filePath = staticDir_ + path;
-    if (path == "/") {
-        filePath += "index.html";
-    }
-    
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
+    auto file = staticCache_ ? staticCache_->lookup(std::string(request.path)) : nullptr;
+    if (!file) {
         response.status = 404;
         response.body = "File not found";
         return response;
     }
     
-    // Read file content
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    response.body = buffer.str();
-    
-    // Set content type based on file extension
-    if (filePath.length() >= 5 && filePath.substr(filePath.length() - 5) == ".html") {
-        response.headers["Content-Type"] = "text/html";
-    } else if (filePath.length() >= 4 && filePath.substr(filePath.length() - 4) == ".css") {
-        response.headers["Content-Type"] = "text/css";
-    } else if (filePath.length() >= 3 && filePath.substr(filePath.length() - 3) == ".js") {
-        response.headers["Content-Type"] = "application/javascript";
-    } else if (filePath.length() >= 5 && filePath.substr(filePath.length() - 5) == ".json") {
-        response.headers["Content-Type"] = "application/json";
-    } else {
-        response.headers["Content-Type"] = "application/octet-stream";
+    response.headers["Content-Type"] = file->contentType;
+    response.headers["ETag"] = file->etag;
+    response.headers["Last-Modified"] = file->lastModified;
+    response.headers["Cache-Control"] = "no-cache";
+    
+    // Conditional GET: If-None-Match takes precedence over If-Modified-Since
+    const HttpField* ifNoneMatch = request.headers.find("If-None-Match");
+    const HttpField* ifModifiedSince = request.headers.find("If-Modified-Since");
+    bool notModified = false;
+    if (ifNoneMatch) {
+        notModified = ifNoneMatch->value == "*" || ifNoneMatch->value.find(file->etag) != std::string_view::npos;
+    } else if (ifModifiedSince) {
+        time_t since;
+        notModified = StaticFileCache::parseHttpDate(std::string(ifModifiedSince->value), since) &&
+                      file->mtime <= since;
+    }
+    if (notModified) {
+        response.status = 304;
+        return response;
+    }
+    
+    if (file->content) {
+        response.sharedBody = file->content;
+        return response;
     }
     
+    int fd = open(file->filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        response.status = 404;
+        response.body = "File not found";
+        return response;
+    }
+    response.fileBody = std::make_shared<FileBody>(fd, 0, static_cast<size_t>(st.st_size));
     return response;
 }
 
-} // namespace dcp
\ No newline at end of file
+} // namespace dcp
@@ -0,0 +1,52 @@
+#include "interned_string.h"
+#include <mutex>
+#include <ostream>
+#include <unordered_set>
+
+namespace dcp {
+
+namespace {
+
+// Node-based, so interned strings never move
+struct InternPool {
+    std::mutex mutex;
+    std::unordered_set<std::string> strings;
+};
+
+InternPool& pool() {
+    static InternPool* instance = new InternPool(); // outlives static destructors
+    return *instance;
+}
+
+const std::string* intern(const std::string& text) {
+    InternPool& strings = pool();
+    std::lock_guard<std::mutex> lock(strings.mutex);
+    return &*strings.strings.insert(text).first;
+}
+
+const std::string* emptyString() {
+    static const std::string* empty = intern(std::string());
+    return empty;
+}
+
+} // namespace
+
+InternedString::InternedString() : value_(emptyString()) {}
+
+InternedString::InternedString(const std::string& text)
+    : value_(text.empty() ? emptyString() : intern(text)) {}
+
+InternedString::InternedString(const char* text)
+    : InternedString(std::string(text ? text : "")) {}
+
+size_t InternedString::poolSize() {
+    InternPool& strings = pool();
+    std::lock_guard<std::mutex> lock(strings.mutex);
+    return strings.strings.size();
+}
+
+std::ostream& operator<<(std::ostream& out, const InternedString& text) {
+    return out << text.str();
+}
+
+} // namespace dcp
@@ -0,0 +1,52 @@
+#include "lease_reaper.h"
+#include <chrono>
+
+namespace dcp {
+
+LeaseReaper::LeaseReaper(std::shared_ptr<ServiceRegistry> registry, std::shared_ptr<Monitoring> monitoring)
+    : registry_(registry), monitoring_(monitoring), running_(false) {
+}
+
+LeaseReaper::~LeaseReaper() {
+    stop();
+}
+
+void LeaseReaper::start() {
+    if (running_.exchange(true)) {
+        return; // Already running
+    }
+    
+    thread_ = std::thread([this]() { run(); });
+}
+
+void LeaseReaper::stop() {
+    if (!running_.exchange(false)) {
+        return; // Already stopped
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void LeaseReaper::run() {
+    while (running_) {
+        ServiceRegistry::LeaseExpiry expiry = registry_->expireLeases();
+        if (expiry.expired > 0) {
+            monitoring_->incrementCounter("registry_lease_expirations_total", static_cast<double>(expiry.expired));
+        }
+        if (expiry.evicted > 0) {
+            monitoring_->incrementCounter("registry_lease_evictions_total", static_cast<double>(expiry.evicted));
+        }
+        
+        int sleepMs = registry_->nextLeaseTimeoutMs(kMaxSleepMs);
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(sleepMs), [this]() { return !running_; });
+    }
+}
+
+} // namespace dcp
@@ -8,7 +8,9 @@ LoadBalancer::LoadBalancer(std::shared_ptr<ServiceRegistry> registry, LoadBalanc
 }
 
 std::shared_ptr<Service> LoadBalancer::selectService(const std::string& serviceName) const {
-    auto services = registry_->getHealthyServices(serviceName);
+    // Picks straight from the registry snapshot instead of copying the instance list
+    auto snapshot = registry_->snapshot();
+    const auto& services = snapshot->healthyServices(serviceName);
     
     if (services.empty()) {
         return nullptr;
@@ -5,10 +5,9 @@
 
 namespace dcp {
 
-void Monitoring::incrementCounter(const std::string& name, double value, 
-                                 const std::unordered_map<std::string, std::string>& labels) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
+namespace {
+
+std::string metricKey(const std::string& name, const std::unordered_map<std::string, std::string>& labels) {
     std::string key = name;
     if (!labels.empty()) {
         key += "{";
@@ -20,6 +19,16 @@ void Monitoring::incrementCounter(const std::string& name, double value,
         }
         key += "}";
     }
+    return key;
+}
+
+} // namespace
+
+void Monitoring::incrementCounter(const std::string& name, double value, 
+                                 const std::unordered_map<std::string, std::string>& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::string key = metricKey(name, labels);
     
     auto it = metrics_.find(key);
     if (it == metrics_.end()) {
@@ -37,17 +46,7 @@ void Monitoring::setGauge(const std::string& name, double value,
                          const std::unordered_map<std::string, std::string>& labels) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    std::string key = name;
-    if (!labels.empty()) {
-        key += "{";
-        bool first = true;
-        for (const auto& [k, v] : labels) {
-            if (!first) key += ",";
-            key += k + "=" + v;
-            first = false;
-        }
-        key += "}";
-    }
+    std::string key = metricKey(name, labels);
     
     auto it = metrics_.find(key);
     if (it == metrics_.end()) {
@@ -61,6 +60,24 @@ void Monitoring::setGauge(const std::string& name, double value,
     it->second->timestamp = std::chrono::system_clock::now();
 }
 
+void Monitoring::setCounter(const std::string& name, double value, 
+                            const std::unordered_map<std::string, std::string>& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::string key = metricKey(name, labels);
+    
+    auto it = metrics_.find(key);
+    if (it == metrics_.end()) {
+        auto metric = std::make_shared<Metric>(name, "counter");
+        metric->labels = labels;
+        metrics_[key] = metric;
+        it = metrics_.find(key);
+    }
+    
+    it->second->value.store(value);
+    it->second->timestamp = std::chrono::system_clock::now();
+}
+
 void Monitoring::recordHistogram(const std::string& name, double value, 
                                 const std::unordered_map<std::string, std::string>& labels) {
     // For simplicity, treat histograms as gauges for now
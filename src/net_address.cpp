@@ -0,0 +1,62 @@
+#include "net_address.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <cstring>
+
+namespace dcp {
+
+NetAddress::NetAddress() : family_(0), bytes_{} {}
+
+NetAddress NetAddress::parse(const std::string& text) {
+    NetAddress address;
+    if (inet_pton(AF_INET, text.c_str(), address.bytes_) == 1) {
+        address.family_ = AF_INET;
+    } else if (inet_pton(AF_INET6, text.c_str(), address.bytes_) == 1) {
+        address.family_ = AF_INET6;
+    } else {
+        std::memset(address.bytes_, 0, sizeof(address.bytes_));
+    }
+    return address;
+}
+
+NetAddress NetAddress::fromBytes(int family, const uint8_t* bytes) {
+    NetAddress address;
+    if (family == AF_INET || family == AF_INET6) {
+        address.family_ = static_cast<uint8_t>(family);
+        std::memcpy(address.bytes_, bytes, family == AF_INET ? 4 : 16);
+    }
+    return address;
+}
+
+socklen_t NetAddress::toSockaddr(uint16_t port, sockaddr_storage& out) const {
+    std::memset(&out, 0, sizeof(out));
+    if (family_ == AF_INET) {
+        auto* addr = reinterpret_cast<sockaddr_in*>(&out);
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(port);
+        std::memcpy(&addr->sin_addr, bytes_, 4);
+        return sizeof(sockaddr_in);
+    }
+    if (family_ == AF_INET6) {
+        auto* addr = reinterpret_cast<sockaddr_in6*>(&out);
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = htons(port);
+        std::memcpy(&addr->sin6_addr, bytes_, 16);
+        return sizeof(sockaddr_in6);
+    }
+    return 0;
+}
+
+std::string NetAddress::toString() const {
+    char text[INET6_ADDRSTRLEN];
+    if (!valid() || !inet_ntop(family_, bytes_, text, sizeof(text))) {
+        return std::string();
+    }
+    return text;
+}
+
+bool NetAddress::operator==(const NetAddress& other) const {
+    return family_ == other.family_ && std::memcmp(bytes_, other.bytes_, sizeof(bytes_)) == 0;
+}
+
+} // namespace dcp
@@ -0,0 +1,1113 @@
+#include "raft_node.h"
+#include "http_client.h"
+#include "registry_record.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace dcp {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds kTick{10};
+constexpr uint64_t kRetainedEntries = 1024;   // kept behind a snapshot for followers that lag a little
+constexpr size_t kSnapshotChunkBytes = 512 * 1024;
+constexpr size_t kApplyBatch = 1024;
+constexpr const char* kBinaryType = "application/octet-stream";
+
+// Log records
+enum class LogRecord : uint8_t {
+    ENTRY = 1, // index, term, command
+    STATE = 2  // current term, vote
+};
+
+int64_t millisSince(Clock::time_point then, Clock::time_point now) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - then).count();
+}
+
+} // namespace
+
+const char* RaftNode::toString(Role role) {
+    switch (role) {
+        case Role::FOLLOWER: return "follower";
+        case Role::PRE_CANDIDATE: return "pre-candidate";
+        case Role::CANDIDATE: return "candidate";
+        case Role::LEADER: return "leader";
+    }
+    return "unknown";
+}
+
+RaftNode::RaftNode(const Options& options, StateMachine stateMachine)
+    : options_(options), stateMachine_(std::move(stateMachine)), wal_(options.directory, options.fsync),
+      snapshotPath_(options.directory + "/snapshot"), quorum_(options.members.size() / 2 + 1),
+      currentTerm_(0), baseIndex_(0), baseTerm_(0), snapshotIndex_(0), snapshotTerm_(0),
+      role_(Role::FOLLOWER), commitIndex_(0), lastApplied_(0), electionRound_(0), votes_(0),
+      electionReady_(false), preVoteWon_(false), leaderStartIndex_(0), durableIndex_(0), syncPending_(false),
+      random_(std::random_device()() ^ static_cast<uint32_t>(std::hash<std::string>()(options.id))),
+      snapshots_(0), receiveFd_(-1), receiveIndex_(0), receiveTerm_(0), receiveOffset_(0), running_(false) {
+    for (const auto& [id, address] : options_.members) {
+        if (id == options_.id) {
+            continue;
+        }
+        auto peer = std::make_unique<Peer>();
+        peer->id = id;
+        if (!HttpClient::parseAddress(address, peer->host, peer->port)) {
+            std::cerr << "Invalid address \"" << address << "\" for cluster member " << id << std::endl;
+        }
+        peers_.push_back(std::move(peer));
+    }
+}
+
+RaftNode::~RaftNode() {
+    stop();
+}
+
+uint64_t RaftNode::termAt(uint64_t index) const {
+    if (index == baseIndex_) {
+        return baseTerm_;
+    }
+    if (index < baseIndex_ || index > lastIndex()) {
+        return 0;
+    }
+    return entryAt(index).term;
+}
+
+bool RaftNode::logUpToDate(uint64_t lastIndex, uint64_t lastTerm) const {
+    uint64_t ownTerm = termAt(this->lastIndex());
+    return lastTerm > ownTerm || (lastTerm == ownTerm && lastIndex >= this->lastIndex());
+}
+
+void RaftNode::resetElectionDeadline() {
+    auto timeout = options_.electionTimeout.count();
+    std::uniform_int_distribution<int64_t> spread(timeout, 2 * timeout - 1);
+    electionDeadline_ = Clock::now() + std::chrono::milliseconds(spread(random_));
+}
+
+void RaftNode::persistState() {
+    std::string record;
+    RecordWriter writer(record);
+    writer.put(LogRecord::STATE);
+    writer.put(currentTerm_);
+    writer.put(votedFor_);
+    wal_.append(record);
+}
+
+void RaftNode::persistEntry(uint64_t index, const Entry& entry) {
+    std::string record;
+    record.reserve(entry.command.size() + 24);
+    RecordWriter writer(record);
+    writer.put(LogRecord::ENTRY);
+    writer.put(index);
+    writer.put(entry.term);
+    writer.put(entry.command);
+    wal_.append(record);
+}
+
+void RaftNode::rewriteLog() {
+    // The new segment alone describes the log; older ones can go once it is synced
+    uint64_t segment = wal_.rotate();
+    persistState();
+    for (uint64_t index = baseIndex_ + 1; index <= lastIndex(); ++index) {
+        persistEntry(index, entryAt(index));
+    }
+    if (wal_.sync()) {
+        wal_.removeSegmentsBefore(segment);
+    }
+}
+
+bool RaftNode::recover() {
+    if (options_.members.find(options_.id) == options_.members.end()) {
+        std::cerr << "Cluster member id \"" << options_.id << "\" is not among the members" << std::endl;
+        return false;
+    }
+
+    // The snapshot first: log entries it covers are skipped on replay
+    std::remove((snapshotPath_ + ".new").c_str());
+    std::remove((snapshotPath_ + ".recv").c_str());
+    if (access(snapshotPath_.c_str(), F_OK) == 0) {
+        std::lock_guard<std::mutex> applyLock(applyMutex_);
+        if (!stateMachine_.loadSnapshot(snapshotPath_, snapshotIndex_, snapshotTerm_)) {
+            std::cerr << "Failed to load Raft snapshot " << snapshotPath_ << std::endl;
+            return false;
+        }
+    }
+    baseIndex_ = snapshotIndex_;
+    baseTerm_ = snapshotTerm_;
+
+    // A rewritten or overwritten entry appears again later in the log; the last write wins
+    bool gap = false;
+    bool opened = wal_.open(0, [&](const char* data, size_t size) {
+        RecordReader reader(data, size);
+        LogRecord type = reader.get<LogRecord>();
+        if (type == LogRecord::STATE) {
+            uint64_t term = reader.get<uint64_t>();
+            std::string vote = reader.getString();
+            if (reader.complete()) {
+                currentTerm_ = term;
+                votedFor_ = std::move(vote);
+            }
+            return;
+        }
+        uint64_t index = reader.get<uint64_t>();
+        Entry entry;
+        entry.term = reader.get<uint64_t>();
+        entry.command = reader.getString();
+        if (type != LogRecord::ENTRY || !reader.complete() || index <= baseIndex_) {
+            return;
+        }
+        if (index > lastIndex() + 1) {
+            gap = true;
+            return;
+        }
+        log_.resize(index - baseIndex_ - 1);
+        log_.push_back(std::move(entry));
+    });
+    if (!opened) {
+        return false;
+    }
+    if (gap) {
+        std::cerr << "Raft log has gaps after index " << lastIndex() << "; later entries were dropped" << std::endl;
+    }
+
+    commitIndex_ = snapshotIndex_;
+    lastApplied_ = snapshotIndex_;
+    durableIndex_ = lastIndex();
+    std::cout << "Raft member " << options_.id << " recovered: term " << currentTerm_ << ", log " << baseIndex_ + 1
+              << ".." << lastIndex() << ", snapshot at " << snapshotIndex_ << std::endl;
+    return true;
+}
+
+bool RaftNode::start() {
+    if (running_) {
+        return false;
+    }
+    if (!recover()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        resetElectionDeadline();
+        if (peers_.empty()) {
+            electionDeadline_ = Clock::now(); // nobody to wait for
+        }
+    }
+    running_ = true;
+    tickThread_ = std::thread([this]() { runTicker(); });
+    applyThread_ = std::thread([this]() { runApply(); });
+    for (auto& peer : peers_) {
+        Peer* target = peer.get();
+        peer->thread = std::thread([this, target]() { runPeer(*target); });
+    }
+    return true;
+}
+
+void RaftNode::stop() {
+    if (!running_.exchange(false)) {
+        return; // Already stopped
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failPending();
+    }
+    peerWake_.notify_all();
+    applyWake_.notify_all();
+    tickWake_.notify_all();
+    for (auto& peer : peers_) {
+        if (peer->thread.joinable()) {
+            peer->thread.join();
+        }
+    }
+    if (tickThread_.joinable()) {
+        tickThread_.join();
+    }
+    if (applyThread_.joinable()) {
+        applyThread_.join();
+    }
+
+    if (receiveFd_ >= 0) {
+        close(receiveFd_);
+        receiveFd_ = -1;
+    }
+    wal_.close();
+}
+
+void RaftNode::becomeFollower(uint64_t term) {
+    if (term > currentTerm_) {
+        currentTerm_ = term;
+        votedFor_.clear();
+        leaderId_.clear(); // whoever leads the new term has not been heard from yet
+        persistState();
+    }
+    if (role_ == Role::LEADER) {
+        std::cout << "Raft member " << options_.id << " stepped down in term " << currentTerm_ << std::endl;
+        failPending();
+    }
+    role_ = Role::FOLLOWER;
+    electionReady_ = false;
+    preVoteWon_ = false;
+    peerWake_.notify_all();
+}
+
+void RaftNode::becomeLeader() {
+    role_ = Role::LEADER;
+    leaderId_ = options_.id;
+    leaderSince_ = Clock::now();
+    electionReady_ = false;
+    for (auto& peer : peers_) {
+        peer->nextIndex = lastIndex() + 1;
+        peer->matchIndex = 0;
+        peer->lastAck = Clock::time_point();
+    }
+
+    // Everything before the no-op was synced with the vote; the no-op
+    // commits the log inherited from earlier terms
+    durableIndex_ = lastIndex();
+    log_.push_back(Entry{currentTerm_, std::string()});
+    leaderStartIndex_ = lastIndex();
+    persistEntry(leaderStartIndex_, log_.back());
+    syncPending_ = true;
+    std::cout << "Raft member " << options_.id << " is the leader for term " << currentTerm_ << std::endl;
+    tickWake_.notify_one();
+    peerWake_.notify_all();
+}
+
+void RaftNode::advanceCommit() {
+    std::vector<uint64_t> matched;
+    matched.reserve(peers_.size() + 1);
+    matched.push_back(durableIndex_);
+    for (const auto& peer : peers_) {
+        matched.push_back(peer->matchIndex);
+    }
+    std::sort(matched.begin(), matched.end(), std::greater<uint64_t>());
+    uint64_t index = matched[quorum_ - 1];
+
+    // Only entries of the current term are committed by counting replicas
+    if (index > commitIndex_ && termAt(index) == currentTerm_) {
+        commitIndex_ = index;
+        applyWake_.notify_one();
+    }
+}
+
+void RaftNode::failPending() {
+    for (auto& [index, pending] : pending_) {
+        if (pending.done) {
+            lost_.push_back(std::move(pending.done));
+        }
+    }
+    pending_.clear();
+    applyWake_.notify_one();
+}
+
+bool RaftNode::quorumContact(Clock::time_point since) const {
+    size_t reached = 1;
+    for (const auto& peer : peers_) {
+        if (peer->lastAck >= since && peer->lastAck != Clock::time_point()) {
+            ++reached;
+        }
+    }
+    return reached >= quorum_;
+}
+
+void RaftNode::pruneFreshness() {
+    while (freshness_.size() >= 2 && freshness_[1].first <= lastApplied_) {
+        freshness_.pop_front();
+    }
+}
+
+bool RaftNode::propose(std::string command, Callback done) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (role_ != Role::LEADER || !running_) {
+        return false;
+    }
+
+    log_.push_back(Entry{currentTerm_, std::move(command)});
+    uint64_t index = lastIndex();
+    persistEntry(index, log_.back());
+    if (done) {
+        pending_.emplace(index, Pending{currentTerm_, std::move(done)});
+    }
+
+    // The ticker syncs the log while peers already replicate the entry
+    syncPending_ = true;
+    tickWake_.notify_one();
+    peerWake_.notify_all();
+    return true;
+}
+
+void RaftNode::runTicker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        tickWake_.wait_for(lock, kTick, [this]() {
+            return !running_ || preVoteWon_ || (role_ == Role::LEADER && syncPending_);
+        });
+        if (!running_) {
+            break;
+        }
+        auto now = Clock::now();
+
+        if (role_ == Role::LEADER) {
+            if (syncPending_) {
+                // Group commit: everything proposed while the last sync ran goes out in this one
+                syncPending_ = false;
+                uint64_t through = lastIndex();
+                uint64_t term = currentTerm_;
+                lock.unlock();
+                bool synced = wal_.sync();
+                lock.lock();
+                if (synced && role_ == Role::LEADER && currentTerm_ == term) {
+                    durableIndex_ = std::max(durableIndex_, through);
+                    advanceCommit();
+                }
+            }
+            // A leader cut off from the majority stops taking writes it could not commit
+            if (now - leaderSince_ > options_.electionTimeout && !quorumContact(now - options_.electionTimeout)) {
+                std::cerr << "Raft member " << options_.id << " lost contact with a majority" << std::endl;
+                becomeFollower(currentTerm_);
+                leaderId_.clear();
+                resetElectionDeadline();
+            }
+            continue;
+        }
+
+        if (preVoteWon_ && role_ == Role::PRE_CANDIDATE) {
+            // A majority would vote: start the real election, durable before any request goes out
+            preVoteWon_ = false;
+            role_ = Role::CANDIDATE;
+            ++currentTerm_;
+            votedFor_ = options_.id;
+            ++electionRound_;
+            votes_ = 1;
+            electionReady_ = false;
+            persistState();
+            resetElectionDeadline();
+            uint64_t term = currentTerm_;
+            uint64_t round = electionRound_;
+            lock.unlock();
+            wal_.sync();
+            lock.lock();
+            if (role_ == Role::CANDIDATE && currentTerm_ == term && electionRound_ == round) {
+                electionReady_ = true;
+                if (votes_ >= quorum_) {
+                    becomeLeader();
+                } else {
+                    peerWake_.notify_all();
+                }
+            }
+        } else if (now >= electionDeadline_) {
+            // Pre-vote: find out whether a majority would vote before disturbing anyone's term
+            role_ = Role::PRE_CANDIDATE;
+            leaderId_.clear();
+            ++electionRound_;
+            votes_ = 1;
+            electionReady_ = true;
+            preVoteWon_ = votes_ >= quorum_;
+            resetElectionDeadline();
+            peerWake_.notify_all();
+        }
+    }
+}
+
+void RaftNode::runApply() {
+    uint64_t nextSnapshot = 0; // after a failed snapshot, when to try again
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        applyWake_.wait(lock, [this]() { return !running_ || commitIndex_ > lastApplied_ || !lost_.empty(); });
+        if (!lost_.empty()) {
+            std::vector<Callback> lost;
+            lost.swap(lost_);
+            lock.unlock();
+            for (auto& done : lost) {
+                done(Outcome::LOST, std::string());
+            }
+            lock.lock();
+            continue;
+        }
+        if (!running_) {
+            break;
+        }
+
+        // The state machine changes under applyMutex_, so a snapshot install cannot interleave
+        lock.unlock();
+        std::lock_guard<std::mutex> applyLock(applyMutex_);
+        lock.lock();
+        std::vector<std::pair<uint64_t, Entry>> batch;
+        for (uint64_t index = lastApplied_ + 1; index <= commitIndex_ && batch.size() < kApplyBatch; ++index) {
+            batch.emplace_back(index, entryAt(index));
+        }
+        lock.unlock();
+
+        for (auto& [index, entry] : batch) {
+            std::string result;
+            if (!entry.command.empty()) {
+                result = stateMachine_.apply(index, entry.command);
+            }
+            Callback done;
+            Outcome outcome = Outcome::COMMITTED;
+            lock.lock();
+            lastApplied_ = index;
+            auto it = pending_.find(index);
+            if (it != pending_.end()) {
+                outcome = it->second.term == entry.term ? Outcome::COMMITTED : Outcome::LOST;
+                done = std::move(it->second.done);
+                pending_.erase(it);
+            }
+            lock.unlock();
+            if (done) {
+                done(outcome, result);
+            }
+        }
+
+        lock.lock();
+        pruneFreshness();
+        if (options_.snapshotEntries > 0 && lastApplied_ - snapshotIndex_ >= options_.snapshotEntries &&
+            lastApplied_ >= nextSnapshot) {
+            lock.unlock();
+            takeSnapshot();
+            lock.lock();
+            if (lastApplied_ - snapshotIndex_ >= options_.snapshotEntries) {
+                nextSnapshot = lastApplied_ + options_.snapshotEntries; // it failed; not again right away
+            }
+        }
+    }
+}
+
+void RaftNode::takeSnapshot() {
+    uint64_t index;
+    uint64_t term;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index = lastApplied_;
+        term = termAt(index);
+    }
+
+    auto startTime = Clock::now();
+    std::string path = snapshotPath_ + ".new";
+    if (!stateMachine_.saveSnapshot(path, index, term)) {
+        std::cerr << "Failed to write Raft snapshot at index " << index << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Renamed under the lock, so the file always matches snapshotIndex_
+    if (std::rename(path.c_str(), snapshotPath_.c_str()) != 0) {
+        std::cerr << "Failed to install Raft snapshot " << snapshotPath_ << std::endl;
+        return;
+    }
+    snapshotIndex_ = index;
+    snapshotTerm_ = term;
+    ++snapshots_;
+
+    uint64_t cut = index > kRetainedEntries ? index - kRetainedEntries : 0;
+    if (cut > baseIndex_) {
+        baseTerm_ = termAt(cut);
+        log_.erase(log_.begin(), log_.begin() + static_cast<std::ptrdiff_t>(cut - baseIndex_));
+        baseIndex_ = cut;
+    }
+    rewriteLog();
+    std::cout << "Raft snapshot at index " << index << " written in " << millisSince(startTime, Clock::now())
+              << " ms" << std::endl;
+}
+
+bool RaftNode::installSnapshot(const std::string& path, uint64_t index, uint64_t term) {
+    std::lock_guard<std::mutex> applyLock(applyMutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index <= lastApplied_) {
+            return true; // nothing new in it
+        }
+    }
+
+    auto startTime = Clock::now();
+    uint64_t loadedIndex = 0;
+    uint64_t loadedTerm = 0;
+    if (!stateMachine_.loadSnapshot(path, loadedIndex, loadedTerm) || loadedIndex != index || loadedTerm != term) {
+        std::cerr << "Failed to install Raft snapshot at index " << index << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::rename(path.c_str(), snapshotPath_.c_str()) != 0) {
+        std::cerr << "Failed to keep the installed Raft snapshot" << std::endl;
+    }
+    snapshotIndex_ = index;
+    snapshotTerm_ = term;
+    ++snapshots_;
+
+    // Keep the entries after the snapshot only if the log agrees with it
+    if (index < lastIndex() && termAt(index) == term) {
+        log_.erase(log_.begin(), log_.begin() + static_cast<std::ptrdiff_t>(index - baseIndex_));
+    } else {
+        log_.clear();
+    }
+    baseIndex_ = index;
+    baseTerm_ = term;
+    commitIndex_ = std::max(commitIndex_, index);
+    lastApplied_ = index;
+    pruneFreshness();
+    rewriteLog();
+    std::cout << "Installed Raft snapshot at index " << index << " in " << millisSince(startTime, Clock::now())
+              << " ms" << std::endl;
+    return true;
+}
+
+std::string RaftNode::handleVote(std::string_view request) {
+    RecordReader reader(request.data(), request.size());
+    uint64_t term = reader.get<uint64_t>();
+    std::string candidate = reader.getString();
+    uint64_t candidateIndex = reader.get<uint64_t>();
+    uint64_t candidateTerm = reader.get<uint64_t>();
+    bool preVote = reader.get<uint8_t>() != 0;
+    if (!reader.complete()) {
+        return std::string();
+    }
+
+    std::string response;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return std::string();
+        }
+        // While a leader is heard from, candidates are refused: they are
+        // the ones out of touch
+        auto now = Clock::now();
+        bool leaderAlive = role_ == Role::LEADER ||
+                           (!leaderId_.empty() && now - lastContact_ < options_.electionTimeout);
+        bool granted = false;
+        if (preVote) {
+            granted = term > currentTerm_ && !leaderAlive && logUpToDate(candidateIndex, candidateTerm);
+        } else if (term >= currentTerm_ && !leaderAlive) {
+            if (term > currentTerm_) {
+                becomeFollower(term);
+            }
+            granted = (votedFor_.empty() || votedFor_ == candidate) && logUpToDate(candidateIndex, candidateTerm);
+            if (granted) {
+                votedFor_ = candidate;
+                persistState();
+                resetElectionDeadline();
+            }
+        }
+        RecordWriter writer(response);
+        writer.put(currentTerm_);
+        writer.put(static_cast<uint8_t>(granted));
+    }
+    // The vote must survive a crash before the candidate counts it
+    wal_.sync();
+    return response;
+}
+
+std::string RaftNode::handleAppend(std::string_view request) {
+    RecordReader reader(request.data(), request.size());
+    uint64_t term = reader.get<uint64_t>();
+    std::string leader = reader.getString();
+    uint64_t prevIndex = reader.get<uint64_t>();
+    uint64_t prevTerm = reader.get<uint64_t>();
+    uint64_t leaderCommit = reader.get<uint64_t>();
+    uint32_t count = reader.get<uint32_t>();
+    std::vector<Entry> entries;
+    entries.reserve(std::min<uint32_t>(count, 65536));
+    for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        Entry entry;
+        entry.term = reader.get<uint64_t>();
+        entry.command = reader.getString();
+        entries.push_back(std::move(entry));
+    }
+    if (!reader.complete()) {
+        return std::string();
+    }
+
+    std::string response;
+    RecordWriter writer(response);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return std::string();
+        }
+        auto reply = [&](bool success, uint64_t index) {
+            writer.put(currentTerm_);
+            writer.put(static_cast<uint8_t>(success));
+            writer.put(index);
+        };
+        if (term < currentTerm_) {
+            reply(false, 0);
+            return response;
+        }
+        if (term > currentTerm_ || role_ != Role::FOLLOWER) {
+            becomeFollower(term);
+        }
+        auto now = Clock::now();
+        leaderId_ = leader;
+        lastContact_ = now;
+        resetElectionDeadline();
+
+        // Entries up to the base are committed, so they match whatever the leader sends
+        if (prevIndex < baseIndex_) {
+            uint64_t skip = baseIndex_ - prevIndex;
+            if (skip >= entries.size()) {
+                reply(true, prevIndex + entries.size());
+                return response;
+            }
+            entries.erase(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(skip));
+            prevIndex = baseIndex_;
+            prevTerm = baseTerm_;
+        }
+        if (prevIndex > lastIndex()) {
+            reply(false, lastIndex() + 1);
+            return response;
+        }
+        if (termAt(prevIndex) != prevTerm) {
+            // Skip back over the whole conflicting term in one round trip
+            uint64_t conflictTerm = termAt(prevIndex);
+            uint64_t hint = prevIndex;
+            while (hint > baseIndex_ + 1 && termAt(hint - 1) == conflictTerm) {
+                --hint;
+            }
+            reply(false, hint);
+            return response;
+        }
+
+        uint64_t index = prevIndex + 1;
+        for (auto& entry : entries) {
+            if (index <= lastIndex()) {
+                if (termAt(index) == entry.term) {
+                    ++index;
+                    continue;
+                }
+                if (index <= commitIndex_) {
+                    std::cerr << "Raft leader " << leader << " conflicts with committed entry " << index << std::endl;
+                    reply(false, commitIndex_ + 1);
+                    return response;
+                }
+                log_.resize(index - baseIndex_ - 1);
+            }
+            log_.push_back(std::move(entry));
+            persistEntry(index, log_.back());
+            ++index;
+        }
+
+        uint64_t matched = prevIndex + entries.size();
+        uint64_t commit = std::min(leaderCommit, matched);
+        if (commit > commitIndex_) {
+            commitIndex_ = commit;
+            applyWake_.notify_one();
+        }
+        // Reads here are as fresh as this message once the leader's commit index is applied
+        if (commitIndex_ == leaderCommit) {
+            if (!freshness_.empty() && freshness_.back().first == leaderCommit) {
+                freshness_.back().second = now;
+            } else {
+                freshness_.emplace_back(leaderCommit, now);
+            }
+            pruneFreshness();
+        }
+        reply(true, matched);
+    }
+    // Acknowledged entries must survive a crash
+    if (!wal_.sync()) {
+        return std::string();
+    }
+    return response;
+}
+
+std::string RaftNode::handleSnapshot(std::string_view request) {
+    RecordReader reader(request.data(), request.size());
+    uint64_t term = reader.get<uint64_t>();
+    std::string leader = reader.getString();
+    uint64_t index = reader.get<uint64_t>();
+    uint64_t snapshotTerm = reader.get<uint64_t>();
+    uint64_t offset = reader.get<uint64_t>();
+    bool done = reader.get<uint8_t>() != 0;
+    std::string_view data;
+    uint32_t size = reader.get<uint32_t>();
+    if (reader.ok() && reader.rest().size() == size) {
+        data = reader.rest();
+    } else {
+        return std::string();
+    }
+
+    std::string response;
+    RecordWriter writer(response);
+    std::string receivePath = snapshotPath_ + ".recv";
+    bool complete = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return std::string();
+        }
+        auto reply = [&](bool success) {
+            writer.put(currentTerm_);
+            writer.put(static_cast<uint8_t>(success));
+        };
+        if (term < currentTerm_) {
+            reply(false);
+            return response;
+        }
+        if (term > currentTerm_ || role_ != Role::FOLLOWER) {
+            becomeFollower(term);
+        }
+        leaderId_ = leader;
+        lastContact_ = Clock::now();
+        resetElectionDeadline();
+
+        if (index <= lastApplied_) {
+            reply(true); // already there
+            return response;
+        }
+        if (offset == 0) {
+            if (receiveFd_ >= 0) {
+                close(receiveFd_);
+            }
+            receiveFd_ = open(receivePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            receiveIndex_ = index;
+            receiveTerm_ = snapshotTerm;
+            receiveOffset_ = 0;
+        }
+        if (receiveFd_ < 0 || index != receiveIndex_ || snapshotTerm != receiveTerm_ || offset != receiveOffset_) {
+            reply(false); // the leader starts over
+            return response;
+        }
+        bool written = true;
+        for (size_t position = 0; position < data.size() && written;) {
+            ssize_t n = pwrite(receiveFd_, data.data() + position, data.size() - position,
+                               static_cast<off_t>(offset + position));
+            written = n > 0;
+            position += written ? static_cast<size_t>(n) : 0;
+        }
+        if (written && done) {
+            written = fsync(receiveFd_) == 0;
+        }
+        if (!written || done) {
+            close(receiveFd_);
+            receiveFd_ = -1;
+        }
+        if (!written) {
+            std::cerr << "Failed to write the received Raft snapshot" << std::endl;
+            reply(false);
+            return response;
+        }
+        receiveOffset_ += data.size();
+        complete = done;
+        if (!complete) {
+            reply(true);
+        }
+    }
+
+    if (complete) {
+        bool installed = installSnapshot(receivePath, index, snapshotTerm);
+        std::lock_guard<std::mutex> lock(mutex_);
+        writer.put(currentTerm_);
+        writer.put(static_cast<uint8_t>(installed));
+    }
+    wal_.sync();
+    return response;
+}
+
+void RaftNode::runPeer(Peer& peer) {
+    int timeoutMs = static_cast<int>(std::max<int64_t>(1000, 2 * options_.electionTimeout.count()));
+    HttpClient client(peer.host, peer.port, timeoutMs);
+    std::deque<std::pair<uint64_t, Clock::time_point>> inflight; // last index sent, when
+    uint64_t inflightTerm = 0;
+    Clock::time_point lastSend;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        bool leader = role_ == Role::LEADER;
+        if (!leader || inflightTerm != currentTerm_) {
+            // Answers to requests from an earlier term are of no use
+            if (!inflight.empty()) {
+                inflight.clear();
+                client.close();
+            }
+            inflightTerm = leader ? currentTerm_ : 0;
+            lastSend = Clock::time_point();
+        }
+        if (!leader) {
+            if ((role_ == Role::PRE_CANDIDATE || role_ == Role::CANDIDATE) && electionReady_ &&
+                peer.voteRound != electionRound_) {
+                requestVote(peer, client, lock);
+            } else {
+                peerWake_.wait_for(lock, options_.heartbeatInterval);
+            }
+            continue;
+        }
+
+        auto now = Clock::now();
+        if (inflight.size() < options_.maxInflight) {
+            if (peer.nextIndex <= baseIndex_) {
+                // What the peer needs next was compacted away
+                if (inflight.empty() && !sendSnapshot(peer, client, lock)) {
+                    peerWake_.wait_for(lock, options_.heartbeatInterval);
+                }
+                if (inflight.empty()) {
+                    continue;
+                }
+            } else if (peer.nextIndex <= lastIndex() ||
+                       (inflight.empty() && now - lastSend >= options_.heartbeatInterval)) {
+                uint64_t prevIndex = peer.nextIndex - 1;
+                uint64_t last = prevIndex;
+                size_t bytes = 0;
+                while (last < lastIndex() && (last == prevIndex || bytes + entryAt(last + 1).command.size() <=
+                                                                       options_.maxBatchBytes)) {
+                    ++last;
+                    bytes += entryAt(last).command.size();
+                }
+
+                std::string body;
+                body.reserve(bytes + 16 * (last - prevIndex) + 64);
+                RecordWriter writer(body);
+                writer.put(currentTerm_);
+                writer.put(options_.id);
+                writer.put(prevIndex);
+                writer.put(termAt(prevIndex));
+                writer.put(commitIndex_);
+                writer.put(static_cast<uint32_t>(last - prevIndex));
+                for (uint64_t index = prevIndex + 1; index <= last; ++index) {
+                    const Entry& entry = entryAt(index);
+                    writer.put(entry.term);
+                    writer.put(entry.command);
+                }
+                peer.nextIndex = last + 1;
+                inflight.emplace_back(last, now);
+                lastSend = now;
+
+                lock.unlock();
+                bool sent = client.send("POST", "/raft/append", body, kBinaryType);
+                lock.lock();
+                if (!sent) {
+                    inflight.clear();
+                    peer.nextIndex = peer.matchIndex + 1;
+                    peerWake_.wait_for(lock, options_.heartbeatInterval);
+                }
+                continue;
+            }
+        }
+        if (inflight.empty()) {
+            // Idle until there is something to send or a heartbeat is due
+            peerWake_.wait_until(lock, lastSend + options_.heartbeatInterval, [&]() {
+                return !running_ || role_ != Role::LEADER || peer.nextIndex <= lastIndex();
+            });
+            continue;
+        }
+
+        // Oldest answer first; the rest stay in flight meanwhile
+        Clock::time_point sentAt = inflight.front().second;
+        HttpClient::Response response;
+        lock.unlock();
+        bool received = client.receive(response);
+        lock.lock();
+        RecordReader reader(response.body.data(), response.body.size());
+        uint64_t term = reader.get<uint64_t>();
+        bool success = reader.get<uint8_t>() != 0;
+        uint64_t index = reader.get<uint64_t>();
+        if (!received || response.status != 200 || !reader.complete()) {
+            inflight.clear();
+            client.close();
+            if (role_ == Role::LEADER && inflightTerm == currentTerm_) {
+                peer.nextIndex = peer.matchIndex + 1;
+            }
+            peerWake_.wait_for(lock, options_.heartbeatInterval);
+            continue;
+        }
+        if (term > currentTerm_) {
+            becomeFollower(term);
+            leaderId_.clear();
+            resetElectionDeadline();
+            continue;
+        }
+        if (role_ != Role::LEADER || inflightTerm != currentTerm_) {
+            continue;
+        }
+        inflight.pop_front();
+        peer.lastAck = std::max(peer.lastAck, sentAt);
+        if (success) {
+            if (index > peer.matchIndex) {
+                peer.matchIndex = index;
+                advanceCommit();
+            }
+        } else {
+            // Everything behind it was sent from the wrong place too
+            inflight.clear();
+            client.close();
+            peer.nextIndex = std::max(peer.matchIndex + 1, std::min(index, lastIndex() + 1));
+        }
+    }
+}
+
+void RaftNode::requestVote(Peer& peer, HttpClient& client, std::unique_lock<std::mutex>& lock) {
+    bool preVote = role_ == Role::PRE_CANDIDATE;
+    uint64_t round = electionRound_;
+    uint64_t term = preVote ? currentTerm_ + 1 : currentTerm_;
+    peer.voteRound = round;
+
+    std::string body;
+    RecordWriter writer(body);
+    writer.put(term);
+    writer.put(options_.id);
+    writer.put(lastIndex());
+    writer.put(termAt(lastIndex()));
+    writer.put(static_cast<uint8_t>(preVote));
+
+    HttpClient::Response response;
+    lock.unlock();
+    bool received = client.request("POST", "/raft/vote", body, response, kBinaryType);
+    lock.lock();
+    RecordReader reader(response.body.data(), response.body.size());
+    uint64_t replyTerm = reader.get<uint64_t>();
+    bool granted = reader.get<uint8_t>() != 0;
+    if (!received || response.status != 200 || !reader.complete()) {
+        client.close();
+        return; // not retried; the election times out and starts over
+    }
+
+    if (replyTerm > currentTerm_) {
+        becomeFollower(replyTerm);
+        return;
+    }
+    bool current = electionRound_ == round &&
+                   (preVote ? role_ == Role::PRE_CANDIDATE : role_ == Role::CANDIDATE && currentTerm_ == term);
+    if (!granted || !current) {
+        return;
+    }
+    if (++votes_ >= quorum_) {
+        if (preVote) {
+            preVoteWon_ = true;
+            tickWake_.notify_one();
+        } else {
+            becomeLeader();
+        }
+    }
+}
+
+bool RaftNode::sendSnapshot(Peer& peer, HttpClient& client, std::unique_lock<std::mutex>& lock) {
+    // Opened under the lock, so the file matches snapshotIndex_
+    int fd = open(snapshotPath_.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    uint64_t index = snapshotIndex_;
+    uint64_t snapshotTerm = snapshotTerm_;
+    uint64_t term = currentTerm_;
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+
+    lock.unlock();
+    std::string chunk(kSnapshotChunkBytes, '\0');
+    std::string body;
+    uint64_t offset = 0;
+    uint64_t replyTerm = 0;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done && running_) {
+        ssize_t n = pread(fd, &chunk[0], chunk.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        done = offset + static_cast<uint64_t>(n) >= size;
+        body.clear();
+        RecordWriter writer(body);
+        writer.put(term);
+        writer.put(options_.id);
+        writer.put(index);
+        writer.put(snapshotTerm);
+        writer.put(offset);
+        writer.put(static_cast<uint8_t>(done));
+        writer.put(static_cast<uint32_t>(n));
+        body.append(chunk.data(), static_cast<size_t>(n));
+
+        HttpClient::Response response;
+        ok = client.request("POST", "/raft/snapshot", body, response, kBinaryType) && response.status == 200;
+        RecordReader reader(response.body.data(), response.body.size());
+        replyTerm = reader.get<uint64_t>();
+        ok = ok && reader.get<uint8_t>() != 0 && reader.complete() && replyTerm <= term;
+        offset += static_cast<uint64_t>(n);
+    }
+    close(fd);
+    lock.lock();
+
+    if (replyTerm > currentTerm_) {
+        becomeFollower(replyTerm);
+        return true;
+    }
+    if (!ok || !done) {
+        client.close();
+        return false;
+    }
+    std::cout << "Sent Raft snapshot at index " << index << " (" << size << " bytes) to " << peer.id << std::endl;
+    if (role_ == Role::LEADER && currentTerm_ == term) {
+        peer.matchIndex = std::max(peer.matchIndex, index);
+        peer.nextIndex = std::max(peer.nextIndex, index + 1);
+        peer.lastAck = Clock::now();
+        advanceCommit();
+    }
+    return true;
+}
+
+bool RaftNode::isLeader() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return role_ == Role::LEADER;
+}
+
+std::string RaftNode::leaderId() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return leaderId_;
+}
+
+std::string RaftNode::leaderAddress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = options_.members.find(leaderId_);
+    return it != options_.members.end() ? it->second : std::string();
+}
+
+bool RaftNode::readable(std::chrono::milliseconds maxStaleness) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    if (role_ == Role::LEADER) {
+        // Current once its no-op is applied, for as long as a majority still follows it
+        return lastApplied_ >= leaderStartIndex_ && quorumContact(now - maxStaleness);
+    }
+    if (role_ != Role::FOLLOWER || leaderId_.empty() || freshness_.empty()) {
+        return false;
+    }
+    return freshness_.front().first <= lastApplied_ && now - freshness_.front().second <= maxStaleness;
+}
+
+RaftNode::Status RaftNode::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    Status status;
+    status.id = options_.id;
+    status.role = role_;
+    status.term = currentTerm_;
+    status.leader = leaderId_;
+    status.firstIndex = baseIndex_ + 1;
+    status.lastIndex = lastIndex();
+    status.commitIndex = commitIndex_;
+    status.lastApplied = lastApplied_;
+    status.snapshotIndex = snapshotIndex_;
+    status.snapshots = snapshots_.load();
+    for (const auto& peer : peers_) {
+        Status::Peer entry;
+        entry.id = peer->id;
+        if (role_ == Role::LEADER) {
+            entry.matchIndex = peer->matchIndex;
+            entry.nextIndex = peer->nextIndex;
+            if (peer->lastAck != Clock::time_point()) {
+                entry.lastAckMs = millisSince(peer->lastAck, now);
+            }
+        }
+        status.peers.push_back(entry);
+    }
+    return status;
+}
+
+} // namespace dcp
@@ -0,0 +1,118 @@
+#include "registry_record.h"
+
+namespace dcp {
+
+namespace {
+
+ServiceStatus statusOf(uint8_t value) {
+    return value <= static_cast<uint8_t>(ServiceStatus::UNHEALTHY) ? static_cast<ServiceStatus>(value)
+                                                                   : ServiceStatus::UNKNOWN;
+}
+
+void encodeIdRecord(RecordType type, const std::string& id, uint64_t revision, std::string& out) {
+    RecordWriter writer(out);
+    writer.put(type);
+    writer.put(revision);
+    writer.put(id);
+}
+
+} // namespace
+
+void encodeService(const Service& service, uint64_t revision, std::string& out) {
+    RecordWriter writer(out);
+    writer.put(RecordType::REGISTER);
+    writer.put(revision);
+    writer.put(service.id);
+    writer.put(service.name.str());
+    writer.put(service.host.str());
+    writer.put(service.port);
+    writer.put(service.status);
+    writer.put(service.ttlMs);
+    writer.put(static_cast<uint32_t>(service.metadata->size()));
+    for (const auto& [key, value] : *service.metadata) {
+        writer.put(key.str());
+        writer.put(value);
+    }
+}
+
+void encodeUnregister(const std::string& id, uint64_t revision, std::string& out) {
+    encodeIdRecord(RecordType::UNREGISTER, id, revision, out);
+}
+
+void encodeStatus(const std::string& id, ServiceStatus status, uint64_t revision, std::string& out) {
+    encodeIdRecord(RecordType::STATUS, id, revision, out);
+    RecordWriter(out).put(status);
+}
+
+void encodeHeartbeat(const std::string& id, std::string& out) {
+    encodeIdRecord(RecordType::HEARTBEAT, id, 0, out);
+}
+
+void encodeConfig(const std::string& section, const nlohmann::json& value, std::string& out) {
+    RecordWriter writer(out);
+    writer.put(RecordType::CONFIG);
+    writer.put(section);
+    writer.put(value.dump());
+}
+
+void encodeEvent(const RegistryEvent& event, std::string& out) {
+    switch (event.type) {
+        case RegistryEvent::Type::REGISTERED:
+            encodeService(*event.service, event.revision, out);
+            break;
+        case RegistryEvent::Type::UNREGISTERED:
+            encodeUnregister(event.service->id, event.revision, out);
+            break;
+        case RegistryEvent::Type::STATUS_CHANGED:
+            encodeStatus(event.service->id, event.service->status, event.revision, out);
+            break;
+    }
+}
+
+bool decodeRecord(const char* data, size_t size, RegistryRecord& record) {
+    RecordReader reader(data, size);
+    record.type = reader.get<RecordType>();
+
+    if (record.type == RecordType::CONFIG) {
+        record.section = reader.getString();
+        std::string text = reader.getString();
+        record.value = nlohmann::json::parse(text, nullptr, false);
+        return reader.complete() && !record.value.is_discarded();
+    }
+
+    record.revision = reader.get<uint64_t>();
+    record.id = reader.getString();
+    switch (record.type) {
+        case RecordType::REGISTER: {
+            std::string name = reader.getString();
+            std::string host = reader.getString();
+            uint16_t port = reader.get<uint16_t>();
+            uint8_t status = reader.get<uint8_t>();
+            uint32_t ttlMs = reader.get<uint32_t>();
+            uint32_t count = reader.get<uint32_t>();
+            std::vector<std::pair<std::string, std::string>> metadata;
+            for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+                std::string key = reader.getString();
+                metadata.emplace_back(std::move(key), reader.getString());
+            }
+            if (!reader.complete()) {
+                return false;
+            }
+            record.service = std::make_shared<Service>(record.id, name, host, port);
+            record.service->status = statusOf(status);
+            record.service->ttlMs = ttlMs;
+            record.service->metadata = ServiceMetadata::make(std::move(metadata));
+            return true;
+        }
+        case RecordType::STATUS:
+            record.status = statusOf(reader.get<uint8_t>());
+            return reader.complete();
+        case RecordType::UNREGISTER:
+        case RecordType::HEARTBEAT:
+            return reader.complete();
+        default:
+            return false;
+    }
+}
+
+} // namespace dcp
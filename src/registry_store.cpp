@@ -0,0 +1,303 @@
+#include "registry_store.h"
+#include "registry_record.h"
+#include "snapshot_file.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+
+namespace dcp {
+
+namespace {
+
+// Snapshots written before SnapshotFile: a fixed-size header and then a
+// sequence of length-prefixed log records. Still read, no longer written.
+constexpr char kLegacySnapshotMagic[8] = {'D', 'C', 'P', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t kLegacySnapshotFormat = 1;
+
+struct LegacySnapshotHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t bodyChecksum;
+    uint64_t revision;     // registry revision the snapshot was taken at
+    uint64_t firstSegment; // first log segment not covered by the snapshot
+    uint64_t records;
+    uint64_t bodySize;
+};
+static_assert(sizeof(LegacySnapshotHeader) == 48, "snapshot header layout");
+
+bool readFile(const std::string& path, std::string& content, bool& missing) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    missing = fd < 0 && errno == ENOENT;
+    if (fd < 0) {
+        return false;
+    }
+    content.clear();
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        content.append(buffer, static_cast<size_t>(n));
+    }
+    close(fd);
+    return true;
+}
+
+} // namespace
+
+RegistryStore::RegistryStore(std::shared_ptr<ServiceRegistry> registry, std::shared_ptr<ConfigManager> config,
+                             const Options& options)
+    : registry_(registry), config_(config), options_(options), wal_(options.directory, options.fsync),
+      snapshots_(0), running_(false) {
+}
+
+RegistryStore::~RegistryStore() {
+    stop();
+}
+
+std::string RegistryStore::snapshotPath() const {
+    return options_.directory + "/registry.snapshot";
+}
+
+bool RegistryStore::applyRecord(const char* data, size_t size, uint64_t skipThrough, uint64_t& revision) {
+    RegistryRecord record;
+    if (!decodeRecord(data, size, record)) {
+        std::cerr << "Skipping malformed registry record" << std::endl;
+        return false;
+    }
+
+    switch (record.type) {
+        case RecordType::CONFIG:
+            if (record.value.is_null()) {
+                config_->remove(record.section);
+                configOverrides_.erase(record.section);
+            } else {
+                config_->setSection(record.section, record.value);
+                configOverrides_[record.section] = record.value;
+            }
+            return true;
+        case RecordType::REGISTER:
+        case RecordType::UNREGISTER:
+        case RecordType::STATUS:
+            break;
+        default:
+            std::cerr << "Skipping unknown registry record" << std::endl;
+            return false;
+    }
+
+    if (record.revision <= skipThrough) {
+        return false; // already in the snapshot
+    }
+    if (record.type == RecordType::REGISTER) {
+        registry_->registerService(record.service);
+    } else if (record.type == RecordType::UNREGISTER) {
+        registry_->unregisterService(record.id);
+    } else {
+        registry_->updateServiceStatus(record.id, record.status);
+    }
+    revision = std::max(revision, record.revision);
+    return true;
+}
+
+bool RegistryStore::loadSnapshot(uint64_t& revision, uint64_t& firstSegment) {
+    SnapshotFile file;
+    std::string error;
+    bool missing = false;
+    if (!file.open(snapshotPath(), error, &missing)) {
+        if (missing) {
+            return true; // first start
+        }
+        std::string content;
+        if (readFile(snapshotPath(), content, missing) && content.size() >= sizeof(LegacySnapshotHeader) &&
+            std::memcmp(content.data(), kLegacySnapshotMagic, sizeof(kLegacySnapshotMagic)) == 0) {
+            return loadLegacySnapshot(content, revision, firstSegment);
+        }
+        std::cerr << "Failed to load snapshot " << snapshotPath() << ": " << error << std::endl;
+        return false;
+    }
+
+    for (auto& service : file.services()) {
+        registry_->registerService(std::move(service));
+        ++recovery_.snapshotRecords;
+    }
+    nlohmann::json overrides = nlohmann::json::parse(file.config(), nullptr, false);
+    if (!overrides.is_object()) {
+        std::cerr << "Snapshot " << snapshotPath() << " has malformed config overrides" << std::endl;
+        return false;
+    }
+    for (const auto& [section, value] : overrides.items()) {
+        config_->setSection(section, value);
+        configOverrides_[section] = value;
+        ++recovery_.snapshotRecords;
+    }
+    revision = file.revision();
+    firstSegment = file.firstSegment();
+    return true;
+}
+
+bool RegistryStore::loadLegacySnapshot(const std::string& content, uint64_t& revision, uint64_t& firstSegment) {
+    LegacySnapshotHeader header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    const char* body = content.data() + sizeof(header);
+    if (header.format != kLegacySnapshotFormat || header.bodySize != content.size() - sizeof(header) ||
+        crc32c(body, header.bodySize) != header.bodyChecksum) {
+        std::cerr << "Snapshot " << snapshotPath() << " is corrupt or from an unknown format" << std::endl;
+        return false;
+    }
+
+    size_t offset = 0;
+    for (uint64_t i = 0; i < header.records; ++i) {
+        uint32_t size = 0;
+        if (header.bodySize - offset >= sizeof(size)) {
+            std::memcpy(&size, body + offset, sizeof(size));
+            offset += sizeof(size);
+        }
+        if (offset > header.bodySize || header.bodySize - offset < size || size == 0) {
+            std::cerr << "Snapshot " << snapshotPath() << " ends early" << std::endl;
+            return false;
+        }
+        uint64_t unused = 0;
+        applyRecord(body + offset, size, 0, unused);
+        offset += size;
+        ++recovery_.snapshotRecords;
+    }
+    revision = header.revision;
+    firstSegment = header.firstSegment;
+    return true;
+}
+
+bool RegistryStore::recover() {
+    auto startTime = std::chrono::steady_clock::now();
+    recovery_ = RecoveryStats();
+
+    uint64_t snapshotRevision = 0;
+    uint64_t firstSegment = 0;
+    uint64_t revision = 0;
+    {
+        // Everything recovered is published as one snapshot
+        ServiceRegistry::Batch batch(*registry_);
+        if (!loadSnapshot(snapshotRevision, firstSegment)) {
+            return false;
+        }
+        revision = snapshotRevision;
+        bool opened = wal_.open(firstSegment, [&](const char* data, size_t size) {
+            if (applyRecord(data, size, snapshotRevision, revision)) {
+                ++recovery_.logRecords;
+            }
+        });
+        if (!opened) {
+            return false;
+        }
+    }
+    registry_->restoreRevision(revision);
+
+    recovery_.revision = registry_->version();
+    recovery_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Recovered " << registry_->snapshot()->size() << " services from " << options_.directory
+              << " (" << recovery_.snapshotRecords << " snapshot records, " << recovery_.logRecords
+              << " log records) in " << static_cast<int>(recovery_.seconds * 1000) << " ms" << std::endl;
+    return true;
+}
+
+void RegistryStore::start() {
+    if (running_.exchange(true)) {
+        return; // Already running
+    }
+
+    registry_->setJournal([this](const std::vector<RegistryEvent>& events) {
+        std::string record;
+        for (const auto& event : events) {
+            record.clear();
+            encodeEvent(event, record);
+            wal_.append(record);
+        }
+    });
+    config_->setChangeListener([this](const std::string& section, const nlohmann::json& value) {
+        {
+            std::lock_guard<std::mutex> lock(configMutex_);
+            if (value.is_null()) {
+                configOverrides_.erase(section);
+            } else {
+                configOverrides_[section] = value;
+            }
+        }
+        std::string record;
+        encodeConfig(section, value, record);
+        wal_.append(record);
+    });
+    thread_ = std::thread([this]() { run(); });
+}
+
+void RegistryStore::stop() {
+    if (!running_.exchange(false)) {
+        return; // Already stopped
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    registry_->setJournal(nullptr);
+    config_->setChangeListener(nullptr);
+    checkpoint();
+    wal_.close();
+}
+
+bool RegistryStore::sync() {
+    return wal_.sync();
+}
+
+bool RegistryStore::checkpoint() {
+    std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);
+
+    // Changes logged before the rotation are all in the snapshot taken after it
+    uint64_t segment = wal_.rotate();
+    auto snapshot = registry_->snapshot();
+    std::map<std::string, nlohmann::json> overrides;
+    {
+        std::lock_guard<std::mutex> lock(configMutex_);
+        overrides = configOverrides_;
+    }
+
+    std::vector<std::shared_ptr<Service>> services;
+    services.reserve(snapshot->size());
+    snapshot->forEach([&](const std::shared_ptr<Service>& service) { services.push_back(service); });
+
+    std::string error;
+    if (!SnapshotFile::write(snapshotPath(), services, snapshot->version(), segment, nlohmann::json(overrides).dump(),
+                             error)) {
+        std::cerr << "Failed to write snapshot " << snapshotPath() << ": " << error << std::endl;
+        return false;
+    }
+    wal_.removeSegmentsBefore(segment);
+    ++snapshots_;
+    return true;
+}
+
+void RegistryStore::run() {
+    bool durable = wal_.policy() != FsyncPolicy::NONE;
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, options_.flushInterval, [this]() { return !running_; });
+        }
+
+        // Changes no one waited on (probes, lease expiry) reach the disk here
+        wal_.flush(durable);
+        if (options_.snapshotAfterBytes > 0 && wal_.segmentBytes() >= options_.snapshotAfterBytes) {
+            checkpoint();
+        }
+    }
+}
+
+} // namespace dcp
@@ -0,0 +1,114 @@
+#include "registry_watch.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace dcp {
+
+RegistryWatch::RegistryWatch(std::shared_ptr<ServiceRegistry> registry, ReplyBuilder buildReply)
+    : registry_(registry), buildReply_(std::move(buildReply)), latestRevision_(0), running_(false) {
+}
+
+RegistryWatch::~RegistryWatch() {
+    stop();
+}
+
+void RegistryWatch::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            return; // Already running
+        }
+        running_ = true;
+    }
+
+    registry_->setChangeListener([this](uint64_t revision) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latestRevision_ = std::max(latestRevision_, revision);
+        }
+        changed_.notify_one();
+    });
+    {
+        // Catch up on anything logged before the listener was in place
+        std::lock_guard<std::mutex> lock(mutex_);
+        latestRevision_ = std::max(latestRevision_, registry_->latestChangeRevision());
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+void RegistryWatch::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return; // Already stopped
+        }
+        running_ = false;
+    }
+
+    registry_->setChangeListener(nullptr);
+    changed_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void RegistryWatch::watch(uint64_t revision, std::chrono::milliseconds timeout, HttpResponder responder) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ && revision >= latestRevision_ && revision <= registry_->version()) {
+            watchers_.push_back({revision, std::chrono::steady_clock::now() + timeout, std::move(responder)});
+            changed_.notify_one(); // the new deadline may be the earliest
+            return;
+        }
+    }
+    // Already behind (or resyncing): answer right away on this thread
+    responder.send(buildReply_(revision));
+}
+
+size_t RegistryWatch::parkedWatchers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watchers_.size();
+}
+
+void RegistryWatch::run() {
+    std::vector<Watcher> ready;
+    std::unordered_map<uint64_t, HttpResponse> replies;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        auto wakeAt = now + std::chrono::hours(1);
+        for (const auto& watcher : watchers_) {
+            wakeAt = std::min(wakeAt, watcher.deadline);
+        }
+
+        // Take every watch that has a change to see or has timed out
+        bool stopping = !running_;
+        auto split = std::partition(watchers_.begin(), watchers_.end(), [&](const Watcher& watcher) {
+            return !stopping && watcher.revision >= latestRevision_ && watcher.deadline > now;
+        });
+        std::move(split, watchers_.end(), std::back_inserter(ready));
+        watchers_.erase(split, watchers_.end());
+
+        if (!ready.empty()) {
+            lock.unlock();
+            for (auto& watcher : ready) {
+                auto it = replies.find(watcher.revision);
+                if (it == replies.end()) {
+                    it = replies.emplace(watcher.revision, buildReply_(watcher.revision)).first;
+                }
+                watcher.responder.send(it->second);
+            }
+            ready.clear();
+            replies.clear();
+            lock.lock();
+            continue; // time has passed; look again before sleeping
+        }
+        if (stopping) {
+            break;
+        }
+        changed_.wait_until(lock, wakeAt);
+    }
+}
+
+} // namespace dcp
@@ -0,0 +1,296 @@
+#include "replicated_registry.h"
+#include "registry_record.h"
+#include "snapshot_file.h"
+#include <iostream>
+#include <unordered_set>
+
+namespace dcp {
+
+namespace {
+
+// Appends `record` to a command with its length in front
+void appendRecord(const std::string& record, std::string& command) {
+    RecordWriter(command).put(record);
+}
+
+} // namespace
+
+ReplicatedRegistry::ReplicatedRegistry(std::shared_ptr<ServiceRegistry> registry,
+                                       std::shared_ptr<ConfigManager> config, const Options& options)
+    : registry_(registry), config_(config), options_(options) {
+    RaftNode::StateMachine stateMachine;
+    stateMachine.apply = [this](uint64_t, const std::string& command) { return apply(command); };
+    stateMachine.saveSnapshot = [this](const std::string& path, uint64_t index, uint64_t term) {
+        return saveSnapshot(path, index, term);
+    };
+    stateMachine.loadSnapshot = [this](const std::string& path, uint64_t& index, uint64_t& term) {
+        return loadSnapshot(path, index, term);
+    };
+    node_ = std::make_unique<RaftNode>(options_.raft, std::move(stateMachine));
+}
+
+ReplicatedRegistry::~ReplicatedRegistry() {
+    stop();
+}
+
+bool ReplicatedRegistry::start() {
+    registry_->setLeaseExpiryHandler([this](const std::string& serviceId, bool evict) {
+        return proposeLeaseExpiry(serviceId, evict);
+    });
+    return node_->start();
+}
+
+void ReplicatedRegistry::stop() {
+    node_->stop();
+    registry_->setLeaseExpiryHandler(nullptr);
+}
+
+bool ReplicatedRegistry::propose(std::string command, size_t records, Completion done) {
+    RaftNode::Callback callback;
+    if (done) {
+        callback = [records, done = std::move(done)](RaftNode::Outcome outcome, const std::string& result) {
+            std::vector<bool> applied(records, false);
+            for (size_t i = 0; i < records && i < result.size(); ++i) {
+                applied[i] = result[i] == '1';
+            }
+            done(outcome == RaftNode::Outcome::COMMITTED, applied);
+        };
+    }
+    return node_->propose(std::move(command), std::move(callback));
+}
+
+bool ReplicatedRegistry::submit(const std::vector<RegistryOperation>& operations, Completion done) {
+    if (operations.empty()) {
+        if (!node_->isLeader()) {
+            return false;
+        }
+        done(true, std::vector<bool>());
+        return true;
+    }
+
+    std::string command;
+    std::string record;
+    for (const auto& operation : operations) {
+        record.clear();
+        switch (operation.type) {
+            case RegistryOperation::Type::REGISTER:
+                if (operation.service) {
+                    encodeService(*operation.service, 0, record);
+                } else {
+                    encodeUnregister(std::string(), 0, record); // applies as not found
+                }
+                break;
+            case RegistryOperation::Type::UNREGISTER:
+                encodeUnregister(operation.serviceId, 0, record);
+                break;
+            case RegistryOperation::Type::HEARTBEAT:
+                encodeHeartbeat(operation.serviceId, record);
+                break;
+        }
+        appendRecord(record, command);
+    }
+    return propose(std::move(command), operations.size(), std::move(done));
+}
+
+bool ReplicatedRegistry::submitConfig(const nlohmann::json& sections, Completion done) {
+    std::string command;
+    std::string record;
+    for (const auto& [section, value] : sections.items()) {
+        record.clear();
+        encodeConfig(section, value, record);
+        appendRecord(record, command);
+    }
+    return propose(std::move(command), sections.size(), std::move(done));
+}
+
+bool ReplicatedRegistry::proposeStatus(const std::string& serviceId, ServiceStatus status) {
+    std::string record;
+    encodeStatus(serviceId, status, 0, record);
+    std::string command;
+    appendRecord(record, command);
+    return propose(std::move(command), 1, nullptr);
+}
+
+bool ReplicatedRegistry::proposeLeaseExpiry(const std::string& serviceId, bool evict) {
+    // Runs under the registry's write lock: only appends to the log
+    std::string record;
+    if (evict) {
+        encodeUnregister(serviceId, 0, record);
+    } else {
+        encodeStatus(serviceId, ServiceStatus::UNHEALTHY, 0, record);
+    }
+    std::string command;
+    appendRecord(record, command);
+    return propose(std::move(command), 1, nullptr);
+}
+
+std::string ReplicatedRegistry::apply(const std::string& command) {
+    std::string results;
+    std::vector<RegistryOperation> operations;
+    std::vector<size_t> positions;
+    auto flush = [&]() {
+        if (operations.empty()) {
+            return;
+        }
+        std::vector<bool> applied = registry_->apply(operations);
+        for (size_t i = 0; i < applied.size(); ++i) {
+            results[positions[i]] = applied[i] ? '1' : '0';
+        }
+        operations.clear();
+        positions.clear();
+    };
+
+    // One published registry snapshot per entry
+    ServiceRegistry::Batch batch(*registry_);
+    RecordReader reader(command.data(), command.size());
+    while (reader.ok() && !reader.complete()) {
+        std::string data = reader.getString();
+        RegistryRecord record;
+        if (!reader.ok() || !decodeRecord(data.data(), data.size(), record)) {
+            std::cerr << "Skipping malformed replicated record" << std::endl;
+            results.push_back('0');
+            continue;
+        }
+        results.push_back('0');
+        RegistryOperation operation{};
+        switch (record.type) {
+            case RecordType::REGISTER:
+                operation.type = RegistryOperation::Type::REGISTER;
+                operation.service = std::move(record.service);
+                break;
+            case RecordType::UNREGISTER:
+                operation.type = RegistryOperation::Type::UNREGISTER;
+                operation.serviceId = std::move(record.id);
+                break;
+            case RecordType::HEARTBEAT:
+                operation.type = RegistryOperation::Type::HEARTBEAT;
+                operation.serviceId = std::move(record.id);
+                break;
+            case RecordType::STATUS:
+                flush();
+                results.back() = registry_->updateServiceStatus(record.id, record.status) ? '1' : '0';
+                continue;
+            case RecordType::CONFIG: {
+                flush();
+                std::lock_guard<std::mutex> lock(configMutex_);
+                if (record.value.is_null()) {
+                    config_->remove(record.section);
+                    configOverrides_.erase(record.section);
+                } else {
+                    config_->setSection(record.section, record.value);
+                    configOverrides_[record.section] = record.value;
+                }
+                results.back() = '1';
+                continue;
+            }
+        }
+        positions.push_back(results.size() - 1);
+        operations.push_back(std::move(operation));
+    }
+    flush();
+    return results;
+}
+
+bool ReplicatedRegistry::saveSnapshot(const std::string& path, uint64_t index, uint64_t term) {
+    auto snapshot = registry_->snapshot();
+    std::vector<std::shared_ptr<Service>> services;
+    services.reserve(snapshot->size());
+    snapshot->forEach([&](const std::shared_ptr<Service>& service) { services.push_back(service); });
+
+    nlohmann::json blob;
+    blob["raft"] = {{"index", index}, {"term", term}};
+    {
+        std::lock_guard<std::mutex> lock(configMutex_);
+        blob["config"] = configOverrides_;
+    }
+
+    std::string error;
+    if (!SnapshotFile::write(path, services, snapshot->version(), 0, blob.dump(), error)) {
+        std::cerr << "Failed to write snapshot " << path << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReplicatedRegistry::loadSnapshot(const std::string& path, uint64_t& index, uint64_t& term) {
+    SnapshotFile file;
+    std::string error;
+    if (!file.open(path, error)) {
+        std::cerr << "Failed to open snapshot " << path << ": " << error << std::endl;
+        return false;
+    }
+    nlohmann::json blob = nlohmann::json::parse(file.config(), nullptr, false);
+    if (!blob.is_object() || !blob.contains("raft") || !blob.contains("config") || !blob["config"].is_object()) {
+        std::cerr << "Snapshot " << path << " was not written by a cluster member" << std::endl;
+        return false;
+    }
+    index = blob["raft"].value("index", uint64_t(0));
+    term = blob["raft"].value("term", uint64_t(0));
+
+    // Replaces the whole state: instances missing from the snapshot go
+    auto services = file.services();
+    {
+        ServiceRegistry::Batch batch(*registry_);
+        std::unordered_set<std::string> kept;
+        kept.reserve(services.size());
+        for (const auto& service : services) {
+            kept.insert(service->id);
+        }
+        for (const auto& service : registry_->getAllServices()) {
+            if (kept.find(service->id) == kept.end()) {
+                registry_->unregisterService(service->id);
+            }
+        }
+        for (auto& service : services) {
+            registry_->registerService(std::move(service));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(configMutex_);
+    const nlohmann::json& overrides = blob["config"];
+    for (const auto& [section, value] : configOverrides_) {
+        if (!overrides.contains(section)) {
+            config_->remove(section);
+        }
+    }
+    configOverrides_.clear();
+    for (const auto& [section, value] : overrides.items()) {
+        config_->setSection(section, value);
+        configOverrides_[section] = value;
+    }
+    return true;
+}
+
+nlohmann::json ReplicatedRegistry::status() const {
+    RaftNode::Status status = node_->status();
+    nlohmann::json result;
+    result["id"] = status.id;
+    result["role"] = RaftNode::toString(status.role);
+    result["term"] = status.term;
+    result["leader"] = status.leader;
+    result["leaderAddress"] = node_->leaderAddress();
+    result["firstIndex"] = status.firstIndex;
+    result["lastIndex"] = status.lastIndex;
+    result["commitIndex"] = status.commitIndex;
+    result["lastApplied"] = status.lastApplied;
+    result["snapshotIndex"] = status.snapshotIndex;
+    result["snapshots"] = status.snapshots;
+    result["readable"] = readable();
+    result["maxStalenessMs"] = options_.maxStaleness.count();
+    nlohmann::json peers = nlohmann::json::array();
+    for (const auto& peer : status.peers) {
+        nlohmann::json entry;
+        entry["id"] = peer.id;
+        entry["address"] = options_.raft.members.at(peer.id);
+        if (status.role == RaftNode::Role::LEADER) {
+            entry["matchIndex"] = peer.matchIndex;
+            entry["nextIndex"] = peer.nextIndex;
+            entry["lastAckMs"] = peer.lastAckMs;
+        }
+        peers.push_back(std::move(entry));
+    }
+    result["peers"] = std::move(peers);
+    return result;
+}
+
+} // namespace dcp
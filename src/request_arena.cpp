@@ -0,0 +1,67 @@
+#include "request_arena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dcp {
+
+namespace {
+
+thread_local RequestArena* currentArena = nullptr;
+
+} // namespace
+
+RequestArena::RequestArena(size_t blockSize)
+    : blockSize_(std::max<size_t>(blockSize, 64)), offset_(0), used_(0) {}
+
+void* RequestArena::allocate(size_t size, size_t alignment) {
+    if (!blocks_.empty()) {
+        size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (start + size <= blocks_.back().size) {
+            offset_ = start + size;
+            used_ += size;
+            return blocks_.back().data.get() + start;
+        }
+    }
+
+    // operator new[] memory is aligned for any fundamental type
+    size_t blockSize = std::max(blockSize_, size);
+    blocks_.push_back({std::unique_ptr<char[]>(new char[blockSize]), blockSize});
+    offset_ = size;
+    used_ += size;
+    return blocks_.back().data.get();
+}
+
+std::string_view RequestArena::copy(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* data = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+void RequestArena::reset() {
+    // Keep one regular block; anything past it was for an unusually large request
+    if (!blocks_.empty() && blocks_.front().size != blockSize_) {
+        blocks_.clear();
+    }
+    if (blocks_.size() > 1) {
+        blocks_.resize(1);
+    }
+    offset_ = 0;
+    used_ = 0;
+}
+
+RequestArena* RequestArena::current() {
+    return currentArena;
+}
+
+RequestArena::Scope::Scope(RequestArena& arena) : previous_(currentArena) {
+    currentArena = &arena;
+}
+
+RequestArena::Scope::~Scope() {
+    currentArena = previous_;
+}
+
+} // namespace dcp
@@ -0,0 +1,175 @@
+#include "router.h"
+#include <stdexcept>
+
+namespace dcp {
+
+Router::Node* Router::rootFor(const std::string& method) {
+    for (auto& tree : trees_) {
+        if (tree.method == method) {
+            return tree.root.get();
+        }
+    }
+    trees_.push_back({method, std::make_unique<Node>()});
+    return trees_.back().root.get();
+}
+
+Router::Node* Router::insertStatic(Node* node, std::string_view text) {
+    while (!text.empty()) {
+        std::unique_ptr<Node>* edge = nullptr;
+        for (auto& child : node->children) {
+            if (child->prefix[0] == text[0]) {
+                edge = &child;
+                break;
+            }
+        }
+
+        if (!edge) {
+            auto child = std::make_unique<Node>();
+            child->prefix = std::string(text);
+            node->children.push_back(std::move(child));
+            return node->children.back().get();
+        }
+
+        Node* child = edge->get();
+        size_t common = 0;
+        while (common < child->prefix.size() && common < text.size() &&
+               child->prefix[common] == text[common]) {
+            ++common;
+        }
+
+        if (common < child->prefix.size()) {
+            // Split the edge: the shared part becomes a new parent
+            auto parent = std::make_unique<Node>();
+            parent->prefix = child->prefix.substr(0, common);
+            (*edge)->prefix.erase(0, common);
+            parent->children.push_back(std::move(*edge));
+            *edge = std::move(parent);
+            child = edge->get();
+        }
+
+        node = child;
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+Route& Router::add(const std::string& method, const std::string& pattern, HttpHandler handler,
+                   RoutePolicy policy) {
+    if (pattern.empty() || pattern[0] != '/') {
+        throw std::invalid_argument("Route pattern must start with '/': " + pattern);
+    }
+
+    Node* node = rootFor(method);
+    size_t params = 0;
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        char c = pattern[pos];
+        bool segmentStart = pos > 0 && pattern[pos - 1] == '/';
+
+        if (segmentStart && c == ':') {
+            size_t end = pattern.find('/', pos);
+            std::string name = pattern.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+            if (name.empty() || ++params > RouteMatch::kMaxParams) {
+                throw std::invalid_argument("Invalid route parameter in: " + pattern);
+            }
+            if (!node->paramChild) {
+                node->paramChild = std::make_unique<Node>();
+                node->paramName = name;
+            } else if (node->paramName != name) {
+                throw std::invalid_argument("Conflicting parameter name ':" + name + "' in: " + pattern);
+            }
+            node = node->paramChild.get();
+            pos = end == std::string::npos ? pattern.size() : end;
+        } else if (segmentStart && c == '*') {
+            std::string name = pattern.size() > pos + 1 ? pattern.substr(pos + 1) : "*";
+            if (name.find('/') != std::string::npos || ++params > RouteMatch::kMaxParams) {
+                throw std::invalid_argument("Wildcard must be the last segment in: " + pattern);
+            }
+            if (!node->wildcardChild) {
+                node->wildcardChild = std::make_unique<Node>();
+            }
+            node->wildcardName = name;
+            node = node->wildcardChild.get();
+            pos = pattern.size();
+        } else {
+            // Static run up to the next parameter or wildcard segment
+            size_t end = pos + 1;
+            while (end < pattern.size() &&
+                   !(pattern[end - 1] == '/' && (pattern[end] == ':' || pattern[end] == '*'))) {
+                ++end;
+            }
+            node = insertStatic(node, std::string_view(pattern).substr(pos, end - pos));
+            pos = end;
+        }
+    }
+
+    if (!node->route) {
+        auto route = std::make_unique<Route>();
+        route->method = method;
+        route->pattern = pattern;
+        node->route = route.get();
+        routes_.push_back(std::move(route));
+    }
+    node->route->handler = std::move(handler);
+    node->route->deferredHandler = nullptr;
+    node->route->policy = policy;
+    return *node->route;
+}
+
+bool Router::find(std::string_view method, std::string_view path, RouteMatch& result) const {
+    result.route = nullptr;
+    result.paramCount = 0;
+
+    for (const auto& tree : trees_) {
+        if (tree.method == method) {
+            return match(tree.root.get(), path, result);
+        }
+    }
+    return false;
+}
+
+bool Router::match(const Node* node, std::string_view path, RouteMatch& result) {
+    if (path.empty() && node->route) {
+        result.route = node->route;
+        return true;
+    }
+
+    if (!path.empty()) {
+        for (const auto& child : node->children) {
+            if (child->prefix[0] != path[0]) {
+                continue;
+            }
+            if (path.compare(0, child->prefix.size(), child->prefix) == 0 &&
+                match(child.get(), path.substr(child->prefix.size()), result)) {
+                return true;
+            }
+            break; // First bytes are unique among static edges
+        }
+    }
+
+    if (node->paramChild && !path.empty() && path[0] != '/') {
+        size_t end = path.find('/');
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        size_t index = result.paramCount++;
+        result.paramNames[index] = node->paramName;
+        result.paramValues[index] = path.substr(0, end);
+        if (match(node->paramChild.get(), path.substr(end), result)) {
+            return true;
+        }
+        result.paramCount = index; // Backtrack
+    }
+
+    if (node->wildcardChild && node->wildcardChild->route) {
+        size_t index = result.paramCount++;
+        result.paramNames[index] = node->wildcardName;
+        result.paramValues[index] = path;
+        result.route = node->wildcardChild->route;
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace dcp
@@ -0,0 +1,176 @@
+#include "service_json.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace dcp {
+
+namespace {
+
+// Field names in the order nlohmann::json writes them (sorted)
+const std::pair<const char*, uint32_t> kFieldNames[] = {
+    {"host", ServiceFields::HOST},
+    {"id", ServiceFields::ID},
+    {"lastHeartbeat", ServiceFields::LAST_HEARTBEAT},
+    {"metadata", ServiceFields::METADATA},
+    {"name", ServiceFields::NAME},
+    {"port", ServiceFields::PORT},
+    {"status", ServiceFields::STATUS},
+    {"ttlMs", ServiceFields::TTL_MS},
+};
+
+// Escapes like nlohmann::json::dump(), which leaves UTF-8 as it is
+void appendString(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out.append(escaped);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+} // namespace
+
+nlohmann::json serviceToJson(const Service& service) {
+    nlohmann::json serviceJson;
+    serviceJson["id"] = service.id;
+    serviceJson["name"] = service.name.str();
+    serviceJson["host"] = service.host.str();
+    serviceJson["port"] = service.port;
+    serviceJson["status"] = toString(service.status);
+    serviceJson["ttlMs"] = service.ttlMs;
+    
+    nlohmann::json metadata = nlohmann::json::object();
+    for (const auto& [key, value] : *service.metadata) {
+        metadata[key.str()] = value;
+    }
+    serviceJson["metadata"] = metadata;
+    
+    auto time_t = std::chrono::system_clock::to_time_t(service.lastHeartbeat);
+    serviceJson["lastHeartbeat"] = time_t;
+    return serviceJson;
+}
+
+bool parseServiceFields(std::string_view list, uint32_t& fields, std::string& unknown) {
+    fields = 0;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view name = list.substr(0, comma);
+        bool known = false;
+        for (const auto& [fieldName, bit] : kFieldNames) {
+            if (name == fieldName) {
+                fields |= bit;
+                known = true;
+            }
+        }
+        if (!known) {
+            unknown = std::string(name);
+            return false;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return true;
+}
+
+void appendServiceJson(const Service& service, uint32_t fields, std::string& out) {
+    out.push_back('{');
+    bool first = true;
+    for (const auto& [name, bit] : kFieldNames) {
+        if (!(fields & bit)) {
+            continue;
+        }
+        if (!first) {
+            out.push_back(',');
+        }
+        first = false;
+        out.push_back('"');
+        out.append(name);
+        out.append("\":");
+        switch (bit) {
+            case ServiceFields::HOST: appendString(out, service.host.str()); break;
+            case ServiceFields::ID: appendString(out, service.id); break;
+            case ServiceFields::LAST_HEARTBEAT:
+                out.append(std::to_string(std::chrono::system_clock::to_time_t(service.lastHeartbeat)));
+                break;
+            case ServiceFields::METADATA: {
+                out.push_back('{');
+                bool firstEntry = true;
+                for (const auto& [key, value] : *service.metadata) {
+                    if (!firstEntry) {
+                        out.push_back(',');
+                    }
+                    firstEntry = false;
+                    appendString(out, key.str());
+                    out.push_back(':');
+                    appendString(out, value);
+                }
+                out.push_back('}');
+                break;
+            }
+            case ServiceFields::NAME: appendString(out, service.name.str()); break;
+            case ServiceFields::PORT: out.append(std::to_string(service.port)); break;
+            case ServiceFields::STATUS: appendString(out, toString(service.status)); break;
+            case ServiceFields::TTL_MS: out.append(std::to_string(service.ttlMs)); break;
+        }
+    }
+    out.push_back('}');
+}
+
+std::shared_ptr<Service> serviceFromJson(const nlohmann::json& json, std::string& error) {
+    std::string id = json.value("id", "");
+    std::string name = json.value("name", "");
+    std::string host = json.value("host", "localhost");
+    int port = json.value("port", 0);
+    int64_t ttlMs = json.value("ttl_ms", int64_t(0));
+    
+    if (id.empty() || name.empty() || port <= 0) {
+        error = "Missing required fields: id, name, port";
+        return nullptr;
+    }
+    if (port > 65535) {
+        error = "Invalid port";
+        return nullptr;
+    }
+    if (ttlMs < 0 || ttlMs > UINT32_MAX) {
+        error = "Invalid ttl_ms";
+        return nullptr;
+    }
+    
+    auto service = std::make_shared<Service>(id, name, host, port);
+    if (ttlMs > 0) {
+        // Registering counts as the first heartbeat of the lease
+        service->ttlMs = static_cast<uint32_t>(ttlMs);
+        service->status = ServiceStatus::HEALTHY;
+    }
+    
+    if (json.contains("metadata")) {
+        std::vector<std::pair<std::string, std::string>> metadata;
+        for (auto& [key, value] : json["metadata"].items()) {
+            metadata.emplace_back(key, value.get<std::string>());
+        }
+        service->metadata = ServiceMetadata::make(std::move(metadata));
+    }
+    return service;
+}
+
+} // namespace dcp
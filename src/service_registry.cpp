@@ -4,89 +4,688 @@
 
 namespace dcp {
 
+namespace {
+
+std::atomic<uint64_t> nextRegistryId{1};
+
+const RegistrySnapshot::ServiceList& emptyList() {
+    static const RegistrySnapshot::ServiceList empty;
+    return empty;
+}
+
+// Per-thread copy of the snapshot the thread last read
+struct SnapshotCache {
+    uint64_t registryId = 0;
+    std::shared_ptr<const RegistrySnapshot> snapshot;
+};
+
+thread_local SnapshotCache snapshotCache;
+
+constexpr std::chrono::milliseconds kLeaseTick(100);
+
+const std::vector<ServiceEndpoint>& emptyEndpoints() {
+    static const std::vector<ServiceEndpoint> empty;
+    return empty;
+}
+
+ServiceEndpoint endpointOf(const Service& service) {
+    return {&service, service.address, service.port, service.status, service.ttlMs};
+}
+
+// Deduplicates metadata sets; entries die with the last record using them
+struct MetadataPool {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<const ServiceMetadata>> sets;
+    size_t pruneAt = 64;
+};
+
+MetadataPool& metadataPool() {
+    static MetadataPool* pool = new MetadataPool(); // outlives static destructors
+    return *pool;
+}
+
+size_t hashMetadata(const ServiceMetadata& metadata) {
+    size_t hash = metadata.size();
+    for (const auto& [key, value] : metadata) {
+        hash = hash * 31 + std::hash<InternedString>()(key);
+        hash = hash * 31 + std::hash<std::string>()(value);
+    }
+    return hash;
+}
+
+bool sameMetadata(const ServiceMetadata& a, const ServiceMetadata& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+} // namespace
+
+const char* toString(ServiceStatus status) {
+    switch (status) {
+        case ServiceStatus::HEALTHY:
+            return "healthy";
+        case ServiceStatus::UNHEALTHY:
+            return "unhealthy";
+        default:
+            return "unknown";
+    }
+}
+
+ServiceStatus parseServiceStatus(const std::string& text) {
+    if (text == "healthy") {
+        return ServiceStatus::HEALTHY;
+    }
+    if (text == "unhealthy") {
+        return ServiceStatus::UNHEALTHY;
+    }
+    return ServiceStatus::UNKNOWN;
+}
+
+const char* toString(RegistryEvent::Type type) {
+    switch (type) {
+        case RegistryEvent::Type::REGISTERED:
+            return "registered";
+        case RegistryEvent::Type::UNREGISTERED:
+            return "unregistered";
+        default:
+            return "status_changed";
+    }
+}
+
+std::shared_ptr<const ServiceMetadata> ServiceMetadata::make(std::vector<std::pair<std::string, std::string>> entries) {
+    if (entries.empty()) {
+        return empty();
+    }
+    
+    // Sort by key, keeping only the last value given for each
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    auto metadata = std::make_shared<ServiceMetadata>();
+    metadata->entries_.reserve(entries.size());
+    for (auto& [key, value] : entries) {
+        if (!metadata->entries_.empty() && metadata->entries_.back().first == key) {
+            metadata->entries_.back().second = std::move(value);
+        } else {
+            metadata->entries_.emplace_back(InternedString(key), std::move(value));
+        }
+    }
+    metadata->entries_.shrink_to_fit();
+    
+    MetadataPool& pool = metadataPool();
+    size_t hash = hashMetadata(*metadata);
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto range = pool.sets.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto existing = it->second.lock();
+        if (existing && sameMetadata(*existing, *metadata)) {
+            return existing;
+        }
+    }
+    if (pool.sets.size() >= pool.pruneAt) {
+        for (auto it = pool.sets.begin(); it != pool.sets.end();) {
+            it = it->second.expired() ? pool.sets.erase(it) : std::next(it);
+        }
+        pool.pruneAt = std::max<size_t>(64, pool.sets.size() * 2);
+    }
+    pool.sets.emplace(hash, metadata);
+    return metadata;
+}
+
+std::shared_ptr<const ServiceMetadata> ServiceMetadata::empty() {
+    static const std::shared_ptr<const ServiceMetadata> none = std::make_shared<ServiceMetadata>();
+    return none;
+}
+
+const std::string* ServiceMetadata::find(const std::string& key) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key,
+                               [](const Entry& entry, const std::string& k) { return entry.first.str() < k; });
+    return it != entries_.end() && it->first == key ? &it->second : nullptr;
+}
+
+RegistrySnapshot::RegistrySnapshot()
+    : version_(0), size_(0) {
+    for (size_t i = 0; i < kShards; ++i) {
+        ids_[i] = std::make_shared<IdShard>();
+        names_[i] = std::make_shared<NameMap>();
+    }
+}
+
+size_t RegistrySnapshot::shardFor(const std::string& key) {
+    return std::hash<std::string>()(key) % kShards;
+}
+
+std::shared_ptr<Service> RegistrySnapshot::find(const std::string& id) const {
+    const IdShard& shard = *ids_[shardFor(id)];
+    auto it = shard.find(id);
+    return it != shard.end() ? it->second : nullptr;
+}
+
+const RegistrySnapshot::ServiceList& RegistrySnapshot::servicesByName(const std::string& name) const {
+    const NameMap& names = *names_[shardFor(name)];
+    auto it = names.find(name);
+    return it != names.end() ? it->second->all : emptyList();
+}
+
+const RegistrySnapshot::ServiceList& RegistrySnapshot::healthyServices(const std::string& name) const {
+    const NameMap& names = *names_[shardFor(name)];
+    auto it = names.find(name);
+    return it != names.end() ? it->second->healthy : emptyList();
+}
+
+const std::vector<ServiceEndpoint>& RegistrySnapshot::endpoints(const std::string& name) const {
+    const NameMap& names = *names_[shardFor(name)];
+    auto it = names.find(name);
+    return it != names.end() ? it->second->endpoints : emptyEndpoints();
+}
+
+ServiceRegistry::Batch::Batch(ServiceRegistry& registry) : registry_(registry) {
+    auto lock = registry_.lockForWrite();
+    if (registry_.batchDepth_++ == 0) {
+        registry_.batchOwner_ = std::this_thread::get_id();
+    }
+}
+
+ServiceRegistry::Batch::~Batch() {
+    std::unique_lock<std::mutex> lock(registry_.writeMutex_);
+    if (--registry_.batchDepth_ > 0) {
+        return;
+    }
+    registry_.batchOwner_ = std::thread::id();
+    registry_.commit();
+    lock.unlock();
+    registry_.batchEnded_.notify_all();
+}
+
+ServiceRegistry::ServiceRegistry(size_t changeLogCapacity)
+    : published_(std::make_shared<RegistrySnapshot>()), publishedVersion_(0),
+      registryId_(nextRegistryId.fetch_add(1)), idsCopied_{}, namesCopied_{}, batchDepth_(0),
+      leaseWheel_(kLeaseTick), leaseEvictAfter_(0),
+      changeLogCapacity_(std::max<size_t>(changeLogCapacity, 1)), trimmedRevision_(0) {}
+
+std::shared_ptr<const RegistrySnapshot> ServiceRegistry::snapshot() const {
+    // Fast path: one atomic load, no shared writes beyond the returned reference
+    SnapshotCache& cache = snapshotCache;
+    uint64_t version = publishedVersion_.load(std::memory_order_acquire);
+    if (cache.registryId != registryId_ || !cache.snapshot || cache.snapshot->version() != version) {
+        cache.snapshot = std::atomic_load(&published_);
+        cache.registryId = registryId_;
+    }
+    return cache.snapshot;
+}
+
+std::unique_lock<std::mutex> ServiceRegistry::lockForWrite() {
+    // Another thread's batch would hold this write back from publishing (and
+    // the journal) until it ends, after the caller has already answered
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    batchEnded_.wait(lock, [this] { return batchDepth_ == 0 || batchOwner_ == std::this_thread::get_id(); });
+    return lock;
+}
+
+RegistrySnapshot& ServiceRegistry::draft() {
+    if (!draft_) {
+        // Starts out sharing everything with the published snapshot
+        draft_ = std::make_shared<RegistrySnapshot>(*std::atomic_load(&published_));
+        std::fill(std::begin(idsCopied_), std::end(idsCopied_), false);
+        std::fill(std::begin(namesCopied_), std::end(namesCopied_), false);
+        namesTouched_.clear();
+    }
+    return *draft_;
+}
+
+RegistrySnapshot::IdShard& ServiceRegistry::mutableShard(const std::string& id) {
+    RegistrySnapshot& next = draft();
+    size_t index = RegistrySnapshot::shardFor(id);
+    if (!idsCopied_[index]) {
+        next.ids_[index] = std::make_shared<RegistrySnapshot::IdShard>(*next.ids_[index]);
+        idsCopied_[index] = true;
+    }
+    return *next.ids_[index];
+}
+
+RegistrySnapshot::NameIndex& ServiceRegistry::mutableName(const std::string& name) {
+    RegistrySnapshot& next = draft();
+    size_t shard = RegistrySnapshot::shardFor(name);
+    if (!namesCopied_[shard]) {
+        next.names_[shard] = std::make_shared<RegistrySnapshot::NameMap>(*next.names_[shard]);
+        namesCopied_[shard] = true;
+    }
+    auto& index = (*next.names_[shard])[name];
+    if (namesTouched_.insert(name).second) {
+        index = index ? std::make_shared<RegistrySnapshot::NameIndex>(*index)
+                      : std::make_shared<RegistrySnapshot::NameIndex>();
+    }
+    return *index;
+}
+
+void ServiceRegistry::addToName(const std::shared_ptr<Service>& service) {
+    RegistrySnapshot::NameIndex& index = mutableName(service->name);
+    if (index.freeSlots.empty()) {
+        service->nameSlot = static_cast<uint32_t>(index.slots.size());
+        index.slots.emplace_back();
+    } else {
+        service->nameSlot = index.freeSlots.back();
+        index.freeSlots.pop_back();
+    }
+    auto& position = index.slots[service->nameSlot];
+    position.all = static_cast<uint32_t>(index.all.size());
+    position.healthy = RegistrySnapshot::NameIndex::kNotHealthy;
+    index.all.push_back(service);
+    index.endpoints.push_back(endpointOf(*service));
+    if (service->status == ServiceStatus::HEALTHY) {
+        position.healthy = static_cast<uint32_t>(index.healthy.size());
+        index.healthy.push_back(service);
+    }
+}
+
+void ServiceRegistry::removeFromName(const std::shared_ptr<Service>& service) {
+    RegistrySnapshot::NameIndex& index = mutableName(service->name);
+    RegistrySnapshot::NameIndex::Position position = index.slots[service->nameSlot];
+    removeFromAll(index, position.all);
+    if (position.healthy != RegistrySnapshot::NameIndex::kNotHealthy) {
+        removeFromHealthy(index, position.healthy);
+    }
+    index.freeSlots.push_back(service->nameSlot);
+    if (index.all.empty()) {
+        draft_->names_[RegistrySnapshot::shardFor(service->name)]->erase(service->name);
+        namesTouched_.erase(service->name);
+    }
+}
+
+void ServiceRegistry::replaceService(const std::shared_ptr<Service>& current,
+                                     const std::shared_ptr<Service>& updated) {
+    mutableShard(updated->id)[updated->id] = updated;
+    
+    RegistrySnapshot::NameIndex& index = mutableName(updated->name);
+    // `updated` is a copy of `current`, so it keeps the same slot
+    auto& position = index.slots[current->nameSlot];
+    index.all[position.all] = updated;
+    index.endpoints[position.all] = endpointOf(*updated);
+    bool healthy = updated->status == ServiceStatus::HEALTHY;
+    if (position.healthy != RegistrySnapshot::NameIndex::kNotHealthy) {
+        if (healthy) {
+            index.healthy[position.healthy] = updated;
+        } else {
+            removeFromHealthy(index, position.healthy);
+            position.healthy = RegistrySnapshot::NameIndex::kNotHealthy;
+        }
+    } else if (healthy) {
+        position.healthy = static_cast<uint32_t>(index.healthy.size());
+        index.healthy.push_back(updated);
+    }
+}
+
+void ServiceRegistry::removeFromAll(RegistrySnapshot::NameIndex& index, uint32_t position) {
+    // Swap-pop both arrays so they stay in the same order
+    if (position + 1 != index.all.size()) {
+        index.all[position] = std::move(index.all.back());
+        index.endpoints[position] = index.endpoints.back();
+        index.slots[index.all[position]->nameSlot].all = position;
+    }
+    index.all.pop_back();
+    index.endpoints.pop_back();
+}
+
+void ServiceRegistry::removeFromHealthy(RegistrySnapshot::NameIndex& index, uint32_t position) {
+    if (position + 1 != index.healthy.size()) {
+        index.healthy[position] = std::move(index.healthy.back());
+        index.slots[index.healthy[position]->nameSlot].healthy = position;
+    }
+    index.healthy.pop_back();
+}
+
+std::shared_ptr<Service> ServiceRegistry::currentService(const std::string& serviceId) const {
+    const RegistrySnapshot& latest = draft_ ? *draft_ : *published_;
+    return latest.find(serviceId);
+}
+
+void ServiceRegistry::commit() {
+    if (batchDepth_ == 0) {
+        publish();
+    }
+}
+
+void ServiceRegistry::logEvent(RegistryEvent::Type type, const std::shared_ptr<Service>& service) {
+    pendingEvents_.push_back({0, type, service});
+}
+
+void ServiceRegistry::armLease(const std::string& serviceId, std::chrono::milliseconds after, bool expired) {
+    auto& lease = leases_[serviceId];
+    if (!lease) {
+        lease = std::make_unique<Lease>();
+        lease->serviceId = serviceId;
+        lease->timer.context = lease.get();
+    }
+    lease->expired = expired;
+    leaseWheel_.schedule(lease->timer, std::chrono::steady_clock::now() + after);
+}
+
+void ServiceRegistry::dropLease(const std::string& serviceId) {
+    auto it = leases_.find(serviceId);
+    if (it != leases_.end()) {
+        leaseWheel_.cancel(it->second->timer);
+        leases_.erase(it);
+    }
+}
+
+void ServiceRegistry::removeService(const std::shared_ptr<Service>& service) {
+    mutableShard(service->id).erase(service->id);
+    --draft_->size_;
+    removeFromName(service);
+    dropLease(service->id);
+    logEvent(RegistryEvent::Type::UNREGISTERED, service);
+}
+
+void ServiceRegistry::publish() {
+    if (!draft_) {
+        return;
+    }
+    uint64_t revision = publishedVersion_.load(std::memory_order_relaxed) + 1;
+    draft_->version_ = revision;
+    std::shared_ptr<const RegistrySnapshot> next = std::move(draft_);
+    std::atomic_store(&published_, next);
+    publishedVersion_.store(revision, std::memory_order_release);
+    
+    // Logged after publishing, so the log never runs ahead of the snapshots
+    if (pendingEvents_.empty()) {
+        return;
+    }
+    for (auto& event : pendingEvents_) {
+        event.revision = revision;
+    }
+    if (journal_) {
+        journal_(pendingEvents_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        for (auto& event : pendingEvents_) {
+            changeLog_.push_back(std::move(event));
+        }
+        while (changeLog_.size() > changeLogCapacity_) {
+            trimmedRevision_ = changeLog_.front().revision;
+            changeLog_.pop_front();
+        }
+    }
+    pendingEvents_.clear();
+    if (changeListener_) {
+        changeListener_(revision);
+    }
+}
+
+bool ServiceRegistry::changesSince(uint64_t revision, std::vector<RegistryEvent>& events) const {
+    if (revision > version()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(logMutex_);
+    if (revision < trimmedRevision_) {
+        return false;
+    }
+    
+    // Revisions only grow along the log
+    auto first = std::upper_bound(changeLog_.begin(), changeLog_.end(), revision,
+                                  [](uint64_t r, const RegistryEvent& event) { return r < event.revision; });
+    events.insert(events.end(), first, changeLog_.end());
+    return true;
+}
+
+uint64_t ServiceRegistry::latestChangeRevision() const {
+    std::lock_guard<std::mutex> lock(logMutex_);
+    return changeLog_.empty() ? trimmedRevision_ : changeLog_.back().revision;
+}
+
+void ServiceRegistry::setChangeListener(std::function<void(uint64_t revision)> listener) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    changeListener_ = std::move(listener);
+}
+
+void ServiceRegistry::setJournal(std::function<void(const std::vector<RegistryEvent>& events)> journal) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    journal_ = std::move(journal);
+}
+
+void ServiceRegistry::restoreRevision(uint64_t revision) {
+    auto lock = lockForWrite();
+    
+    publish();
+    if (revision > publishedVersion_.load(std::memory_order_relaxed)) {
+        draft();
+        publishedVersion_.store(revision - 1, std::memory_order_relaxed);
+        publish();
+    }
+    std::lock_guard<std::mutex> logLock(logMutex_);
+    changeLog_.clear();
+    trimmedRevision_ = publishedVersion_.load(std::memory_order_relaxed);
+}
+
+void ServiceRegistry::addService(const std::shared_ptr<Service>& service) {
+    RegistrySnapshot::IdShard& shard = mutableShard(service->id);
+    auto it = shard.find(service->id);
+    if (it != shard.end()) {
+        removeFromName(it->second); // Re-registration may change the name or status
+        it->second = service;
+    } else {
+        shard.emplace(service->id, service);
+        ++draft_->size_;
+    }
+    addToName(service);
+    if (service->ttlMs > 0) {
+        armLease(service->id, std::chrono::milliseconds(service->ttlMs), false);
+    } else {
+        dropLease(service->id);
+    }
+    logEvent(RegistryEvent::Type::REGISTERED, service);
+}
+
 bool ServiceRegistry::registerService(const std::shared_ptr<Service>& service) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto lock = lockForWrite();
     
     if (!service) return false;
     
-    services_[service->id] = service;
+    addService(service);
+    commit();
     return true;
 }
 
-bool ServiceRegistry::unregisterService(const std::string& serviceId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::vector<bool> ServiceRegistry::apply(const std::vector<RegistryOperation>& operations) {
+    auto lock = lockForWrite();
     
-    auto it = services_.find(serviceId);
-    if (it != services_.end()) {
-        services_.erase(it);
-        return true;
+    std::vector<bool> results;
+    results.reserve(operations.size());
+    for (const auto& operation : operations) {
+        bool found = false;
+        switch (operation.type) {
+            case RegistryOperation::Type::REGISTER:
+                if (operation.service) {
+                    addService(operation.service);
+                    found = true;
+                }
+                break;
+            case RegistryOperation::Type::UNREGISTER:
+                if (auto service = currentService(operation.serviceId)) {
+                    removeService(service);
+                    found = true;
+                }
+                break;
+            case RegistryOperation::Type::HEARTBEAT:
+                found = renew(operation.serviceId);
+                break;
+        }
+        results.push_back(found);
+    }
+    
+    // Plain renewals alone wait in the draft, as with renewLease()
+    if (!pendingEvents_.empty()) {
+        commit();
     }
-    return false;
+    return results;
 }
 
-std::shared_ptr<Service> ServiceRegistry::getService(const std::string& serviceId) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool ServiceRegistry::unregisterService(const std::string& serviceId) {
+    auto lock = lockForWrite();
     
-    auto it = services_.find(serviceId);
-    if (it != services_.end()) {
-        return it->second;
+    auto service = currentService(serviceId);
+    if (!service) {
+        return false;
     }
-    return nullptr;
+    removeService(service);
+    commit();
+    return true;
+}
+
+std::shared_ptr<Service> ServiceRegistry::getService(const std::string& serviceId) const {
+    return snapshot()->find(serviceId);
 }
 
 std::vector<std::shared_ptr<Service>> ServiceRegistry::getServicesByName(const std::string& name) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::vector<std::shared_ptr<Service>> result;
-    for (const auto& [id, service] : services_) {
-        if (service->name == name) {
-            result.push_back(service);
-        }
-    }
-    return result;
+    return snapshot()->servicesByName(name);
 }
 
 std::vector<std::shared_ptr<Service>> ServiceRegistry::getAllServices() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto current = snapshot();
     
     std::vector<std::shared_ptr<Service>> result;
-    result.reserve(services_.size());
-    for (const auto& [id, service] : services_) {
+    result.reserve(current->size());
+    current->forEach([&result](const std::shared_ptr<Service>& service) {
         result.push_back(service);
-    }
+    });
     return result;
 }
 
-bool ServiceRegistry::updateServiceStatus(const std::string& serviceId, const std::string& status) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool ServiceRegistry::updateServiceStatus(const std::string& serviceId, ServiceStatus status) {
+    auto lock = lockForWrite();
     
-    auto it = services_.find(serviceId);
-    if (it != services_.end()) {
-        it->second->status = status;
-        return true;
+    auto current = currentService(serviceId);
+    if (!current) {
+        return false;
     }
-    return false;
+    if (current->status != status) {
+        auto updated = std::make_shared<Service>(*current);
+        updated->status = status;
+        replaceService(current, updated);
+        logEvent(RegistryEvent::Type::STATUS_CHANGED, updated);
+        commit();
+    }
+    return true;
 }
 
 void ServiceRegistry::updateHeartbeat(const std::string& serviceId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto lock = lockForWrite();
     
-    auto it = services_.find(serviceId);
-    if (it != services_.end()) {
-        it->second->lastHeartbeat = std::chrono::system_clock::now();
+    auto current = currentService(serviceId);
+    if (current) {
+        auto updated = std::make_shared<Service>(*current);
+        updated->lastHeartbeat = std::chrono::system_clock::now();
+        replaceService(current, updated);
+        commit();
     }
 }
 
 std::vector<std::shared_ptr<Service>> ServiceRegistry::getHealthyServices(const std::string& name) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshot()->healthyServices(name);
+}
+
+bool ServiceRegistry::renew(const std::string& serviceId) {
+    auto current = currentService(serviceId);
+    if (!current) {
+        return false;
+    }
+    auto updated = std::make_shared<Service>(*current);
+    updated->lastHeartbeat = std::chrono::system_clock::now();
+    bool revived = current->ttlMs > 0 && current->status != ServiceStatus::HEALTHY;
+    if (revived) {
+        updated->status = ServiceStatus::HEALTHY;
+    }
+    replaceService(current, updated);
+    if (current->ttlMs > 0) {
+        armLease(serviceId, std::chrono::milliseconds(current->ttlMs), false);
+    }
+    if (revived) {
+        logEvent(RegistryEvent::Type::STATUS_CHANGED, updated);
+    }
+    return true;
+}
+
+bool ServiceRegistry::renewLease(const std::string& serviceId) {
+    auto lock = lockForWrite();
     
-    std::vector<std::shared_ptr<Service>> result;
-    for (const auto& [id, service] : services_) {
-        if (service->name == name && service->status == "healthy") {
-            result.push_back(service);
-        }
+    bool found = renew(serviceId);
+    
+    // A plain renewal waits in the draft, so a burst of heartbeats shares one publish
+    if (!pendingEvents_.empty()) {
+        commit();
     }
+    return found;
+}
+
+ServiceRegistry::LeaseExpiry ServiceRegistry::expireLeases(std::chrono::steady_clock::time_point now) {
+    auto lock = lockForWrite();
+    
+    LeaseExpiry result;
+    leaseWheel_.advance(now, [&](TimerWheel::Timer& timer) {
+        Lease* lease = static_cast<Lease*>(timer.context);
+        auto service = currentService(lease->serviceId);
+        if (!service) {
+            leases_.erase(lease->serviceId);
+            return;
+        }
+        
+        if (leaseExpiryHandler_) {
+            bool evict = lease->expired;
+            if (leaseExpiryHandler_(lease->serviceId, evict)) {
+                ++(evict ? result.evicted : result.expired);
+            }
+            if (leaseEvictAfter_.count() > 0) {
+                armLease(lease->serviceId, leaseEvictAfter_, true);
+            } else {
+                lease->expired = true;
+            }
+            return;
+        }
+        if (lease->expired) {
+            removeService(service); // frees the lease
+            ++result.evicted;
+            return;
+        }
+        if (service->status != ServiceStatus::UNHEALTHY) {
+            auto updated = std::make_shared<Service>(*service);
+            updated->status = ServiceStatus::UNHEALTHY;
+            replaceService(service, updated);
+            logEvent(RegistryEvent::Type::STATUS_CHANGED, updated);
+        }
+        ++result.expired;
+        if (leaseEvictAfter_.count() > 0) {
+            armLease(lease->serviceId, leaseEvictAfter_, true);
+        } else {
+            lease->expired = true;
+        }
+    });
+    
+    // Also publishes renewals left in the draft
+    commit();
     return result;
 }
 
-} // namespace dcp
\ No newline at end of file
+int ServiceRegistry::nextLeaseTimeoutMs(int limit) const {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    
+    int timeout = leaseWheel_.nextTimeoutMs(std::chrono::steady_clock::now(), limit);
+    if (draft_) {
+        timeout = std::min(timeout, static_cast<int>(kLeaseTick.count())); // renewals waiting to be published
+    }
+    return timeout;
+}
+
+void ServiceRegistry::setLeaseEvictAfter(std::chrono::milliseconds delay) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    leaseEvictAfter_ = std::max(delay, std::chrono::milliseconds(0));
+}
+
+void ServiceRegistry::setLeaseExpiryHandler(std::function<bool(const std::string& serviceId, bool evict)> handler) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    leaseExpiryHandler_ = std::move(handler);
+}
+
+size_t ServiceRegistry::leaseCount() const {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    return leases_.size();
+}
+
+} // namespace dcp
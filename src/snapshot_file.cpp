@@ -0,0 +1,352 @@
+#include "snapshot_file.h"
+#include "write_ahead_log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+namespace dcp {
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'C', 'P', 'S', 'N', 'A', 'P', '2'};
+
+static_assert(sizeof(SnapshotFile::Header) == 120, "snapshot header layout");
+static_assert(sizeof(SnapshotFile::Record) == 48, "snapshot record layout");
+static_assert(sizeof(SnapshotFile::MetadataSet) == 8, "snapshot metadata set layout");
+static_assert(sizeof(SnapshotFile::MetadataEntry) == 8, "snapshot metadata entry layout");
+
+uint32_t headerChecksum(const SnapshotFile::Header& header) {
+    return crc32c(&header, offsetof(SnapshotFile::Header, headerChecksum));
+}
+
+// Appends `count` objects at the next 8-byte boundary; returns their offset
+template <typename T>
+uint64_t appendSection(std::string& out, const T* items, size_t count) {
+    out.resize((out.size() + 7) & ~size_t(7), '\0');
+    uint64_t offset = out.size();
+    out.append(reinterpret_cast<const char*>(items), count * sizeof(T));
+    return offset;
+}
+
+bool fits(uint64_t offset, uint64_t size, uint64_t fileSize, size_t alignment) {
+    return offset % alignment == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+ServiceStatus statusOf(uint8_t value) {
+    return value <= static_cast<uint8_t>(ServiceStatus::UNHEALTHY) ? static_cast<ServiceStatus>(value)
+                                                                   : ServiceStatus::UNKNOWN;
+}
+
+} // namespace
+
+SnapshotFile::~SnapshotFile() {
+    close();
+}
+
+void SnapshotFile::close() {
+    if (base_) {
+        munmap(const_cast<char*>(base_), mappedSize_);
+    }
+    base_ = nullptr;
+    mappedSize_ = 0;
+    header_ = nullptr;
+}
+
+bool SnapshotFile::open(const std::string& path, std::string& error, bool* missing) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (missing) {
+        *missing = fd < 0 && errno == ENOENT;
+    }
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        error = "file is too short";
+        ::close(fd);
+        return false;
+    }
+
+    // Populated up front: startup reads every page anyway
+    void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = std::strerror(errno);
+        return false;
+    }
+    base_ = static_cast<const char*>(mapped);
+    mappedSize_ = static_cast<size_t>(st.st_size);
+    header_ = reinterpret_cast<const Header*>(base_);
+
+    if (!validate(error)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotFile::validate(std::string& error) {
+    const Header& h = *header_;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = "not a registry snapshot";
+        return false;
+    }
+    if (h.format != kFormat || h.headerSize != sizeof(Header)) {
+        error = "unsupported snapshot format " + std::to_string(h.format);
+        return false;
+    }
+    if (h.headerChecksum != headerChecksum(h) || h.fileSize != mappedSize_) {
+        error = "header is corrupt or the file is truncated";
+        return false;
+    }
+
+    uint64_t size = h.fileSize;
+    if (!fits(h.records, uint64_t(h.serviceCount) * sizeof(Record), size, alignof(Record)) ||
+        !fits(h.metadataSets, uint64_t(h.metadataSetCount) * sizeof(MetadataSet), size, alignof(MetadataSet)) ||
+        !fits(h.metadataEntries, uint64_t(h.metadataEntryCount) * sizeof(MetadataEntry), size,
+              alignof(MetadataEntry)) ||
+        !fits(h.stringOffsets, (uint64_t(h.stringCount) + 1) * sizeof(uint32_t), size, alignof(uint32_t)) ||
+        !fits(h.config, h.configSize, size, 1) || h.metadataSetCount == 0) {
+        error = "section out of bounds";
+        return false;
+    }
+    if (crc32c(base_ + sizeof(Header), size - sizeof(Header)) != h.bodyChecksum) {
+        error = "checksum mismatch";
+        return false;
+    }
+
+    records_ = reinterpret_cast<const Record*>(base_ + h.records);
+    metadataSets_ = reinterpret_cast<const MetadataSet*>(base_ + h.metadataSets);
+    metadataEntries_ = reinterpret_cast<const MetadataEntry*>(base_ + h.metadataEntries);
+    stringOffsets_ = reinterpret_cast<const uint32_t*>(base_ + h.stringOffsets);
+    stringData_ = base_ + h.stringData;
+
+    // The checksum guards against damage; these guard the accessors against a bad writer
+    if (stringOffsets_[0] != 0 || !fits(h.stringData, stringOffsets_[h.stringCount], size, 1)) {
+        error = "string table out of bounds";
+        return false;
+    }
+    for (uint32_t i = 0; i < h.stringCount; ++i) {
+        if (stringOffsets_[i] > stringOffsets_[i + 1]) {
+            error = "string table out of order";
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h.metadataSetCount; ++i) {
+        const MetadataSet& set = metadataSets_[i];
+        if (uint64_t(set.first) + set.count > h.metadataEntryCount) {
+            error = "metadata set out of bounds";
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h.metadataEntryCount; ++i) {
+        if (metadataEntries_[i].key >= h.stringCount || metadataEntries_[i].value >= h.stringCount) {
+            error = "metadata entry out of bounds";
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h.serviceCount; ++i) {
+        const Record& r = records_[i];
+        if (r.id >= h.stringCount || r.name >= h.stringCount || r.host >= h.stringCount ||
+            r.metadataSet >= h.metadataSetCount || (r.family != 0 && r.family != AF_INET && r.family != AF_INET6)) {
+            error = "service record out of bounds";
+            return false;
+        }
+        if (i > 0 && !(string(records_[i - 1].id) < string(r.id))) {
+            error = "service records out of order";
+            return false;
+        }
+    }
+    return true;
+}
+
+const SnapshotFile::Record* SnapshotFile::find(std::string_view id) const {
+    const Record* end = records_ + header_->serviceCount;
+    const Record* it = std::lower_bound(records_, end, id,
+                                        [this](const Record& r, std::string_view key) { return string(r.id) < key; });
+    return it != end && string(it->id) == id ? it : nullptr;
+}
+
+std::shared_ptr<const ServiceMetadata> SnapshotFile::metadata(uint32_t setIndex) const {
+    const MetadataSet& set = metadataSets_[setIndex];
+    std::vector<std::pair<std::string, std::string>> entries;
+    entries.reserve(set.count);
+    for (uint32_t i = set.first; i < set.first + set.count; ++i) {
+        entries.emplace_back(string(metadataEntries_[i].key), string(metadataEntries_[i].value));
+    }
+    return ServiceMetadata::make(std::move(entries));
+}
+
+std::shared_ptr<Service> SnapshotFile::makeService(const Record& record, InternedString name, InternedString host,
+                                                   std::shared_ptr<const ServiceMetadata> metadata) const {
+    auto service = std::make_shared<Service>(std::string(string(record.id)), name, host,
+                                             NetAddress::fromBytes(record.family, record.address), record.port);
+    service->status = statusOf(record.status);
+    service->ttlMs = record.ttlMs;
+    service->metadata = std::move(metadata);
+    service->lastHeartbeat = std::chrono::system_clock::time_point(std::chrono::milliseconds(record.lastHeartbeatMs));
+    return service;
+}
+
+std::shared_ptr<Service> SnapshotFile::service(const Record& record) const {
+    return makeService(record, InternedString(std::string(string(record.name))),
+                       InternedString(std::string(string(record.host))), metadata(record.metadataSet));
+}
+
+std::vector<std::shared_ptr<Service>> SnapshotFile::services() const {
+    // Names, hosts and metadata sets recur across records: build each once
+    std::vector<InternedString> interned(header_->stringCount);
+    std::vector<bool> isInterned(header_->stringCount, false);
+    auto intern = [&](uint32_t index) -> const InternedString& {
+        if (!isInterned[index]) {
+            interned[index] = InternedString(std::string(string(index)));
+            isInterned[index] = true;
+        }
+        return interned[index];
+    };
+    std::vector<std::shared_ptr<const ServiceMetadata>> sets(header_->metadataSetCount);
+
+    std::vector<std::shared_ptr<Service>> result;
+    result.reserve(header_->serviceCount);
+    for (uint32_t i = 0; i < header_->serviceCount; ++i) {
+        const Record& record = records_[i];
+        auto& set = sets[record.metadataSet];
+        if (!set) {
+            set = metadata(record.metadataSet);
+        }
+        result.push_back(makeService(record, intern(record.name), intern(record.host), set));
+    }
+    return result;
+}
+
+bool SnapshotFile::write(const std::string& path, const std::vector<std::shared_ptr<Service>>& services,
+                         uint64_t revision, uint64_t firstSegment, const std::string& config, std::string& error) {
+    std::vector<const Service*> sorted;
+    sorted.reserve(services.size());
+    for (const auto& service : services) {
+        sorted.push_back(service.get());
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Service* a, const Service* b) { return a->id < b->id; });
+
+    // Ids are unique; everything else is deduplicated
+    std::vector<uint32_t> stringOffsets{0};
+    std::string stringData;
+    std::unordered_map<std::string_view, uint32_t> shared;
+    auto addString = [&](const std::string& text) {
+        stringData.append(text);
+        stringOffsets.push_back(static_cast<uint32_t>(stringData.size()));
+        return static_cast<uint32_t>(stringOffsets.size() - 2);
+    };
+    auto sharedString = [&](const std::string& text) {
+        auto it = shared.find(text);
+        if (it != shared.end()) {
+            return it->second;
+        }
+        uint32_t index = addString(text);
+        shared.emplace(text, index);
+        return index;
+    };
+
+    std::vector<MetadataSet> sets{{0, 0}};
+    std::vector<MetadataEntry> entries;
+    std::unordered_map<const ServiceMetadata*, uint32_t> setIndex{{ServiceMetadata::empty().get(), 0}};
+    std::vector<Record> records;
+    records.reserve(sorted.size());
+    for (const Service* service : sorted) {
+        Record record{};
+        record.id = addString(service->id);
+        record.name = sharedString(service->name.str());
+        record.host = sharedString(service->host.str());
+        record.port = service->port;
+        record.status = static_cast<uint8_t>(service->status);
+        record.family = static_cast<uint8_t>(service->address.family());
+        std::memcpy(record.address, service->address.bytes(), sizeof(record.address));
+        record.ttlMs = service->ttlMs;
+        record.lastHeartbeatMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            service->lastHeartbeat.time_since_epoch()).count();
+
+        auto [it, added] = setIndex.emplace(service->metadata.get(), static_cast<uint32_t>(sets.size()));
+        if (added) {
+            sets.push_back({static_cast<uint32_t>(entries.size()), static_cast<uint32_t>(service->metadata->size())});
+            for (const auto& [key, value] : *service->metadata) {
+                entries.push_back({sharedString(key.str()), sharedString(value)});
+            }
+        }
+        record.metadataSet = it->second;
+        records.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.format = kFormat;
+    header.headerSize = sizeof(Header);
+    header.revision = revision;
+    header.firstSegment = firstSegment;
+    header.serviceCount = static_cast<uint32_t>(records.size());
+    header.stringCount = static_cast<uint32_t>(stringOffsets.size() - 1);
+    header.metadataSetCount = static_cast<uint32_t>(sets.size());
+    header.metadataEntryCount = static_cast<uint32_t>(entries.size());
+
+    std::string content(sizeof(Header), '\0');
+    content.reserve(sizeof(Header) + records.size() * sizeof(Record) + stringData.size() +
+                    stringOffsets.size() * sizeof(uint32_t) + config.size() + 64);
+    header.records = appendSection(content, records.data(), records.size());
+    header.metadataSets = appendSection(content, sets.data(), sets.size());
+    header.metadataEntries = appendSection(content, entries.data(), entries.size());
+    header.stringOffsets = appendSection(content, stringOffsets.data(), stringOffsets.size());
+    header.stringData = appendSection(content, stringData.data(), stringData.size());
+    header.config = appendSection(content, config.data(), config.size());
+    header.configSize = config.size();
+    header.fileSize = content.size();
+    header.bodyChecksum = crc32c(content.data() + sizeof(Header), content.size() - sizeof(Header));
+    header.headerChecksum = headerChecksum(header);
+    std::memcpy(&content[0], &header, sizeof(Header));
+
+    std::string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    const char* data = content.data();
+    size_t remaining = content.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, data, remaining);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            error = std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    if (!synced || rename(tempPath.c_str(), path.c_str()) != 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+
+    // Makes the rename durable
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+} // namespace dcp
@@ -0,0 +1,181 @@
+#include "static_file_cache.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+namespace dcp {
+
+namespace {
+
+bool endsWith(const std::string& value, const char* suffix) {
+    size_t len = std::strlen(suffix);
+    return value.size() >= len && value.compare(value.size() - len, len, suffix) == 0;
+}
+
+// Rejects paths that could escape the static root
+bool isSafePath(const std::string& path) {
+    if (path.empty() || path[0] != '/' || path.find('\0') != std::string::npos) {
+        return false;
+    }
+    return (path + "/").find("/../") == std::string::npos;
+}
+
+bool readFile(const std::string& filePath, size_t size, std::string& content) {
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    content.resize(size);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, &content[total], size - total);
+        if (n <= 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    close(fd);
+    content.resize(total);
+    return total == size;
+}
+
+} // namespace
+
+StaticFileCache::StaticFileCache(const std::string& rootDir, size_t maxFileSize, size_t maxTotalSize,
+                                 std::chrono::milliseconds revalidateInterval)
+    : rootDir_(rootDir), maxFileSize_(maxFileSize), maxTotalSize_(maxTotalSize),
+      revalidateInterval_(revalidateInterval), totalSize_(0) {
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::lookup(const std::string& path) {
+    if (!isSafePath(path)) {
+        return nullptr;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<const StaticFile> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            cached = it->second;
+            if (now - cached->checkedAt < revalidateInterval_) {
+                return cached;
+            }
+        }
+    }
+
+    std::string filePath = rootDir_ + (path == "/" ? "/index.html" : path);
+    struct stat st;
+    if (stat(filePath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            if (it->second->content) {
+                totalSize_ -= it->second->content->size();
+            }
+            entries_.erase(it);
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<const StaticFile> entry;
+    if (cached && cached->mtime == st.st_mtime && cached->size == st.st_size) {
+        // Unchanged on disk; only the validation time moves
+        auto refreshed = std::make_shared<StaticFile>(*cached);
+        refreshed->checkedAt = now;
+        entry = refreshed;
+    } else {
+        entry = load(filePath, st);
+        if (!entry) {
+            return nullptr;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = entries_[path];
+    if (slot && slot->content) {
+        totalSize_ -= slot->content->size();
+    }
+    if (entry->content && totalSize_ + entry->content->size() > maxTotalSize_) {
+        // Over budget: keep the metadata and stream the file from disk
+        auto uncached = std::make_shared<StaticFile>(*entry);
+        uncached->content.reset();
+        entry = uncached;
+    }
+    if (entry->content) {
+        totalSize_ += entry->content->size();
+    }
+    slot = entry;
+    return entry;
+}
+
+std::shared_ptr<const StaticFile> StaticFileCache::load(const std::string& filePath, const struct stat& st) {
+    auto file = std::make_shared<StaticFile>();
+    file->filePath = filePath;
+    file->contentType = contentTypeFor(filePath);
+    file->mtime = st.st_mtime;
+    file->size = st.st_size;
+    file->lastModified = formatHttpDate(st.st_mtime);
+    file->checkedAt = std::chrono::steady_clock::now();
+
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx%09lx\"",
+                  static_cast<unsigned long long>(st.st_size),
+                  static_cast<unsigned long long>(st.st_mtim.tv_sec),
+                  static_cast<long>(st.st_mtim.tv_nsec));
+    file->etag = etag;
+
+    if (static_cast<size_t>(st.st_size) <= maxFileSize_) {
+        auto content = std::make_shared<std::string>();
+        if (!readFile(filePath, static_cast<size_t>(st.st_size), *content)) {
+            return nullptr;
+        }
+        file->content = content;
+    }
+
+    return file;
+}
+
+size_t StaticFileCache::totalSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalSize_;
+}
+
+void StaticFileCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    totalSize_ = 0;
+}
+
+std::string StaticFileCache::contentTypeFor(const std::string& filePath) {
+    if (endsWith(filePath, ".html")) return "text/html";
+    if (endsWith(filePath, ".css")) return "text/css";
+    if (endsWith(filePath, ".js")) return "application/javascript";
+    if (endsWith(filePath, ".json")) return "application/json";
+    if (endsWith(filePath, ".svg")) return "image/svg+xml";
+    if (endsWith(filePath, ".png")) return "image/png";
+    if (endsWith(filePath, ".ico")) return "image/x-icon";
+    return "application/octet-stream";
+}
+
+std::string StaticFileCache::formatHttpDate(time_t time) {
+    struct tm tm;
+    gmtime_r(&time, &tm);
+    char buffer[64];
+    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buffer;
+}
+
+bool StaticFileCache::parseHttpDate(const std::string& value, time_t& time) {
+    struct tm tm{};
+    const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return false;
+    }
+    time = timegm(&tm);
+    return true;
+}
+
+} // namespace dcp
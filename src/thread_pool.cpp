@@ -0,0 +1,105 @@
+#include "thread_pool.h"
+#include <iostream>
+
+namespace dcp {
+
+ThreadPool::ThreadPool(size_t numThreads, size_t maxQueued)
+    : numThreads_(numThreads == 0 ? 1 : numThreads), maxQueued_(maxQueued), queued_(0), running_(false) {
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return; // Already running
+    }
+    running_ = true;
+
+    workers_.reserve(numThreads_);
+    for (size_t i = 0; i < numThreads_; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return; // Already stopped
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+    for (auto& queue : tasks_) {
+        queue.clear();
+    }
+    queued_ = 0;
+}
+
+bool ThreadPool::submit(std::function<void()> task, size_t priority) {
+    if (priority >= kPriorityLevels) {
+        priority = kPriorityLevels - 1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return false;
+        }
+        if (maxQueued_ > 0 && queued_ * kPriorityLevels >= maxQueued_ * (kPriorityLevels - priority)) {
+            return false; // Shed: the share of the queue open to this priority is full
+        }
+        tasks_[priority].push_back(std::move(task));
+        ++queued_;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t ThreadPool::queueDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+size_t ThreadPool::queueDepth(size_t priority) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return priority < kPriorityLevels ? tasks_[priority].size() : 0;
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return !running_ || queued_ > 0; });
+            if (!running_) {
+                return;
+            }
+            for (auto& queue : tasks_) {
+                if (!queue.empty()) {
+                    task = std::move(queue.front());
+                    queue.pop_front();
+                    break;
+                }
+            }
+            --queued_;
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "Worker task failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+} // namespace dcp
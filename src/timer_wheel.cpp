@@ -0,0 +1,130 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+namespace dcp {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, Clock::time_point start)
+    : tick_(std::max(tick, std::chrono::milliseconds(1))), start_(start), current_(0), size_(0) {
+    for (int level = 0; level < kLevels; ++level) {
+        for (int slot = 0; slot < kSlots; ++slot) {
+            slots_[level][slot].prev = slots_[level][slot].next = &slots_[level][slot];
+        }
+        occupied_[level] = 0;
+    }
+}
+
+uint64_t TimerWheel::toTick(Clock::time_point time) const {
+    if (time <= start_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((time - start_) / tick_);
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline) {
+    if (timer.armed()) {
+        cancel(timer);
+    }
+    // Round up so a timer never fires before its deadline
+    uint64_t expiry = deadline > start_
+        ? static_cast<uint64_t>((deadline - start_ + tick_ - Clock::duration(1)) / tick_)
+        : 0;
+    timer.expiry = std::max(expiry, current_ + 1);
+    place(timer);
+    ++size_;
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.armed()) {
+        unlink(timer);
+        --size_;
+    }
+}
+
+void TimerWheel::place(Timer& timer) {
+    uint64_t delta = timer.expiry > current_ ? timer.expiry - current_ : 0;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+    uint64_t span = uint64_t(1) << (kSlotBits * kLevels);
+    if (delta >= span) {
+        timer.expiry = current_ + span - 1;
+    }
+
+    size_t slot = (timer.expiry >> (kSlotBits * level)) & (kSlots - 1);
+    Timer& head = slots_[level][slot];
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::cascade() {
+    // Redistribute the higher-level slots that start at this tick, top level
+    // first so timers can drop through several levels in one step
+    int top = 0;
+    while (top < kLevels - 1 && (current_ & ((uint64_t(1) << (kSlotBits * (top + 1))) - 1)) == 0) {
+        ++top;
+    }
+    for (int level = top; level >= 1; --level) {
+        size_t slot = (current_ >> (kSlotBits * level)) & (kSlots - 1);
+        occupied_[level] &= ~(uint64_t(1) << slot);
+        Timer moving;
+        splice(slots_[level][slot], moving);
+        while (moving.next != &moving) {
+            Timer* timer = moving.next;
+            unlink(*timer);
+            place(*timer);
+        }
+    }
+}
+
+int TimerWheel::nextTimeoutMs(Clock::time_point now, int limit) const {
+    if (size_ == 0) {
+        return limit;
+    }
+
+    // Next possibly occupied level-0 slot, and the next cascade if anything sits higher up
+    uint64_t next = current_ + kSlots;
+    unsigned shift = static_cast<unsigned>((current_ + 1) & (kSlots - 1));
+    uint64_t bits = occupied_[0];
+    uint64_t rotated = shift ? (bits >> shift) | (bits << (kSlots - shift)) : bits;
+    if (rotated) {
+        next = current_ + 1 + static_cast<uint64_t>(__builtin_ctzll(rotated));
+    }
+    for (int level = 1; level < kLevels; ++level) {
+        if (occupied_[level]) {
+            next = std::min(next, (current_ | (kSlots - 1)) + 1);
+            break;
+        }
+    }
+
+    auto due = start_ + next * tick_;
+    if (due <= now) {
+        return 0;
+    }
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(due - now).count();
+    return static_cast<int>(std::min<decltype(wait)>(wait, limit));
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = nullptr;
+}
+
+void TimerWheel::splice(Timer& from, Timer& to) {
+    // `to` is an unlinked local sentinel
+    if (from.next == &from) {
+        to.prev = to.next = &to;
+        return;
+    }
+    to.next = from.next;
+    to.prev = from.prev;
+    to.next->prev = &to;
+    to.prev->next = &to;
+    from.prev = from.next = &from;
+}
+
+} // namespace dcp
@@ -0,0 +1,350 @@
+#include "write_ahead_log.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace dcp {
+
+namespace {
+
+constexpr uint32_t kMaxRecordSize = 64 * 1024 * 1024;
+constexpr size_t kFrameHeaderSize = 8; // length, checksum
+
+// Slicing-by-8 tables for the reflected Castagnoli polynomial
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32cTables& crcTables() {
+    static const Crc32cTables tables;
+    return tables;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readWholeFile(const std::string& path, std::string& content) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    content.clear();
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            return false;
+        }
+        content.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return true;
+}
+
+// Segment number of a "wal-<number>.log" file name, or 0
+uint64_t segmentOf(const std::string& fileName) {
+    unsigned long long segment = 0;
+    char tail = 0;
+    if (std::sscanf(fileName.c_str(), "wal-%llu.lo%c", &segment, &tail) != 2 || tail != 'g' ||
+        fileName.size() < 8 || fileName.compare(fileName.size() - 4, 4, ".log") != 0) {
+        return 0;
+    }
+    return segment;
+}
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    const auto& t = crcTables().table;
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, p, 4);
+        std::memcpy(&high, p + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+    return ~crc;
+}
+
+bool parseFsyncPolicy(const std::string& text, FsyncPolicy& policy) {
+    if (text == "always") {
+        policy = FsyncPolicy::ALWAYS;
+    } else if (text == "interval") {
+        policy = FsyncPolicy::INTERVAL;
+    } else if (text == "none") {
+        policy = FsyncPolicy::NONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& directory, FsyncPolicy policy)
+    : directory_(directory), policy_(policy), fd_(-1), segment_(0), appended_(0), written_(0), durable_(0),
+      segmentBytes_(0), syncs_(0), flushing_(false), failed_(false) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+std::string WriteAheadLog::segmentPath(uint64_t segment) const {
+    char name[48];
+    std::snprintf(name, sizeof(name), "/wal-%016llu.log", static_cast<unsigned long long>(segment));
+    return directory_ + name;
+}
+
+int WriteAheadLog::openSegment(uint64_t segment) {
+    int fd = ::open(segmentPath(segment).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open log segment " << segmentPath(segment) << ": " << std::strerror(errno)
+                  << std::endl;
+    }
+    return fd;
+}
+
+void WriteAheadLog::syncDirectory() {
+    // Makes segment creation and removal durable
+    int fd = ::open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+}
+
+bool WriteAheadLog::open(uint64_t firstSegment, const RecordHandler& replay) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        std::cerr << "Failed to create " << directory_ << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    std::vector<uint64_t> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+        uint64_t segment = segmentOf(entry.path().filename().string());
+        if (segment == 0) {
+            continue;
+        }
+        if (segment < firstSegment) {
+            std::filesystem::remove(entry.path(), error); // already covered by a snapshot
+        } else {
+            segments.push_back(segment);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+
+    uint64_t last = firstSegment > 0 ? firstSegment - 1 : 0;
+    std::string content;
+    bool torn = false;
+    for (uint64_t segment : segments) {
+        std::string path = segmentPath(segment);
+        if (torn) {
+            std::cerr << "Discarding log segment after corruption: " << path << std::endl;
+            std::filesystem::remove(path, error);
+            continue;
+        }
+        last = segment;
+        if (!readWholeFile(path, content)) {
+            std::cerr << "Failed to read log segment " << path << std::endl;
+            return false;
+        }
+
+        size_t offset = 0;
+        while (offset < content.size()) {
+            uint32_t size;
+            uint32_t checksum;
+            if (content.size() - offset < kFrameHeaderSize) {
+                torn = true;
+                break;
+            }
+            std::memcpy(&size, content.data() + offset, 4);
+            std::memcpy(&checksum, content.data() + offset + 4, 4);
+            const char* data = content.data() + offset + kFrameHeaderSize;
+            if (size > kMaxRecordSize || content.size() - offset - kFrameHeaderSize < size ||
+                crc32c(data, size, crc32c(&size, 4)) != checksum) {
+                torn = true;
+                break;
+            }
+            replay(data, size);
+            offset += kFrameHeaderSize + size;
+        }
+        if (torn) {
+            std::cerr << "Log segment " << path << " ends in a torn record; truncating at byte " << offset
+                      << std::endl;
+            if (truncate(path.c_str(), static_cast<off_t>(offset)) != 0) {
+                return false;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    segment_ = last + 1;
+    fd_ = openSegment(segment_);
+    segmentBytes_ = 0;
+    failed_ = fd_ < 0;
+    syncDirectory();
+    return !failed_;
+}
+
+void WriteAheadLog::close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0) {
+        return;
+    }
+    flushed_.wait(lock, [this]() { return !flushing_; });
+    if (!pending_.empty() || durable_ < appended_) {
+        flushLocked(lock, policy_ != FsyncPolicy::NONE);
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void WriteAheadLog::append(const char* data, size_t size) {
+    uint32_t length = static_cast<uint32_t>(size);
+    uint32_t checksum = crc32c(data, size, crc32c(&length, 4));
+    char header[kFrameHeaderSize];
+    std::memcpy(header, &length, 4);
+    std::memcpy(header + 4, &checksum, 4);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.append(header, kFrameHeaderSize);
+    pending_.append(data, size);
+    segmentBytes_ += kFrameHeaderSize + size;
+    ++appended_;
+}
+
+bool WriteAheadLog::flushLocked(std::unique_lock<std::mutex>& lock, bool durable) {
+    flushing_ = true;
+    std::string batch;
+    batch.swap(pending_);
+    uint64_t upTo = appended_;
+    int fd = fd_;
+
+    // Appends carry on into pending_ while this batch is written
+    lock.unlock();
+    bool ok = writeAll(fd, batch.data(), batch.size()) && (!durable || fdatasync(fd) == 0);
+    int error = errno;
+    lock.lock();
+
+    if (!ok && !failed_) {
+        std::cerr << "Write-ahead log write failed: " << std::strerror(error) << std::endl;
+    }
+    failed_ = failed_ || !ok;
+    written_ = upTo;
+    if (durable) {
+        durable_ = upTo;
+        ++syncs_;
+    }
+    flushing_ = false;
+    flushed_.notify_all();
+    return ok;
+}
+
+bool WriteAheadLog::flush(bool durable) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = appended_;
+    while ((durable ? durable_ : written_) < target) {
+        if (failed_ || fd_ < 0) {
+            return false;
+        }
+        if (flushing_) {
+            // Someone else is flushing; our records go out in the next batch
+            flushed_.wait(lock);
+            continue;
+        }
+        flushLocked(lock, durable);
+    }
+    return !failed_;
+}
+
+uint64_t WriteAheadLog::rotate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.wait(lock, [this]() { return !flushing_; });
+    if (fd_ < 0) {
+        return segment_;
+    }
+    flushLocked(lock, true);
+
+    int next = openSegment(segment_ + 1);
+    if (next < 0) {
+        return segment_;
+    }
+    ::close(fd_);
+    fd_ = next;
+    ++segment_;
+    segmentBytes_ = 0;
+    uint64_t segment = segment_;
+    lock.unlock();
+
+    syncDirectory();
+    return segment;
+}
+
+void WriteAheadLog::removeSegmentsBefore(uint64_t segment) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+        uint64_t number = segmentOf(entry.path().filename().string());
+        if (number != 0 && number < segment) {
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+    syncDirectory();
+}
+
+uint64_t WriteAheadLog::segmentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segmentBytes_;
+}
+
+uint64_t WriteAheadLog::syncCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return syncs_;
+}
+
+} // namespace dcp
@@ -0,0 +1,160 @@
+// Inspects registry snapshots and converts them to and from the JSON the API
+// serves (GET /api/services).
+//
+// Usage:
+//   snapshot-tool info <snapshot>
+//   snapshot-tool get <snapshot> <id>
+//   snapshot-tool to-json <snapshot> [output.json]
+//   snapshot-tool from-json <services.json> <snapshot> [revision]
+//
+// A snapshot made with from-json has no log behind it: place it in an empty
+// persistence directory as registry.snapshot to start a control plane from it.
+#include "service_json.h"
+#include "snapshot_file.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: snapshot-tool info <snapshot>\n"
+              << "       snapshot-tool get <snapshot> <id>\n"
+              << "       snapshot-tool to-json <snapshot> [output.json]\n"
+              << "       snapshot-tool from-json <services.json> <snapshot> [revision]" << std::endl;
+    return 2;
+}
+
+bool openSnapshot(dcp::SnapshotFile& file, const std::string& path) {
+    std::string error;
+    if (!file.open(path, error)) {
+        std::cerr << "Failed to open " << path << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int info(const std::string& path) {
+    dcp::SnapshotFile file;
+    if (!openSnapshot(file, path)) {
+        return 1;
+    }
+    std::cout << "format:         " << dcp::SnapshotFile::kFormat << std::endl;
+    std::cout << "revision:       " << file.revision() << std::endl;
+    std::cout << "first segment:  " << file.firstSegment() << std::endl;
+    std::cout << "services:       " << file.size() << std::endl;
+    std::cout << "strings:        " << file.stringCount() << std::endl;
+    std::cout << "metadata sets:  " << file.metadataSetCount() << std::endl;
+    std::cout << "config:         " << file.config() << std::endl;
+    return 0;
+}
+
+// Served from the mapping: a binary search, then one record materialized
+int get(const std::string& path, const std::string& id) {
+    dcp::SnapshotFile file;
+    if (!openSnapshot(file, path)) {
+        return 1;
+    }
+    const dcp::SnapshotFile::Record* record = file.find(id);
+    if (!record) {
+        std::cerr << "Service " << id << " not found" << std::endl;
+        return 1;
+    }
+    std::cout << dcp::serviceToJson(*file.service(*record)).dump(4) << std::endl;
+    return 0;
+}
+
+int toJson(const std::string& path, const std::string& outputPath) {
+    dcp::SnapshotFile file;
+    if (!openSnapshot(file, path)) {
+        return 1;
+    }
+    nlohmann::json result = nlohmann::json::array();
+    for (const auto& service : file.services()) {
+        result.push_back(dcp::serviceToJson(*service));
+    }
+    if (outputPath.empty()) {
+        std::cout << result.dump(4) << std::endl;
+        return 0;
+    }
+    std::ofstream out(outputPath);
+    out << result.dump(4) << std::endl;
+    if (!out) {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int fromJson(const std::string& inputPath, const std::string& path, uint64_t revision) {
+    std::ifstream in(inputPath);
+    if (!in) {
+        std::cerr << "Failed to open " << inputPath << std::endl;
+        return 1;
+    }
+    nlohmann::json input = nlohmann::json::parse(in, nullptr, false);
+    if (!input.is_array()) {
+        std::cerr << inputPath << " is not a JSON array of services" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::shared_ptr<dcp::Service>> services;
+    for (const auto& item : input) {
+        std::string error;
+        std::shared_ptr<dcp::Service> service;
+        try {
+            service = dcp::serviceFromJson(item, error);
+            if (service) {
+                // Fields the API adds on output
+                if (item.contains("ttlMs")) {
+                    service->ttlMs = item["ttlMs"].get<uint32_t>();
+                }
+                if (item.contains("status")) {
+                    service->status = dcp::parseServiceStatus(item["status"].get<std::string>());
+                }
+                if (item.contains("lastHeartbeat")) {
+                    service->lastHeartbeat = std::chrono::system_clock::from_time_t(item["lastHeartbeat"].get<int64_t>());
+                }
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!service) {
+            std::cerr << "Invalid service " << item.dump() << ": " << error << std::endl;
+            return 1;
+        }
+        services.push_back(service);
+    }
+
+    std::string error;
+    if (!dcp::SnapshotFile::write(path, services, revision, 0, "{}", error)) {
+        std::cerr << "Failed to write " << path << ": " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << services.size() << " services to " << path << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string command = argc > 1 ? argv[1] : "";
+    try {
+        if (command == "info" && argc == 3) {
+            return info(argv[2]);
+        }
+        if (command == "get" && argc == 4) {
+            return get(argv[2], argv[3]);
+        }
+        if (command == "to-json" && (argc == 3 || argc == 4)) {
+            return toJson(argv[2], argc == 4 ? argv[3] : "");
+        }
+        if (command == "from-json" && (argc == 4 || argc == 5)) {
+            return fromJson(argv[2], argv[3], argc == 5 ? std::stoull(argv[4]) : 1);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return usage();
+}